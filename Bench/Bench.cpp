@@ -0,0 +1,695 @@
+/**
+ * \file Bench.cpp
+ * \brief Derplotter Benchmark Suite
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \copyright Academic Free License version 3.0
+ *
+ * This headless executable measures the throughput of the main stages of the
+ * rendering pipeline: submitting operations to the renderer's queue, transforming
+ * points, rasterizing lines of several lengths and orientations, clearing the buffer
+ * and rendering full frames at several resolutions.
+ *
+ * Each result is printed to the standard output as one JSON object per line, so that
+ * results from different builds can be compared for tracking regressions:
+ *
+ * <tt>{"benchmark":"raw_drawLine","params":"length=64,orientation=diagonal",
+ * "iterations":1048576,"seconds":0.21,"ops_per_sec":4993219.0}</tt>
+ *
+ * Usage: <tt>Bench [minimum seconds per benchmark] [name filter]</tt>
+ *
+ * When the library is built with the \c Derplotter_TRACE macro defined, the events
+ * of the last benchmarks are saved to \c Bench.trace.json .
+ */
+
+#include <Derplotter.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+using namespace std;
+using namespace derplot;
+using namespace math;   // derplot::math
+
+typedef std::pair<int,int> ipair;
+
+static double min_seconds = 0.25;
+static const char* filter = nullptr;
+
+/** Runs a benchmark function, growing its number of iterations until it takes at
+ * least \c min_seconds , and prints the result. The function receives the number of
+ * iterations and returns the number of operations performed.
+ */
+template <typename F>
+void bench(const char* name, const string& params, F func)
+{
+	if (filter != nullptr && strstr(name, filter) == nullptr) return;
+
+	typedef std::chrono::steady_clock clock;
+	long long iterations = 1;
+	double seconds = 0;
+	long long ops = 0;
+	for (;;)
+	{
+		const clock::time_point start = clock::now();
+		ops = func(iterations);
+		seconds = std::chrono::duration<double>(clock::now() - start).count();
+		if (seconds >= min_seconds || iterations >= (1LL << 40)) break;
+		// aim slightly above the minimum time, growing at most 16x at once
+		double factor = (seconds > 0) ? 1.2 * min_seconds / seconds : 16;
+		if (factor > 16) factor = 16;
+		if (factor < 2) factor = 2;
+		iterations = (long long)(iterations * factor);
+	}
+	printf("{\"benchmark\":\"%s\",\"params\":\"%s\",\"iterations\":%lld,"
+			"\"seconds\":%.6f,\"ops_per_sec\":%.1f}\n",
+			name, params.c_str(), ops, seconds, ops / seconds);
+	fflush(stdout);
+}
+
+/** Defines a projection and camera similar to the test chamber */
+void setCamera(Renderer& renderer, int width, int height)
+{
+	renderer.perspectiveProjection(60, 0.01, 100, (float)width/(float)height);
+	renderer.rotateX(degrees2radians(10));
+	renderer.translate({0.5, -1.5, -5});
+}
+
+void setCamera(RendererProgram& program, int width, int height)
+{
+	op::Perspective(60, 0.01, 100, (float)width/(float)height).onDispatch(program);
+	op::MatrixRotate(degrees2radians(10), 0).onDispatch(program);
+	op::MatrixTranslate({0.5, -1.5, -5}).onDispatch(program);
+}
+
+/** Draws a frame of a scene with some wireframe objects */
+void drawScene(RendererInvoker& renderer, int frame)
+{
+	static const float line_stream[] = {
+		0,0,0, 1,0,0, 1,0,0, 1,1,0, 1,1,0, 0,1,0, 0,1,0, 0,0,0,
+		0,0,1, 1,0,1, 1,0,1, 1,1,1, 1,1,1, 0,1,1, 0,1,1, 0,0,1,
+		0,0,0, 0,0,1, 1,0,0, 1,0,1, 1,1,0, 1,1,1, 0,1,0, 0,1,1,
+		0,0,1, .5,.5,2,  1,0,1, .5,.5,2,  0,1,1, .5,.5,2,  1,1,1, .5,.5,2,
+	};
+	const float ang = frame * 0.05f;
+
+	renderer.clear();
+	renderer.front_color(0xFF888888);
+	for (int i = 0 ; i < 64 ; i++)
+	{
+		const float a = ang + i * (float)(2 * PI / 64);
+		renderer.drawLine({0.5, 1, 0.5}, {0.5f + cosf(a), 0, 0.5f + sinf(a)});
+	}
+	renderer.front_color(0xFFFFFFFF);
+	for (unsigned int i = 0 ; i < sizeof(line_stream)/sizeof(float) ; i += 6)
+		renderer.drawLine(
+			{line_stream[i], line_stream[i+1], line_stream[i+2]},
+			{line_stream[i+3], line_stream[i+4], line_stream[i+5]});
+	renderer.front_color(0xFFFF0000);
+	for (int i = 0 ; i < 256 ; i++)
+		renderer.drawPoint({cosf(ang + i) * 0.5f + 0.5f, i / 256.f, sinf(ang + i) * 0.5f});
+}
+
+void benchSubmission(void)
+{
+	bench("submit", "op=drawRawPoint", [](long long n) {
+		Renderer renderer(256, 256);
+		for (long long i = 0 ; i < n ; i++)
+			renderer.drawRawPoint(ipair(i & 255, (i >> 8) & 255));
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+	bench("submit", "op=drawLine", [](long long n) {
+		Renderer renderer(256, 256);
+		for (long long i = 0 ; i < n ; i++)
+			renderer.drawLine({0, 0, 0}, {1, 1, 0});
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+	bench("submit", "op=drawRawPoint,threads=4", [](long long n) {
+		Renderer renderer(256, 256);
+		CommandBuffer buffers[4];
+		std::thread threads[4];
+		for (int t = 0 ; t < 4 ; t++)
+			threads[t] = std::thread([&buffers, t, n] {
+				for (long long i = t ; i < n ; i += 4)
+					buffers[t].drawRawPoint(ipair(i & 255, (i >> 8) & 255));
+			});
+		for (std::thread& t : threads) t.join();
+		renderer.submit({&buffers[0], &buffers[1], &buffers[2], &buffers[3]});
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+	bench("submit", "op=translate", [](long long n) {
+		Renderer renderer(256, 256);
+		for (long long i = 0 ; i < n ; i++)
+			renderer.translate({0, 0, 0});
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+}
+
+void benchTransform(void)
+{
+	bench("transformPoint", "", [](long long n) {
+		DisplayBuffer buffer(640, 480);
+		RendererProgram program(buffer);
+		setCamera(program, 640, 480);
+		long long visible = 0;
+		for (long long i = 0 ; i < n ; i++)
+		{
+			Vector4f p((i & 63) / 64.f, ((i >> 6) & 63) / 64.f, 0.5f);
+			ipair rp;
+			if (program.transformPoint(p, rp) == 0) visible++;
+		}
+		if (visible < 0) puts(""); // keep the result alive
+		return n;
+	});
+	bench("dispatch", "op=translate+rotateXYZ", [](long long n) {
+		DisplayBuffer buffer(64, 64);
+		RendererProgram program(buffer);
+		for (long long i = 0 ; i < n ; i++)
+		{
+			const float a = (i & 255) * 0.01f;
+			program.modelview = Mat4x4f::IDENTITY;
+			op::MatrixTranslate({a, 0, 0}).onDispatch(program);
+			op::MatrixRotate(a, 0).onDispatch(program);
+			op::MatrixRotate(a, 1).onDispatch(program);
+			op::MatrixRotate(a, 2).onDispatch(program);
+		}
+		return n;
+	});
+	bench("dispatch", "op=setTransform", [](long long n) {
+		DisplayBuffer buffer(64, 64);
+		RendererProgram program(buffer);
+		for (long long i = 0 ; i < n ; i++)
+		{
+			const float a = (i & 255) * 0.01f;
+			op::MatrixTRS({a, 0, 0}, euler2quaternion(a, a, a), {1, 1, 1}).onDispatch(program);
+		}
+		return n;
+	});
+}
+
+void benchLines(void)
+{
+	static const struct { const char* name; int dx, dy; } orientations[] = {
+		{"horizontal", 1, 0}, {"vertical", 0, 1}, {"diagonal", 1, 1},
+		{"shallow", 4, 1}, {"steep", 1, 4} };
+	static const int lengths[] = {8, 64, 512};
+
+	for (const auto& o : orientations)
+		for (int length : lengths)
+		{
+			const string params = "length=" + to_string(length)
+								+ ",orientation=" + o.name;
+			bench("raw_drawLine", params, [&](long long n) {
+				DisplayBuffer buffer(1024, 1024);
+				RendererProgram program(buffer);
+				// the major axis spans the given length
+				const int major = (o.dx > o.dy) ? o.dx : o.dy;
+				const int ex = o.dx * length / major, ey = o.dy * length / major;
+				for (long long i = 0 ; i < n ; i++)
+				{
+					const int x = (int)(i & 255), y = (int)((i >> 8) & 255);
+					ipair p1(x, y), p2(x + ex, y + ey);
+					program.raw_drawLine(p1, p2);
+				}
+				return n;
+			});
+		}
+
+	// lines crossing a scissor region, which are clipped before rasterization
+	bench("raw_drawLine", "length=512,orientation=shallow,scissor=256x256", [&](long long n) {
+		DisplayBuffer buffer(1024, 1024);
+		RendererProgram program(buffer);
+		program.setScissor(Region2i(128, 384, 128, 384));
+		for (long long i = 0 ; i < n ; i++)
+		{
+			const int x = (int)(i & 255), y = (int)((i >> 8) & 255);
+			ipair p1(x, y), p2(x + 512, y + 128);
+			program.raw_drawLine(p1, p2);
+		}
+		return n;
+	});
+}
+
+void benchBatches(void)
+{
+	// a ring of small line segments around the test chamber
+	static float ring[1024 * 3];
+	static Vector4f ring_vertices[1024];
+	for (int i = 0 ; i < 1024 ; i++)
+	{
+		const float a = i * (float)(2 * PI / 1024);
+		ring[i*3] = 0.5f + cosf(a);
+		ring[i*3 + 1] = 0.5f + 0.25f * sinf(a * 8);
+		ring[i*3 + 2] = 0.5f + sinf(a);
+		ring_vertices[i] = Vector4f(ring[i*3], ring[i*3 + 1], ring[i*3 + 2]);
+	}
+	const Bounds box = Bounds::box(ring, 1024);
+	const Bounds far_box = Bounds::box({100, 100, 100}, {101, 101, 101});
+
+	static const struct { const char* params; const Bounds* bounds; } variants[] = {
+		{"mode=LINES,bounds=none", nullptr},
+		{"mode=LINES,bounds=box", &box},
+		{"mode=LINES,bounds=outside", &far_box} };
+
+	bench("drawLine", "lines=512", [](long long n) {
+		DisplayBuffer buffer(640, 480);
+		RendererProgram program(buffer);
+		setCamera(program, 640, 480);
+		for (long long k = 0 ; k < n ; k += 512)
+			for (int i = 0 ; i < 1024 ; i += 2)
+				program.drawLine({ring[i*3], ring[i*3 + 1], ring[i*3 + 2]},
+						{ring[i*3 + 3], ring[i*3 + 4], ring[i*3 + 5]});
+		return (n + 511) / 512 * 512;
+	});
+	for (const auto& v : variants)
+		bench("drawArrays", string(v.params) + ",lines=512", [&](long long n) {
+			DisplayBuffer buffer(640, 480);
+			RendererProgram program(buffer);
+			setCamera(program, 640, 480);
+			const Bounds bounds = v.bounds ? *v.bounds : Bounds();
+			for (long long k = 0 ; k < n ; k += 512)
+				program.drawArrays(LINES, ring_vertices, 1024, bounds);
+			return (n + 511) / 512 * 512;
+		});
+
+	// submitting a static mesh each frame, by value and by vertex buffer
+	bench("submit", "op=drawArrays,vertices=1024", [](long long n) {
+		Renderer renderer(64, 64);
+		renderer.translate({100, 0, 0}); // culled, so only the submission is measured
+		for (long long i = 0 ; i < n ; i++)
+			renderer.drawArrays(LINES, ring, 1024, Bounds::box(ring, 1024));
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+	bench("submit", "op=drawBuffer,vertices=1024", [](long long n) {
+		Renderer renderer(64, 64);
+		renderer.translate({100, 0, 0});
+		const unsigned int buffer = renderer.createBuffer();
+		renderer.uploadVertices(buffer, ring, 1024);
+		for (long long i = 0 ; i < n ; i++)
+			renderer.drawBuffer(buffer, LINES, 0, 1024);
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+
+	// a multicolored polyline, by changing the front color on each segment
+	// and by vertex colors
+	static unsigned int ring_colors[1024];
+	for (int i = 0 ; i < 1024 ; i++)
+		ring_colors[i] = 0xFF000000 | (i * 0x00010203u & 0x00FFFFFF);
+	bench("submit", "op=front_color+drawLine,segments=64", [](long long n) {
+		Renderer renderer(64, 64);
+		renderer.translate({100, 0, 0});
+		for (long long i = 0 ; i < n ; i++)
+			for (int k = 0 ; k < 64 ; k++)
+			{
+				renderer.front_color(ring_colors[k]);
+				renderer.drawLine({ring[k*3], ring[k*3 + 1], ring[k*3 + 2]},
+						{ring[k*3 + 3], ring[k*3 + 4], ring[k*3 + 5]});
+			}
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+	bench("submit", "op=drawArrays+colors,segments=64", [](long long n) {
+		Renderer renderer(64, 64);
+		renderer.translate({100, 0, 0});
+		for (long long i = 0 ; i < n ; i++)
+			renderer.drawArrays(LINE_STRIP, ring, ring_colors, 65);
+		renderer.flush();
+		renderer.terminate();
+		return n;
+	});
+}
+
+void benchMeshes(void)
+{
+	// a 32x32 grid on the floor of the test chamber, with shared vertices
+	const int cells = 32, side = cells + 1;
+	static vector<Vector4f> grid;
+	static vector<Vector4f> edge_vertices; // the same edges, with no sharing
+	static vector<unsigned int> edges, triangles;
+	for (int z = 0 ; z < side ; z++)
+		for (int x = 0 ; x < side ; x++)
+			grid.emplace_back(-1 + 3.0f * x / cells, 0, -1 + 3.0f * z / cells);
+	for (int z = 0 ; z < side ; z++)
+		for (int x = 0 ; x < side ; x++)
+		{
+			const unsigned int i = z*side + x;
+			if (x < cells) edges.insert(edges.end(), {i, i + 1});
+			if (z < cells) edges.insert(edges.end(), {i, i + side});
+			if (x < cells && z < cells)
+				triangles.insert(triangles.end(), {i, i + 1, i + side,
+						i + 1, i + side + 1, i + side});
+		}
+	for (unsigned int i : edges) edge_vertices.push_back(grid[i]);
+	const Bounds bounds = Bounds::box(grid.data(), grid.size());
+
+	const string lines = ",lines=" + to_string(edges.size() / 2);
+	bench("drawArrays", "mode=LINES" + lines, [&](long long n) {
+		DisplayBuffer buffer(640, 480);
+		RendererProgram program(buffer);
+		setCamera(program, 640, 480);
+		for (long long k = 0 ; k < n ; k++)
+			program.drawArrays(LINES, edge_vertices.data(), edge_vertices.size(), bounds);
+		return n;
+	});
+	bench("drawElements", "mode=LINES" + lines, [&](long long n) {
+		DisplayBuffer buffer(640, 480);
+		RendererProgram program(buffer);
+		setCamera(program, 640, 480);
+		for (long long k = 0 ; k < n ; k++)
+			program.drawElements(LINES, grid.data(), grid.size(),
+					edges.data(), edges.size(), bounds);
+		return n;
+	});
+	bench("drawElements", "mode=TRIANGLES,triangles=" + to_string(triangles.size() / 3),
+			[&](long long n) {
+		DisplayBuffer buffer(640, 480);
+		RendererProgram program(buffer);
+		setCamera(program, 640, 480);
+		for (long long k = 0 ; k < n ; k++)
+			program.drawElements(TRIANGLES, grid.data(), grid.size(),
+					triangles.data(), triangles.size(), bounds);
+		return n;
+	});
+
+	// the same triangles with Gouraud shading
+	static vector<unsigned int> grid_colors;
+	for (int z = 0 ; z < side ; z++)
+		for (int x = 0 ; x < side ; x++)
+			grid_colors.push_back(0xFF000000 | (x * 255 / cells) << 16 | (z * 255 / cells));
+	bench("drawElements", "mode=TRIANGLES,colors,triangles=" + to_string(triangles.size() / 3),
+			[&](long long n) {
+		DisplayBuffer buffer(640, 480);
+		RendererProgram program(buffer);
+		setCamera(program, 640, 480);
+		for (long long k = 0 ; k < n ; k++)
+			program.drawElements(TRIANGLES, grid.data(), grid.size(),
+					triangles.data(), triangles.size(), bounds, grid_colors.data());
+		return n;
+	});
+}
+
+void benchViewports(void)
+{
+	// a dashboard of 8x8 small plots in one buffer, of a few samples each (where the
+	// threads of drawViewports are not worth it) and of many samples each
+	const int width = 1280, height = 960, grid = 8, plots = grid * grid;
+	for (const int samples : { 256, 4096 })
+	{
+		auto cell = [=](int i) {
+			const int x = i % grid, y = i / grid;
+			return Region2i(x * width / grid, (x + 1) * width / grid,
+							y * height / grid, (y + 1) * height / grid);
+		};
+		auto upload = [=](RendererProgram& program) {
+			for (int i = 0 ; i < plots ; i++)
+			{
+				vector<Vector4f> vertices;
+				vector<unsigned int> colors;
+				for (int k = 0 ; k < samples ; k++)
+					vertices.emplace_back(-0.9f + 1.8f * k / samples,
+							0.9f * sinf(k * 0.05f + i), 0);
+				program.uploadVertices(i + 1, vertices, colors);
+				Mat4x4f modelview = Mat4x4f::IDENTITY;
+				math::scale(modelview, 1, 0.5f + 0.5f * (i % 2), 1);
+				program.setViewportSlot(i, cell(i), Mat4x4f::IDENTITY, modelview);
+			}
+		};
+		const string params = "plots=" + to_string(plots) + ",samples=" + to_string(samples);
+
+		// one viewport change and matrix reset per plot, as with separate operations
+		bench("viewports", params + ",mode=ViewPort+drawBuffer", [&](long long n) {
+			DisplayBuffer buffer(width, height);
+			RendererProgram program(buffer);
+			upload(program);
+			for (long long k = 0 ; k < n ; k++)
+				for (int i = 0 ; i < plots ; i++)
+				{
+					program.viewport = cell(i);
+					program.proj = Mat4x4f::IDENTITY;
+					program.modelview = Mat4x4f::IDENTITY;
+					math::scale(program.modelview, 1, 0.5f + 0.5f * (i % 2), 1);
+					program.drawBuffer(i + 1, LINE_STRIP, 0, samples);
+				}
+			return n;
+		});
+		vector<ViewportDraw> draws;
+		for (int i = 0 ; i < plots ; i++)
+			draws.push_back({ (unsigned int)i, (unsigned int)i + 1, LINE_STRIP, 0,
+							(unsigned int)samples });
+		for (unsigned int threads : { 1u, 0u })
+		{
+			bench("viewports", params + ",mode=drawViewports,threads="
+					+ (threads ? to_string(threads) : string("hardware")), [&](long long n) {
+				DisplayBuffer buffer(width, height);
+				RendererProgram program(buffer);
+				upload(program);
+				for (long long k = 0 ; k < n ; k++)
+					program.drawViewports(draws.data(), draws.size(), threads);
+				return n;
+			});
+		}
+	}
+}
+
+void benchBlit(void)
+{
+	// composing a 256x256 plot into the display, as is and scaled up twice
+	static const struct { const char* name; BlitFilter filter; BlendMode blend; int scale; }
+	cases[] = {
+		{ "filter=nearest,blend=replace,scale=1", BLIT_NEAREST, BLEND_REPLACE, 1 },
+		{ "filter=nearest,blend=alpha,scale=1", BLIT_NEAREST, BLEND_ALPHA, 1 },
+		{ "filter=nearest,blend=replace,scale=2", BLIT_NEAREST, BLEND_REPLACE, 2 },
+		{ "filter=bilinear,blend=alpha,scale=2", BLIT_BILINEAR, BLEND_ALPHA, 2 } };
+	for (const auto& c : cases)
+	{
+		bench("blit", c.name, [&](long long n) {
+			DisplayBuffer buffer(1024, 1024);
+			RendererProgram program(buffer);
+			program.createTarget(1, 256, 256);
+			program.setRenderTarget(1);
+			program.clear_color = 0x80336699;
+			program.raw_clear();
+			program.setRenderTarget(0);
+			program.setBlendMode(c.blend);
+			const int size = 256 * c.scale;
+			for (long long k = 0 ; k < n ; k++)
+			{
+				const int x = (int)(k & 3) * 64, y = (int)((k >> 2) & 3) * 64;
+				program.blit(1, Region2i(256, 256), Region2i(x, x + size, y, y + size), c.filter);
+			}
+			return n;
+		});
+	}
+}
+
+void benchResolve(void)
+{
+	// resolving a fully changed 640x480 display, after drawing at 2x and 4x
+	static const struct { int factor; unsigned int threads; } cases[] = {
+		{ 2, 1 }, { 2, 0 }, { 4, 1 }, { 4, 0 } };
+	for (const auto& c : cases)
+	{
+		const string params = "factor=" + to_string(c.factor)
+				+ ",threads=" + (c.threads ? to_string(c.threads) : string("all"));
+		bench("resolve", params, [&](long long n) {
+			DisplayBuffer buffer(640, 480);
+			RendererProgram program(buffer);
+			program.setSupersampling(c.factor);
+			for (long long i = 0 ; i < n ; i++)
+			{
+				program.clear_color = 0xFF000000 | (unsigned int)i;
+				program.raw_clear();
+				program.resolve(c.threads);
+			}
+			return n;
+		});
+	}
+}
+
+void benchText(void)
+{
+	// tick labels of a plot, drawn at once, with the built-in font and a blended one
+	static const struct { const char* name; unsigned int labels; bool smooth; } cases[] = {
+		{ "labels=100,font=builtin", 100, false },
+		{ "labels=5000,font=builtin", 5000, false },
+		{ "labels=5000,font=smooth", 5000, true } };
+	vector<string> texts(5000);
+	for (size_t i = 0 ; i < texts.size() ; i++)
+		texts[i] = to_string(i * 0.25);
+	// a font of 8x12 cells of coverage ramps
+	vector<unsigned char> atlas(16 * 8 * 6 * 12);
+	for (size_t i = 0 ; i < atlas.size() ; i++)
+		atlas[i] = (i * 37) % 5 * 63;
+	for (const auto& c : cases)
+	{
+		bench("text", c.name, [&](long long n) {
+			DisplayBuffer buffer(1280, 960);
+			RendererProgram program(buffer);
+			const unsigned int font = c.smooth ? 1 : 0;
+			program.createFont(1, Font(atlas.data(), 16 * 8, 6 * 12, 8, 12, ' '));
+			program.proj = Mat4x4f::IDENTITY;
+			program.modelview = Mat4x4f::IDENTITY;
+			vector<TextLabel> labels(c.labels);
+			for (unsigned int i = 0 ; i < c.labels ; i++)
+				labels[i] = { Vector4f((i % 50) / 25.f - 1, 0.95f - (i / 50) / 55.f, 0, 1),
+							texts[i].c_str(), 0, 0 };
+			for (long long i = 0 ; i < n ; i++)
+				program.drawText(font, labels.data(), c.labels);
+			return n * c.labels;
+		});
+	}
+}
+
+void benchPlot(void)
+{
+	// a 100x100 grid over a 1280x960 plot, as one operation and as separate lines
+	for (int native = 1 ; native >= 0 ; native--)
+	{
+		bench("plot", native ? "grid=native" : "grid=lines", [&](long long n) {
+			DisplayBuffer buffer(1280, 960);
+			RendererProgram program(buffer);
+			program.proj = Mat4x4f::IDENTITY;
+			program.modelview = Mat4x4f::IDENTITY;
+			for (long long i = 0 ; i < n ; i++)
+			{
+				if (native)
+				{
+					program.drawGrid(-1, 1, -1, 1, 0.02f, 0.02f);
+					continue;
+				}
+				for (int k = -50 ; k <= 50 ; k++)
+				{
+					program.drawLine(Vector4f(k * 0.02f, -1, 0, 1), Vector4f(k * 0.02f, 1, 0, 1));
+					program.drawLine(Vector4f(-1, k * 0.02f, 0, 1), Vector4f(1, k * 0.02f, 0, 1));
+				}
+			}
+			return n;
+		});
+	}
+}
+
+void benchClear(void)
+{
+	static const int resolutions[][2] = { {320, 240}, {640, 480}, {1920, 1080} };
+	for (const auto& res : resolutions)
+	{
+		const string params = "resolution=" + to_string(res[0]) + "x" + to_string(res[1]);
+		bench("clear", params, [&](long long n) {
+			DisplayBuffer buffer(res[0], res[1]);
+			RendererProgram program(buffer);
+			for (long long i = 0 ; i < n ; i++)
+				program.raw_clear();
+			return n;
+		});
+	}
+}
+
+#ifdef Derplotter_PROFILE
+/** Prints the profiling counters of a renderer as a JSON line */
+void printStats(const char* name, const string& params, const RendererStats& s)
+{
+	printf("{\"profile\":\"%s\",\"params\":\"%s\",\"ops\":{", name, params.c_str());
+	bool first = true;
+	for (int i = 0 ; i < OPERATION_TYPE_COUNT ; i++)
+	{
+		if (s.op_count[i] == 0) continue;
+		printf("%s\"%s\":{\"count\":%llu,\"ns\":%llu}", first ? "" : ",",
+				operationName((OperationType)i), s.op_count[i], s.op_time[i]);
+		first = false;
+	}
+	printf("},\"pixels_written\":%llu,\"primitives_culled\":%llu,"
+			"\"queue_high_water\":%llu,\"producer_wait_ns\":%llu,\"ops_dropped\":%llu}\n",
+			s.pixels_written, s.primitives_culled, s.queue_high_water, s.producer_wait,
+			s.ops_dropped);
+	fflush(stdout);
+}
+#endif
+
+void benchFrames(void)
+{
+	static const int resolutions[][2] = { {320, 240}, {640, 480}, {1920, 1080} };
+	for (const auto& res : resolutions)
+	{
+		const string params = "resolution=" + to_string(res[0]) + "x" + to_string(res[1]);
+		bench("frame", params, [&](long long n) {
+			Renderer renderer(res[0], res[1]);
+			setCamera(renderer, res[0], res[1]);
+			for (long long i = 0 ; i < n ; i++)
+			{
+				drawScene(renderer, (int)i);
+				renderer.flush();
+			}
+			renderer.terminate();
+#ifdef Derplotter_PROFILE
+			if (n == 1) printStats("frame", params, renderer.stats());
+#endif
+			return n;
+		});
+	}
+
+	// the same frames recorded in a command buffer, with and without optimizing it
+	for (int optimize = 0 ; optimize < 2 ; optimize++)
+	{
+		const string params = "resolution=640x480,commandBuffer,optimize=" + to_string(optimize);
+		bench("frame", params, [&](long long n) {
+			Renderer renderer(640, 480);
+			setCamera(renderer, 640, 480);
+			CommandBuffer buffer;
+			for (long long i = 0 ; i < n ; i++)
+			{
+				drawScene(buffer, (int)i);
+				if (optimize) buffer.optimize();
+				renderer.submit(buffer);
+				renderer.flush();
+			}
+			renderer.terminate();
+#ifdef Derplotter_PROFILE
+			if (n == 1) printStats("frame", params, renderer.stats());
+#endif
+			return n;
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1) min_seconds = atof(argv[1]);
+	if (argc > 2) filter = argv[2];
+	trace::setThreadName("Bench");
+
+	benchSubmission();
+	benchTransform();
+	benchLines();
+	benchBatches();
+	benchMeshes();
+	benchViewports();
+	benchBlit();
+	benchResolve();
+	benchText();
+	benchPlot();
+	benchClear();
+	benchFrames();
+
+#ifdef Derplotter_TRACE
+	trace::dump("Bench.trace.json");
+#endif
+	return 0;
+}
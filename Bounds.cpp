@@ -0,0 +1,102 @@
+/** \file Bounds.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+
+#include "Bounds.h"
+
+#include <math.h>
+
+using namespace derplot::math;
+
+Bounds::Bounds(void)
+:	center(0, 0, 0, 1)
+,	extent(0, 0, 0, 0)
+,	kind(NONE)
+{}
+
+Bounds Bounds::box(const Vector4f& min, const Vector4f& max)
+{
+	Bounds b;
+	b.kind = BOX;
+	b.center = Vector4f((min.x() + max.x()) * 0.5f, (min.y() + max.y()) * 0.5f,
+						(min.z() + max.z()) * 0.5f);
+	b.extent = Vector4f(fabsf(max.x() - min.x()) * 0.5f, fabsf(max.y() - min.y()) * 0.5f,
+						fabsf(max.z() - min.z()) * 0.5f, 0);
+	return b;
+}
+
+Bounds Bounds::box(const float* xyz, unsigned int count)
+{
+	if (count == 0) return Bounds();
+	Vector4f min(xyz[0], xyz[1], xyz[2]), max(min);
+	for (unsigned int i = 1 ; i < count ; i++)
+	{
+		const float* p = xyz + i*3;
+		for (int k = 0 ; k < 3 ; k++)
+		{
+			if (p[k] < min[k]) min.data()[k] = p[k];
+			if (p[k] > max[k]) max.data()[k] = p[k];
+		}
+	}
+	return box(min, max);
+}
+
+Bounds Bounds::box(const Vector4f* points, unsigned int count)
+{
+	if (count == 0) return Bounds();
+	Vector4f min(points[0]), max(points[0]);
+	for (unsigned int i = 1 ; i < count ; i++)
+		for (int k = 0 ; k < 3 ; k++)
+		{
+			if (points[i][k] < min[k]) min.data()[k] = points[i][k];
+			if (points[i][k] > max[k]) max.data()[k] = points[i][k];
+		}
+	return box(min, max);
+}
+
+Bounds Bounds::sphere(const Vector4f& center, float radius)
+{
+	Bounds b;
+	b.kind = SPHERE;
+	b.center = Vector4f(center.x(), center.y(), center.z());
+	b.extent = Vector4f(radius, radius, radius, 0);
+	return b;
+}
+
+Frustum::Frustum(const Mat4x4f& mvp)
+{
+	// each plane combines the last row of the matrix with one of the others
+	for (unsigned int i = 0 ; i < 6 ; i++)
+	{
+		const unsigned int row = i / 2;
+		const float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+		float p[4];
+		for (unsigned int col = 0 ; col < 4 ; col++)
+			p[col] = mvp.at(3, col) + sign * mvp.at(row, col);
+
+		const float len = sqrtf(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+		if (len > 0)
+			for (int k = 0 ; k < 4 ; k++) p[k] /= len;
+		this->planes[i] = Vector4f(p[0], p[1], p[2], p[3]);
+	}
+}
+
+Frustum::Visibility Frustum::classify(const Bounds& bounds) const
+{
+	if (bounds.getKind() == Bounds::NONE) return INTERSECTS;
+
+	const Vector4f& c = bounds.getCenter();
+	const Vector4f& e = bounds.getExtent();
+	Visibility result = INSIDE;
+	for (const Vector4f& p : this->planes)
+	{
+		// signed distance of the center, and the distance covered by the volume
+		const float d = p.x()*c.x() + p.y()*c.y() + p.z()*c.z() + p.w();
+		const float r = (bounds.getKind() == Bounds::SPHERE) ? e.x()
+				: fabsf(p.x())*e.x() + fabsf(p.y())*e.y() + fabsf(p.z())*e.z();
+		if (d + r < 0) return OUTSIDE;
+		if (d - r < 0) result = INTERSECTS;
+	}
+	return result;
+}
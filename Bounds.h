@@ -0,0 +1,115 @@
+/** \file Bounds.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ *
+ * \brief Contains the bounding volumes of batches of geometry, and the
+ * view frustum they are tested against.
+ */
+#pragma once
+
+#include "Mat4x4f.h"
+#include "Vector4f.h"
+
+namespace derplot
+{
+
+namespace math
+{
+
+/**
+ * \brief Describes an axis-aligned bounding box or a bounding sphere, in
+ * object coordinates.
+ */
+class Bounds
+{
+	public:
+		/** The kind of bounding volume */
+		enum Kind : unsigned char
+		{
+			NONE = 0, ///< no bounds (the geometry is never culled as a whole)
+			BOX,      ///< axis-aligned bounding box
+			SPHERE    ///< bounding sphere
+		};
+
+		/** Builds empty bounds, which never cull anything */
+		Bounds(void);
+
+		/** Builds an axis-aligned bounding box from two opposite corners
+		 * \param min the corner with the lowest coordinates
+		 * \param max the corner with the highest coordinates
+		 */
+		static Bounds box(const Vector4f& min, const Vector4f& max);
+
+		/** Builds an axis-aligned bounding box containing a list of points
+		 * \param xyz the X, Y and Z coordinates of each point, contiguously
+		 * \param count the number of points
+		 */
+		static Bounds box(const float* xyz, unsigned int count);
+
+		/** Builds an axis-aligned bounding box containing a list of points
+		 * \param points the points (their W components are ignored)
+		 * \param count the number of points
+		 */
+		static Bounds box(const Vector4f* points, unsigned int count);
+
+		/** Builds a bounding sphere
+		 * \param center the center of the sphere
+		 * \param radius the radius of the sphere
+		 */
+		static Bounds sphere(const Vector4f& center, float radius);
+
+		/** \return the kind of bounding volume */
+		Kind getKind(void) const { return kind; }
+
+		/** \return the center of the volume */
+		const Vector4f& getCenter(void) const { return center; }
+
+		/** \return the half sizes of the box along each axis, or the radius of the
+		 * sphere in all components */
+		const Vector4f& getExtent(void) const { return extent; }
+
+	private:
+		Vector4f center;
+		Vector4f extent;
+		Kind kind;
+};
+
+/**
+ * \brief Describes the view frustum of a projection and modelview matrix
+ * as 6 planes in object coordinates.
+ *
+ * A point (x,y,z,1) is inside the frustum when its transformation lies within the
+ * normalized device coordinates cube, which is equivalent to being on the positive
+ * side of all 6 planes.
+ */
+class Frustum
+{
+	public:
+		/** Result of testing a bounding volume against the frustum */
+		enum Visibility
+		{
+			OUTSIDE = 0, ///< fully outside, nothing would be drawn
+			INTERSECTS,  ///< partially inside, clipping is needed
+			INSIDE       ///< fully inside, no clipping is needed
+		};
+
+		/** Extracts the frustum planes of a transformation
+		 * \param mvp the product of the projection and modelview matrices
+		 */
+		explicit Frustum(const Mat4x4f& mvp);
+
+		/** Tests a bounding volume against the frustum. Empty bounds always
+		 * intersect the frustum.
+		 * \param bounds the bounding volume, in object coordinates
+		 */
+		Visibility classify(const Bounds& bounds) const;
+
+	private:
+		// (a,b,c,d) of each plane ax + by + cz + d >= 0, normalized so that
+		// (a,b,c) has unit length when possible: left, right, bottom, top, near, far
+		Vector4f planes[6];
+};
+
+};
+
+};
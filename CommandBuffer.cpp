@@ -0,0 +1,253 @@
+/** \file CommandBuffer.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+
+#include "CommandBuffer.h"
+
+#include <algorithm>
+
+using namespace derplot;
+using namespace math;
+using namespace op;
+
+namespace
+{
+	typedef std::vector<std::unique_ptr<RendererOperation>> OpList;
+
+	// operations that fully define a part of the state, used by no other state operation
+	bool isStateOp(OperationType type)
+	{
+		return type == OP_FRONT_COLOR || type == OP_CLEAR_COLOR
+			|| type == OP_VIEWPORT || type == OP_BLEND_MODE || type == OP_SCISSOR;
+	}
+
+	// operations after which the viewport and scissor region are those of another target,
+	// or are rescaled to another sample grid
+	bool switchesRegions(OperationType type)
+	{
+		return type == OP_RENDER_TARGET || type == OP_DELETE_TARGET
+			|| type == OP_SUPERSAMPLING;
+	}
+
+	bool isMatrixOp(const RendererOperation& op)
+	{
+		Mat4x4f mat;
+		int matrix;
+		return op.matrixEffect(mat, matrix) != MATRIX_NONE;
+	}
+
+	bool isIdentity(const Mat4x4f& mat)
+	{
+		for (unsigned int i = 0 ; i < 4*4 ; i++)
+			if (mat.get(i) != Mat4x4f::IDENTITY.get(i)) return false;
+		return true;
+	}
+
+	// the vertices of each primitive of a batch that can be merged
+	unsigned int primitiveSize(RendererDrawMode mode)
+	{
+		switch (mode)
+		{
+			case POINTS: case BIG_POINTS: return 1;
+			case LINES: return 2;
+			case TRIANGLES: return 3;
+			default: return 0;
+		}
+	}
+
+	void removeNull(OpList& ops)
+	{
+		ops.erase(std::remove(ops.begin(), ops.end(), nullptr), ops.end());
+	}
+
+	// removes state changes that repeat the current value, or that are replaced
+	// before any operation uses them
+	void collapseState(OpList& ops)
+	{
+		const size_t none = ops.size();
+		std::vector<size_t> last(OPERATION_TYPE_COUNT, none); // last change of each kind
+		std::vector<bool> used(OPERATION_TYPE_COUNT, false);
+		for (size_t i = 0 ; i < ops.size() ; i++)
+		{
+			const OperationType type = ops[i]->getType();
+			if (!isStateOp(type))
+			{
+				if (!isMatrixOp(*ops[i])) // matrix operations use no state
+					std::fill(used.begin(), used.end(), true);
+				if (switchesRegions(type)) // the regions set before no longer apply
+					last[OP_VIEWPORT] = last[OP_SCISSOR] = none;
+				continue;
+			}
+			const size_t prev = last[type];
+			if (prev != none && ops[i]->sameState(*ops[prev]))
+			{
+				ops[i].reset();
+				continue;
+			}
+			if (prev != none && !used[type])
+				ops[prev].reset();
+			last[type] = i;
+			used[type] = false;
+		}
+		removeNull(ops);
+	}
+
+	// folds each run of matrix operations into at most one operation per matrix;
+	// state operations within the run are kept before it, as neither depends on the other
+	void foldMatrices(OpList& ops)
+	{
+		OpList out;
+		out.reserve(ops.size());
+		for (size_t i = 0 ; i < ops.size() ; )
+		{
+			if (!isMatrixOp(*ops[i]))
+			{
+				out.push_back(std::move(ops[i++]));
+				continue;
+			}
+
+			struct Fold
+			{
+				MatrixEffect effect;
+				Mat4x4f mat;
+				size_t count, last;
+			} folds[2] = {};
+			int order[2], targets = 0;
+			size_t j = i;
+			for ( ; j < ops.size() ; j++)
+			{
+				Mat4x4f mat;
+				int matrix;
+				const MatrixEffect effect = ops[j]->matrixEffect(mat, matrix);
+				if (effect == MATRIX_NONE)
+				{
+					if (!isStateOp(ops[j]->getType())) break;
+					out.push_back(std::move(ops[j]));
+					continue;
+				}
+				Fold& f = folds[matrix];
+				if (f.count == 0)
+					order[targets++] = matrix;
+				if (f.count == 0 || effect == MATRIX_LOAD)
+				{
+					f.effect = effect;
+					f.mat = mat;
+				}
+				else
+					f.mat *= mat;
+				f.count++;
+				f.last = j;
+			}
+
+			for (int t = 0 ; t < targets ; t++)
+			{
+				const int matrix = order[t];
+				Fold& f = folds[matrix];
+				if (f.effect == MATRIX_MULTIPLY && isIdentity(f.mat))
+					continue; // cancelled out
+				if (f.count == 1)
+					out.push_back(std::move(ops[f.last]));
+				else if (f.effect == MATRIX_LOAD)
+					out.emplace_back(new MatrixSet(f.mat, matrix));
+				else
+					out.emplace_back(new MatrixMultiply(f.mat, matrix));
+			}
+			i = j;
+		}
+		ops.swap(out);
+	}
+
+	// merges adjacent draws of independent primitives of the same kind
+	void mergeDraws(OpList& ops)
+	{
+		OpList out;
+		out.reserve(ops.size());
+		for (size_t i = 0 ; i < ops.size() ; )
+		{
+			VertexBatch first, next;
+			if (!ops[i]->vertexBatch(first) || primitiveSize(first.mode) == 0)
+			{
+				out.push_back(std::move(ops[i++]));
+				continue;
+			}
+
+			// a batch is only followed by another if it has no incomplete primitive
+			size_t j = i + 1;
+			VertexBatch prev = first;
+			while (j < ops.size() && prev.count % primitiveSize(prev.mode) == 0
+					&& ops[j]->vertexBatch(next) && next.mode == first.mode
+					&& (next.colors == nullptr) == (first.colors == nullptr))
+			{
+				prev = next;
+				j++;
+			}
+			if (j - i < 2)
+			{
+				out.push_back(std::move(ops[i++]));
+				continue;
+			}
+
+			std::vector<Vector4f> vertices;
+			std::vector<unsigned int> colors;
+			for (size_t k = i ; k < j ; k++)
+			{
+				ops[k]->vertexBatch(next);
+				vertices.insert(vertices.end(), next.vertices, next.vertices + next.count);
+				if (next.colors)
+					colors.insert(colors.end(), next.colors, next.colors + next.count);
+			}
+			const Bounds bounds = Bounds::box(vertices.data(), vertices.size());
+			out.emplace_back(new DrawArrays(first.mode, std::move(vertices),
+											std::move(colors), bounds));
+			i = j;
+		}
+		ops.swap(out);
+	}
+}
+
+CommandBuffer::CommandBuffer()
+{}
+
+CommandBuffer::~CommandBuffer()
+{}
+
+CommandBuffer::CommandBuffer(CommandBuffer&& other)
+:	ops(std::move(other.ops))
+{}
+
+CommandBuffer& CommandBuffer::operator=(CommandBuffer&& other)
+{
+	this->ops = std::move(other.ops);
+	return *this;
+}
+
+size_t CommandBuffer::size(void) const
+{
+	return this->ops.size();
+}
+
+bool CommandBuffer::empty(void) const
+{
+	return this->ops.empty();
+}
+
+void CommandBuffer::reset(void)
+{
+	this->ops.clear();
+}
+
+size_t CommandBuffer::optimize(void)
+{
+	const size_t before = this->ops.size();
+	collapseState(this->ops);
+	foldMatrices(this->ops);
+	mergeDraws(this->ops);
+	return before - this->ops.size();
+}
+
+int CommandBuffer::enqueue(op::RendererOperation* op)
+{
+	this->ops.emplace_back(op);
+	return 0;
+}
@@ -0,0 +1,88 @@
+/** \file CommandBuffer.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \class derplot::CommandBuffer
+ * \brief Records renderer operations for submitting them to a renderer later.
+ *
+ * A command buffer has the same invocation functions of the renderer, but merely
+ * records the operations, without any synchronization. Several threads can therefore
+ * build parts of a frame at the same time, each one recording into its own command
+ * buffer, which are then submitted to the renderer in a defined order with
+ * <tt>Renderer::submit()</tt>.
+ *
+ * A command buffer must only be used by one thread at a time. The operations of a
+ * command buffer change the state of the renderer (such as the matrices and colors)
+ * when executed, like the operations invoked directly on the renderer. Command buffers
+ * that may be submitted in any order should therefore define the state they depend on.
+ *
+ * Command buffers are single-use: submitting a buffer moves its operations to the
+ * renderer and leaves it empty, ready for recording the next frame. Recorded operations
+ * can be simplified with \c optimize() before submitting them, which pays off for long
+ * buffers with redundant state changes or many small draws.
+ */
+#pragma once
+
+#include "RendererInvoker.h"
+#include <memory>
+#include <vector>
+
+namespace derplot
+{
+
+class Renderer;
+
+class CommandBuffer : public RendererInvoker
+{
+	private:
+		std::vector<std::unique_ptr<op::RendererOperation>> ops;
+
+	public:
+		/** Default constructor */
+		CommandBuffer();
+
+		/** Default destructor */
+		~CommandBuffer();
+
+		/** No Copy Constructor */
+		CommandBuffer(const CommandBuffer& other) = delete;
+		/** No Copy Assignment operator */
+		CommandBuffer& operator=(const CommandBuffer& other) = delete;
+
+		/** Move constructor */
+		CommandBuffer(CommandBuffer&& other);
+		/** Move Assignment operator */
+		CommandBuffer& operator=(CommandBuffer&& other);
+
+		/** \return the number of recorded operations */
+		size_t size(void) const;
+
+		/** \return whether no operations are recorded */
+		bool empty(void) const;
+
+		/** Discards all recorded operations */
+		void reset(void);
+
+		/** Rewrites the recorded operations into fewer operations with the same
+		 * effect, in three steps:
+		 * - state changes (front color, clear color, viewport, scissor and blend
+		 * mode) that set the same value again, or that are replaced before anything
+		 * uses them, are removed;
+		 * - consecutive operations on the same matrix are folded into a single matrix,
+		 * and removed altogether if they cancel out exactly;
+		 * - adjacent points, lines and unconnected batches of the same kind are merged
+		 * into a single batch, with a bounding box for culling.
+		 *
+		 * The state left by the buffer is kept. As the folded transformations are
+		 * multiplied in a different order, the drawn pixels may differ slightly from
+		 * the original operations due to rounding.
+		 * \return the number of operations removed
+		 */
+		size_t optimize(void);
+
+	protected:
+		int enqueue(op::RendererOperation* op);
+
+		friend class Renderer;
+};
+
+};
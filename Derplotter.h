@@ -65,9 +65,12 @@
 #include "MathUtils.h"
 #include "Vector4f.h"
 #include "Mat4x4f.h"
+#include "MatrixStack.h"
+#include "Bounds.h"
 #include "Region2i.h"
 
 // derplot (base rendering component)
 #include "Renderer.h"
+#include "Trace.h"
 
 #endif
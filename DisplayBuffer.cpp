@@ -4,51 +4,92 @@
  */
 #include "DisplayBuffer.h"
 
+#include "RasterKernels.h"
 #include <string.h>
+#include <limits.h>
 
 using namespace derplot;
 
+namespace
+{
+	template <PixelFormat F>
+	void readKernel(const unsigned char* row, int length,
+					unsigned int* out, const unsigned int* palette)
+	{
+		typedef PixelTraits<F> T;
+		const typename T::type* p = reinterpret_cast<const typename T::type*>(row);
+		for (int i = 0 ; i < length ; i++)
+			out[i] = T::unpack(p[i], palette);
+	}
+
+	typedef void (*ReadKernel)(const unsigned char*, int, unsigned int*, const unsigned int*);
+
+	const ReadKernel READ_KERNELS[PIXEL_FORMAT_COUNT] = {
+		readKernel<PIXEL_ARGB8888>, readKernel<PIXEL_ABGR8888>,
+		readKernel<PIXEL_RGB565>, readKernel<PIXEL_GRAY8>, readKernel<PIXEL_INDEXED8> };
+}
+
 DisplayBuffer::DisplayBuffer()
 :	width(0)
 ,	height(0)
+,	pitch(0)
+,	format(PIXEL_ARGB8888)
 ,	buff(nullptr)
 ,	inner_buff(nullptr)
 {}
 
-DisplayBuffer::DisplayBuffer(int width, int height, void* extern_buffer)
+DisplayBuffer::DisplayBuffer(int width, int height, void* extern_buffer,
+								int pitch, PixelFormat format)
 :	width(width)
 ,	height(height)
-,	buff((unsigned int*)extern_buffer)
+,	pitch((pitch > 0) ? pitch : width*bytesPerPixel(format))
+,	format(format)
+,	buff((unsigned char*)extern_buffer)
 ,	inner_buff(nullptr)
 {
+	// rows are accessed as arrays of pixels, so the pitch must hold whole pixels
+	const int bpp = bytesPerPixel(format);
+	if (bpp == 0 || width < 0 || height < 0
+		|| this->pitch < (long long)width*bpp || this->pitch % bpp != 0)
+	{
+		this->buff = nullptr; // unusable buffer
+		return;
+	}
 	if (extern_buffer == nullptr)
-		this->inner_buff = new unsigned int[width*height];
+		this->inner_buff = new unsigned char[(size_t)this->pitch*height];
 }
 
 DisplayBuffer::~DisplayBuffer()
 {
 	if (inner_buff)
-		delete inner_buff;
+		delete[] inner_buff;
 }
 
 DisplayBuffer::DisplayBuffer(DisplayBuffer&& other)
 :	width(other.width)
 ,	height(other.height)
+,	pitch(other.pitch)
+,	format(other.format)
 ,	buff(other.buff)
 ,	inner_buff(other.inner_buff)
+,	palette(std::move(other.palette))
 {
-	other.width = other.height = 0;
+	other.width = other.height = other.pitch = 0;
 	other.inner_buff = other.buff = nullptr;
 }
 
 DisplayBuffer& DisplayBuffer::operator=(DisplayBuffer&& other)
 {
 	if (this == &other) return *this;
+	if (this->inner_buff) delete[] this->inner_buff;
 	this->width = other.width;
 	this->height = other.height;
+	this->pitch = other.pitch;
+	this->format = other.format;
 	this->buff = other.buff;
 	this->inner_buff = other.inner_buff;
-	other.width = other.height = 0;
+	this->palette = std::move(other.palette);
+	other.width = other.height = other.pitch = 0;
 	other.buff = other.inner_buff = nullptr;
 	return *this;
 }
@@ -64,39 +105,102 @@ int DisplayBuffer::getWidth(void) const
 int DisplayBuffer::getHeight(void) const
 { return this->height; }
 
-const unsigned int* DisplayBuffer::data(void) const
+int DisplayBuffer::getPitch(void) const
+{ return this->pitch; }
+
+PixelFormat DisplayBuffer::getFormat(void) const
+{ return this->format; }
+
+const void* DisplayBuffer::data(void) const
 {
 	return (this->buff != nullptr) ? buff : inner_buff;
 }
 
-bool DisplayBuffer::indexOf(unsigned int x, unsigned int y, unsigned int& ind) const
+unsigned char* DisplayBuffer::pixels(void)
+{
+	return this->usedbuffer();
+}
+
+bool DisplayBuffer::indexOf(unsigned int x, unsigned int y, size_t& ind) const
 {
 	if ((int)x >= width || (int)y >= height) return false;
-	ind = this->width*y+x;
+	ind = (size_t)this->pitch*y + (size_t)x*bytesPerPixel(this->format);
 	return true;
 }
 
+const unsigned int* DisplayBuffer::readRow(int y, unsigned int* scratch) const
+{
+	const unsigned char* row = (const unsigned char*)this->data() + (long long)pitch*y;
+	if (this->format == PIXEL_ARGB8888)
+		return (const unsigned int*)row;
+	READ_KERNELS[this->format](row, this->width, scratch,
+			this->palette.empty() ? nullptr : this->palette.data());
+	return scratch;
+}
+
+void DisplayBuffer::setPalette(const unsigned int* colors, int count)
+{
+	this->palette.assign(256, 0xFF000000);
+	if (count > 256) count = 256;
+	for (int i = 0 ; i < count ; i++)
+		this->palette[i] = colors[i];
+}
+
 bool DisplayBuffer::clear(unsigned int color)
 {
 	if (!(*this)) return false;
-	for (int i = 0 ; i < width*height ; i++)
-		this->usedbuffer()[i] = color;
+	const RasterKernels& kernels = rasterKernels(this->format, BLEND_REPLACE);
+	if (pitch == width*bytesPerPixel(format) // no padding, fill it all at once
+		&& (long long)width*height <= INT_MAX)
+		kernels.span(this->usedbuffer(), 0, width*height, color);
+	else
+	{
+		unsigned char* row = this->usedbuffer();
+		for (int y = 0 ; y < height ; y++, row += pitch)
+			kernels.span(row, 0, width, color);
+	}
 	return true;
 }
 
+bool DisplayBuffer::clear(unsigned int color, const math::Region2i& region)
+{
+	if (!(*this)) return false;
+	math::Region2i r = region;
+	r.intersect(math::Region2i(width, height));
+	if (r.isEmpty()) return true;
+	const RasterKernels& kernels = rasterKernels(this->format, BLEND_REPLACE);
+	const int length = r.getMaxX() - r.getMinX();
+	unsigned char* row = this->usedbuffer() + (long long)pitch*r.getMinY();
+	for (int y = r.getMinY() ; y < r.getMaxY() ; y++, row += pitch)
+		kernels.span(row, r.getMinX(), length, color);
+	return true;
+}
 
 bool DisplayBuffer::plot(int x, int y, unsigned int color)
 {
 	if (!(*this)) return false;
-	if (x < 0 || y < 0) return false;
-	unsigned int ind = 0;
-	if (!this->indexOf(x,y,ind))
-		return false;
-	this->usedbuffer()[ind] = color;
+	if (x < 0 || y < 0 || x >= width || y >= height) return false;
+	rasterKernels(this->format, BLEND_REPLACE).plot(this->usedbuffer() + (long long)pitch*y, x, color);
+	return true;
+}
+
+bool DisplayBuffer::span(int x, int y, int length, unsigned int color)
+{
+	if (!(*this)) return false;
+	if (y < 0 || y >= height) return false;
+	if (x < 0)
+	{
+		length += x;
+		x = 0;
+	}
+	if (x + length > width) length = width - x;
+	if (length <= 0) return false;
+	rasterKernels(this->format, BLEND_REPLACE).span(
+			this->usedbuffer() + (long long)pitch*y, x, length, color);
 	return true;
 }
 
-unsigned int* DisplayBuffer::usedbuffer(void)
+unsigned char* DisplayBuffer::usedbuffer(void)
 {
 	return (this->buff != nullptr) ? buff : inner_buff;
 }
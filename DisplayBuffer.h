@@ -3,10 +3,22 @@
  * \date 2013
  * \class derplot::DisplayBuffer
  * \brief Abstraction of a display buffer, with simple access functions.
+ *
+ * The buffer's pixels may be stored in any of the formats in \c PixelFormat , and
+ * rows may be padded: the pitch is the distance in bytes between the start of two
+ * consecutive rows. This allows the renderer to draw directly onto external surfaces
+ * (such as a window's framebuffer). The pitch must be a multiple of the pixel size.
+ * Colors are always given to the buffer as 32-bit ARGB values, and converted to the
+ * buffer's pixel format by kernels specialized for each format (see RasterKernels.h).
  */
 
 #pragma once
 
+#include "Region2i.h"
+#include "PixelFormat.h"
+#include <vector>
+#include <stddef.h>
+
 namespace derplot
 {
 
@@ -15,8 +27,11 @@ class DisplayBuffer
 	private:
 		int width;
 		int height;
-		unsigned int* buff;
-		unsigned int* inner_buff;
+		int pitch;
+		PixelFormat format;
+		unsigned char* buff;
+		unsigned char* inner_buff;
+		std::vector<unsigned int> palette;
 
 	public:
 		/** Default constructor */
@@ -25,9 +40,14 @@ class DisplayBuffer
 		/** Main Constructor
 		 * \param width
 		 * \param height
-		 * \param extern_buffer
+		 * \param extern_buffer the buffer to draw on, or \c nullptr for
+		 * creating an internal buffer
+		 * \param pitch the number of bytes between the start of two rows, which
+		 * must be a multiple of the size of a pixel, or \c 0 if there is no padding
+		 * \param format the pixel format of the buffer
 		 */
-		DisplayBuffer(int width, int height, void* extern_buffer = nullptr);
+		DisplayBuffer(int width, int height, void* extern_buffer = nullptr,
+						int pitch = 0, PixelFormat format = PIXEL_ARGB8888);
 
 		/** Default destructor */
 		~DisplayBuffer();
@@ -64,18 +84,52 @@ class DisplayBuffer
 		 */
 		int getHeight(void) const;
 
+		/** Getter for the pitch of the buffer
+		 * \return the number of bytes between the start of two rows
+		 */
+		int getPitch(void) const;
+
+		/** Getter for the pixel format of the buffer
+		 * \return the buffer's pixel format
+		 */
+		PixelFormat getFormat(void) const;
+
 		/** Getter for the buffer data pointer
 		 * \return a pointer to the buffer data
 		 */
-		const unsigned int* data(void) const;
+		const void* data(void) const;
+
+		/** Getter for the writable buffer data pointer, used by the rasterizer
+		 * \return a pointer to the first byte of the first row
+		 */
+		unsigned char* pixels(void);
 
 		/**
 		 * \param x
 		 * \param y
-		 * \param output reference of index
+		 * \param output reference of the pixel's offset in bytes
 		 * \return Whether the given coordinates are valid
 		 */
-		bool indexOf(unsigned int x, unsigned int y, unsigned int& ind) const;
+		bool indexOf(unsigned int x, unsigned int y, size_t& ind) const;
+
+		/**
+		 * Retrieves a row of the buffer as 32-bit ARGB colors. If the buffer is
+		 * already in the ARGB8888 format, a pointer to the row itself is returned and
+		 * nothing is copied.
+		 * \param y the row to read
+		 * \param scratch a buffer of at least \c width colors, where the row is
+		 * converted to if needed
+		 * \return a pointer to the row's colors
+		 */
+		const unsigned int* readRow(int y, unsigned int* scratch) const;
+
+		/**
+		 * Defines the palette used for reading colors back from a buffer in
+		 * the \c PIXEL_INDEXED8 format.
+		 * \param colors the ARGB colors of the palette
+		 * \param count the number of colors (up to 256)
+		 */
+		void setPalette(const unsigned int* colors, int count);
 
 
 		/**
@@ -85,6 +139,15 @@ class DisplayBuffer
 		 */
 		bool clear(unsigned int color);
 
+		/**
+		 * Clears a region of the buffer using the given color. The region
+		 * is clipped to the buffer's boundaries.
+		 * \param color the 32-bit ARGB color value.
+		 * \param region the region to clear
+		 * \return whether the operation was successful
+		 */
+		bool clear(unsigned int color, const math::Region2i& region);
+
 		/**
 		 * \param x
 		 * \param y
@@ -93,10 +156,20 @@ class DisplayBuffer
 		 */
 		bool plot(int x, int y, unsigned int color);
 
+		/**
+		 * Draws a horizontal span of pixels, clipped to the buffer's boundaries.
+		 * \param x the first column of the span
+		 * \param y the row of the span
+		 * \param length the number of pixels
+		 * \param color
+		 * \return Whether any pixel was drawn
+		 */
+		bool span(int x, int y, int length, unsigned int color);
+
 	protected:
 	private:
 
-		unsigned int* usedbuffer(void);
+		unsigned char* usedbuffer(void);
 };
 
 };
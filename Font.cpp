@@ -0,0 +1,151 @@
+/** \file Font.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+#include "Font.h"
+
+using namespace derplot;
+
+namespace
+{
+	// glyphs of the built-in font, from ' ' to '~': five columns of seven pixels,
+	// with the top pixel in the lowest bit
+	const unsigned char BUILTIN_GLYPHS[95][5] = {
+		{0x00,0x00,0x00,0x00,0x00}, {0x00,0x00,0x5F,0x00,0x00}, {0x00,0x07,0x00,0x07,0x00},
+		{0x14,0x7F,0x14,0x7F,0x14}, {0x24,0x2A,0x7F,0x2A,0x12}, {0x23,0x13,0x08,0x64,0x62},
+		{0x36,0x49,0x55,0x22,0x50}, {0x00,0x05,0x03,0x00,0x00}, {0x00,0x1C,0x22,0x41,0x00},
+		{0x00,0x41,0x22,0x1C,0x00}, {0x08,0x2A,0x1C,0x2A,0x08}, {0x08,0x08,0x3E,0x08,0x08},
+		{0x00,0x50,0x30,0x00,0x00}, {0x08,0x08,0x08,0x08,0x08}, {0x00,0x60,0x60,0x00,0x00},
+		{0x20,0x10,0x08,0x04,0x02}, {0x3E,0x51,0x49,0x45,0x3E}, {0x00,0x42,0x7F,0x40,0x00},
+		{0x42,0x61,0x51,0x49,0x46}, {0x21,0x41,0x45,0x4B,0x31}, {0x18,0x14,0x12,0x7F,0x10},
+		{0x27,0x45,0x45,0x45,0x39}, {0x3C,0x4A,0x49,0x49,0x30}, {0x01,0x71,0x09,0x05,0x03},
+		{0x36,0x49,0x49,0x49,0x36}, {0x06,0x49,0x49,0x29,0x1E}, {0x00,0x36,0x36,0x00,0x00},
+		{0x00,0x56,0x36,0x00,0x00}, {0x08,0x14,0x22,0x41,0x00}, {0x14,0x14,0x14,0x14,0x14},
+		{0x00,0x41,0x22,0x14,0x08}, {0x02,0x01,0x51,0x09,0x06}, {0x32,0x49,0x79,0x41,0x3E},
+		{0x7E,0x11,0x11,0x11,0x7E}, {0x7F,0x49,0x49,0x49,0x36}, {0x3E,0x41,0x41,0x41,0x22},
+		{0x7F,0x41,0x41,0x22,0x1C}, {0x7F,0x49,0x49,0x49,0x41}, {0x7F,0x09,0x09,0x09,0x01},
+		{0x3E,0x41,0x49,0x49,0x7A}, {0x7F,0x08,0x08,0x08,0x7F}, {0x00,0x41,0x7F,0x41,0x00},
+		{0x20,0x40,0x41,0x3F,0x01}, {0x7F,0x08,0x14,0x22,0x41}, {0x7F,0x40,0x40,0x40,0x40},
+		{0x7F,0x02,0x0C,0x02,0x7F}, {0x7F,0x04,0x08,0x10,0x7F}, {0x3E,0x41,0x41,0x41,0x3E},
+		{0x7F,0x09,0x09,0x09,0x06}, {0x3E,0x41,0x51,0x21,0x5E}, {0x7F,0x09,0x19,0x29,0x46},
+		{0x46,0x49,0x49,0x49,0x31}, {0x01,0x01,0x7F,0x01,0x01}, {0x3F,0x40,0x40,0x40,0x3F},
+		{0x1F,0x20,0x40,0x20,0x1F}, {0x3F,0x40,0x38,0x40,0x3F}, {0x63,0x14,0x08,0x14,0x63},
+		{0x07,0x08,0x70,0x08,0x07}, {0x61,0x51,0x49,0x45,0x43}, {0x00,0x7F,0x41,0x41,0x00},
+		{0x02,0x04,0x08,0x10,0x20}, {0x00,0x41,0x41,0x7F,0x00}, {0x04,0x02,0x01,0x02,0x04},
+		{0x40,0x40,0x40,0x40,0x40}, {0x00,0x01,0x02,0x04,0x00}, {0x20,0x54,0x54,0x54,0x78},
+		{0x7F,0x48,0x44,0x44,0x38}, {0x38,0x44,0x44,0x44,0x20}, {0x38,0x44,0x44,0x48,0x7F},
+		{0x38,0x54,0x54,0x54,0x18}, {0x08,0x7E,0x09,0x01,0x02}, {0x0C,0x52,0x52,0x52,0x3E},
+		{0x7F,0x08,0x04,0x04,0x78}, {0x00,0x44,0x7D,0x40,0x00}, {0x20,0x40,0x44,0x3D,0x00},
+		{0x7F,0x10,0x28,0x44,0x00}, {0x00,0x41,0x7F,0x40,0x00}, {0x7C,0x04,0x18,0x04,0x78},
+		{0x7C,0x08,0x04,0x04,0x78}, {0x38,0x44,0x44,0x44,0x38}, {0x7C,0x14,0x14,0x14,0x08},
+		{0x08,0x14,0x14,0x18,0x7C}, {0x7C,0x08,0x04,0x04,0x08}, {0x48,0x54,0x54,0x54,0x20},
+		{0x04,0x3F,0x44,0x40,0x20}, {0x3C,0x40,0x40,0x20,0x7C}, {0x1C,0x20,0x40,0x20,0x1C},
+		{0x3C,0x40,0x30,0x40,0x3C}, {0x44,0x28,0x10,0x28,0x44}, {0x0C,0x50,0x50,0x50,0x3C},
+		{0x44,0x64,0x54,0x4C,0x44}, {0x00,0x08,0x36,0x41,0x00}, {0x00,0x00,0x7F,0x00,0x00},
+		{0x00,0x41,0x36,0x08,0x00}, {0x08,0x04,0x08,0x10,0x08} };
+
+	constexpr int BUILTIN_CELL_WIDTH = 6, BUILTIN_CELL_HEIGHT = 8;
+}
+
+Font::Font(void)
+:	cell_width(0)
+,	cell_height(0)
+,	first(0)
+,	count(0)
+{}
+
+Font::Font(const unsigned char* atlas, int width, int height,
+			int cell_width, int cell_height, unsigned char first)
+:	cell_width(cell_width)
+,	cell_height(cell_height)
+,	first(first)
+,	count(0)
+{
+	if (atlas == nullptr || cell_width <= 0 || cell_height <= 0
+		|| cell_width > 0x7FFF || cell_height > 0x7FFF) return;
+	const int columns = width / cell_width, rows = height / cell_height;
+	if (columns <= 0 || rows <= 0) return;
+	this->count = columns * rows;
+	if (this->count > 256 - this->first) this->count = 256 - this->first;
+
+	// each row of each glyph is split into runs of equal coverage
+	this->glyphs.reserve(this->count + 1);
+	for (int g = 0 ; g < this->count ; g++)
+	{
+		this->glyphs.push_back(this->spans.size());
+		const unsigned char* cell = atlas + (long long)(g / columns) * cell_height * width
+									+ (g % columns) * cell_width;
+		for (int y = 0 ; y < cell_height ; y++)
+		{
+			const unsigned char* row = cell + (long long)y * width;
+			for (int x = 0 ; x < cell_width ; )
+			{
+				const unsigned char coverage = row[x];
+				int end = x + 1;
+				while (end < cell_width && row[end] == coverage) end++;
+				if (coverage != 0)
+					this->spans.push_back({ (short)x, (short)y, (short)(end - x), coverage });
+				x = end;
+			}
+		}
+	}
+	this->glyphs.push_back(this->spans.size());
+}
+
+const Font& Font::builtin(void)
+{
+	static const Font font = [] {
+		const int count = sizeof(BUILTIN_GLYPHS) / sizeof(BUILTIN_GLYPHS[0]);
+		const int width = count * BUILTIN_CELL_WIDTH;
+		std::vector<unsigned char> atlas(width * BUILTIN_CELL_HEIGHT, 0);
+		for (int g = 0 ; g < count ; g++)
+			for (int x = 0 ; x < 5 ; x++)
+				for (int y = 0 ; y < 7 ; y++)
+					if (BUILTIN_GLYPHS[g][x] & (1 << y))
+						atlas[y * width + g * BUILTIN_CELL_WIDTH + x] = 255;
+		return Font(atlas.data(), width, BUILTIN_CELL_HEIGHT,
+					BUILTIN_CELL_WIDTH, BUILTIN_CELL_HEIGHT, ' ');
+	}();
+	return font;
+}
+
+bool Font::operator!(void) const
+{
+	return this->count == 0;
+}
+
+int Font::getCellWidth(void) const
+{
+	return this->cell_width;
+}
+
+int Font::getCellHeight(void) const
+{
+	return this->cell_height;
+}
+
+bool Font::glyph(unsigned char c, const GlyphSpan*& begin, const GlyphSpan*& end) const
+{
+	const int g = (int)c - this->first;
+	if (g < 0 || g >= this->count) return false;
+	begin = this->spans.data() + this->glyphs[g];
+	end = this->spans.data() + this->glyphs[g+1];
+	return true;
+}
+
+void Font::measure(const char* text, int& width, int& height) const
+{
+	int columns = 0, lines = 1, line = 0;
+	for (const char* c = text ; *c != '\0' ; c++)
+	{
+		if (*c == '\n')
+		{
+			lines++;
+			line = 0;
+		}
+		else if (++line > columns)
+			columns = line;
+	}
+	width = columns * this->cell_width;
+	height = lines * this->cell_height;
+}
@@ -0,0 +1,86 @@
+/** \file Font.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \class derplot::Font
+ * \brief Bitmap font, made of pre-rasterized glyphs.
+ *
+ * The glyphs are taken from an atlas of 8-bit coverage values (0 is transparent,
+ * 255 is opaque), laid out as a grid of equally sized cells, left to right and top
+ * to bottom, for consecutive character codes. On construction, each glyph is
+ * converted to the spans of pixels of equal coverage in each of its rows, so that
+ * drawing text only writes the covered pixels, one span at a time.
+ */
+#pragma once
+
+#include <vector>
+
+namespace derplot
+{
+
+/** \brief A run of pixels of a glyph with the same coverage */
+struct GlyphSpan
+{
+	short x, y;             ///< the first pixel, relative to the top-left corner of the cell
+	short length;           ///< the number of pixels
+	unsigned char coverage; ///< the coverage of all pixels, not 0
+};
+
+class Font
+{
+	private:
+		int cell_width, cell_height;
+		int first, count; // the character codes with a glyph
+		std::vector<GlyphSpan> spans; // of all glyphs, in order
+		std::vector<unsigned int> glyphs; // the first span of each glyph, and the end
+
+	public:
+		/** Default constructor, of a font with no glyphs */
+		Font(void);
+
+		/** Main constructor
+		 * \param atlas the coverage of each pixel of the atlas, row by row
+		 * \param width the width of the atlas
+		 * \param height the height of the atlas
+		 * \param cell_width the width of each glyph, which is also the advance from
+		 * one character to the next
+		 * \param cell_height the height of each glyph, which is also the distance
+		 * between two lines of text
+		 * \param first the character code of the first glyph
+		 */
+		Font(const unsigned char* atlas, int width, int height,
+			int cell_width, int cell_height, unsigned char first = ' ');
+
+		/** \return the font built into the library: printable ASCII characters
+		 * of 5x7 pixels, in cells of 6x8 pixels */
+		static const Font& builtin(void);
+
+		/** Checks whether the font can be used.
+		 * \return \b true iif the font has no glyphs
+		 */
+		bool operator!(void) const;
+
+		/** \return the width of each character */
+		int getCellWidth(void) const;
+
+		/** \return the height of each line of text */
+		int getCellHeight(void) const;
+
+		/** Retrieves the spans of the glyph of a character
+		 * \param c the character code
+		 * \param begin output reference to the first span
+		 * \param end output reference to the end of the spans
+		 * \return whether the font has a glyph for the character (which may
+		 * still have no spans, such as a space)
+		 */
+		bool glyph(unsigned char c, const GlyphSpan*& begin, const GlyphSpan*& end) const;
+
+		/** Measures a text: lines are separated by \c '\\n' , and characters
+		 * without a glyph take as much space as any other
+		 * \param text the null-terminated text
+		 * \param width output reference to the width of the longest line, in pixels
+		 * \param height output reference to the height of all lines, in pixels
+		 */
+		void measure(const char* text, int& width, int& height) const;
+};
+
+};
@@ -0,0 +1,574 @@
+/** \file ImageExport.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+#include "ImageExport.h"
+#include "WorkerPool.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+using namespace derplot;
+
+namespace
+{
+	// minimum number of rows in a PNG band, so that tiny images aren't split
+	constexpr int PNG_MIN_BAND_ROWS = 32;
+
+	// LZ77 parameters
+	constexpr int WINDOW_SIZE = 1 << 15;
+	constexpr int WINDOW_MASK = WINDOW_SIZE - 1;
+	constexpr int HASH_BITS = 15;
+	constexpr int HASH_SIZE = 1 << HASH_BITS;
+	constexpr int MIN_MATCH = 3;
+	constexpr int MAX_MATCH = 258;
+	constexpr int MAX_CHAIN = 16;
+
+	const unsigned short LEN_BASE[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const unsigned char LEN_EXTRA[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const unsigned short DIST_BASE[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+		8193, 12289, 16385, 24577 };
+	const unsigned char DIST_EXTRA[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	unsigned int reverseBits(unsigned int code, int len)
+	{
+		unsigned int r = 0;
+		for (int i = 0 ; i < len ; i++, code >>= 1)
+			r = (r << 1) | (code & 1);
+		return r;
+	}
+
+	/* Lookup tables of the fixed Huffman codes of DEFLATE (RFC 1951, 3.2.6),
+	 * with the codes already bit-reversed for the LSB-first bit writer. */
+	struct FixedHuffman
+	{
+		unsigned short lit_code[288];
+		unsigned char lit_len[288];
+		unsigned char dist_code[30];
+		unsigned char len_symbol[MAX_MATCH+1];
+		unsigned char dist_symbol[WINDOW_SIZE+1];
+
+		FixedHuffman()
+		{
+			for (int i = 0 ; i < 288 ; i++)
+			{
+				unsigned int code; int len;
+				if (i <= 143)      { code = 0x30 + i;          len = 8; }
+				else if (i <= 255) { code = 0x190 + (i - 144); len = 9; }
+				else if (i <= 279) { code = i - 256;           len = 7; }
+				else               { code = 0xC0 + (i - 280);  len = 8; }
+				lit_code[i] = reverseBits(code, len);
+				lit_len[i] = len;
+			}
+			for (int i = 0 ; i < 30 ; i++)
+				dist_code[i] = reverseBits(i, 5);
+
+			int s = 0;
+			for (int len = MIN_MATCH ; len <= MAX_MATCH ; len++)
+			{
+				while (s < 28 && len >= LEN_BASE[s+1]) s++;
+				len_symbol[len] = s;
+			}
+			s = 0;
+			for (int d = 1 ; d <= WINDOW_SIZE ; d++)
+			{
+				while (s < 29 && d >= DIST_BASE[s+1]) s++;
+				dist_symbol[d] = s;
+			}
+		}
+	};
+
+	const FixedHuffman& fixedHuffman(void)
+	{
+		static const FixedHuffman table;
+		return table;
+	}
+
+	/* CRC-32 as used by PNG chunks. The running value is kept
+	 * pre-inverted, the caller must invert the final result. */
+	struct CrcTable
+	{
+		unsigned int t[256];
+		CrcTable()
+		{
+			for (unsigned int n = 0 ; n < 256 ; n++)
+			{
+				unsigned int c = n;
+				for (int k = 0 ; k < 8 ; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				t[n] = c;
+			}
+		}
+	};
+
+	unsigned int crc32(unsigned int crc, const unsigned char* p, size_t len)
+	{
+		static const CrcTable table;
+		for (size_t i = 0 ; i < len ; i++)
+			crc = table.t[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+		return crc;
+	}
+
+	constexpr unsigned int ADLER_BASE = 65521;
+
+	unsigned int adler32(unsigned int adler, const unsigned char* p, size_t len)
+	{
+		unsigned int a = adler & 0xFFFF, b = adler >> 16;
+		while (len > 0)
+		{
+			// largest block that cannot overflow before the modulo
+			size_t n = (len < 5552) ? len : 5552;
+			len -= n;
+			while (n-- > 0)
+			{
+				a += *p++;
+				b += a;
+			}
+			a %= ADLER_BASE;
+			b %= ADLER_BASE;
+		}
+		return (b << 16) | a;
+	}
+
+	/* Combines the checksums of two consecutive sequences,
+	 * where len2 is the length of the second one. */
+	unsigned int adler32Combine(unsigned int adler1, unsigned int adler2, size_t len2)
+	{
+		const unsigned int rem = (unsigned int)(len2 % ADLER_BASE);
+		unsigned int sum1 = adler1 & 0xFFFF;
+		unsigned int sum2 = (rem * sum1) % ADLER_BASE;
+		sum1 += (adler2 & 0xFFFF) + ADLER_BASE - 1;
+		sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+		if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+		if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+		if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+		if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+		return sum1 | (sum2 << 16);
+	}
+
+	void putU32BE(unsigned char* p, unsigned int v)
+	{
+		p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+	}
+
+	void putU32BE(std::vector<unsigned char>& out, unsigned int v)
+	{
+		unsigned char b[4];
+		putU32BE(b, v);
+		out.insert(out.end(), b, b+4);
+	}
+
+	class BitWriter
+	{
+		std::vector<unsigned char>& out;
+		unsigned long long acc;
+		int nbits;
+
+		public:
+		BitWriter(std::vector<unsigned char>& out)
+			:	out(out), acc(0), nbits(0) {}
+
+		void put(unsigned int bits, int n)
+		{
+			acc |= (unsigned long long)bits << nbits;
+			nbits += n;
+			while (nbits >= 8)
+			{
+				out.push_back((unsigned char)acc);
+				acc >>= 8;
+				nbits -= 8;
+			}
+		}
+
+		void align(void)
+		{
+			if (nbits > 0) out.push_back((unsigned char)acc);
+			acc = 0;
+			nbits = 0;
+		}
+	};
+
+	/* Compresses the data as a single fixed Huffman DEFLATE block. If this is not
+	 * the final block, a sync flush (empty stored block) is appended, leaving the
+	 * stream byte aligned so that another block can be concatenated. */
+	void deflateBlock(const unsigned char* data, size_t n, bool final,
+						std::vector<unsigned char>& out)
+	{
+		const FixedHuffman& fh = fixedHuffman();
+		BitWriter bw(out);
+		bw.put(final ? 1 : 0, 1);
+		bw.put(1, 2); // fixed Huffman codes
+
+		std::vector<int> head(HASH_SIZE, -1);
+		std::vector<int> prev(WINDOW_SIZE, -1);
+
+		size_t i = 0;
+		while (i < n)
+		{
+			int best_len = 0, best_dist = 0;
+			if (i + MIN_MATCH <= n)
+			{
+				const unsigned int h = ((data[i] << 10) ^ (data[i+1] << 5) ^ data[i+2])
+										& (HASH_SIZE - 1);
+				int cand = head[h];
+				prev[i & WINDOW_MASK] = cand;
+				head[h] = (int)i;
+				const int max_len = (n - i < (size_t)MAX_MATCH) ? (int)(n - i) : MAX_MATCH;
+				for (int chain = MAX_CHAIN ; cand >= 0 && chain > 0 ; chain--)
+				{
+					const int dist = (int)i - cand;
+					if (dist > WINDOW_SIZE) break;
+					const unsigned char* a = data + cand;
+					const unsigned char* b = data + i;
+					if (a[best_len] == b[best_len])
+					{
+						int len = 0;
+						while (len < max_len && a[len] == b[len]) len++;
+						if (len > best_len)
+						{
+							best_len = len;
+							best_dist = dist;
+							if (len == max_len) break;
+						}
+					}
+					const int next = prev[cand & WINDOW_MASK];
+					if (next >= cand) break; // slot was recycled
+					cand = next;
+				}
+			}
+
+			if (best_len >= MIN_MATCH)
+			{
+				const int ls = fh.len_symbol[best_len];
+				bw.put(fh.lit_code[257 + ls], fh.lit_len[257 + ls]);
+				if (LEN_EXTRA[ls]) bw.put(best_len - LEN_BASE[ls], LEN_EXTRA[ls]);
+				const int ds = fh.dist_symbol[best_dist];
+				bw.put(fh.dist_code[ds], 5);
+				if (DIST_EXTRA[ds]) bw.put(best_dist - DIST_BASE[ds], DIST_EXTRA[ds]);
+
+				// register the remaining positions covered by the match
+				for (size_t j = i + 1 ; j < i + best_len && j + MIN_MATCH <= n ; j++)
+				{
+					const unsigned int h = ((data[j] << 10) ^ (data[j+1] << 5) ^ data[j+2])
+											& (HASH_SIZE - 1);
+					prev[j & WINDOW_MASK] = head[h];
+					head[h] = (int)j;
+				}
+				i += best_len;
+			}
+			else
+			{
+				bw.put(fh.lit_code[data[i]], fh.lit_len[data[i]]);
+				i++;
+			}
+		}
+		bw.put(fh.lit_code[256], fh.lit_len[256]); // end of block
+
+		if (!final)
+		{
+			bw.put(0, 3); // stored block, not final
+			bw.align();
+			const unsigned char sync[4] = { 0x00, 0x00, 0xFF, 0xFF };
+			out.insert(out.end(), sync, sync+4);
+		}
+		else bw.align();
+	}
+
+	// converts a row of ARGB colors to RGBA bytes
+	void rowToRGBA(const unsigned int* src, int width, unsigned char* dst)
+	{
+		for (int x = 0 ; x < width ; x++, dst += 4)
+		{
+			const unsigned int c = src[x];
+			dst[0] = c >> 16; dst[1] = c >> 8; dst[2] = c; dst[3] = c >> 24;
+		}
+	}
+
+	inline unsigned char paeth(int a, int b, int c)
+	{
+		const int p = a + b - c;
+		const int pa = (p > a) ? p - a : a - p;
+		const int pb = (p > b) ? p - b : b - p;
+		const int pc = (p > c) ? p - c : c - p;
+		if (pa <= pb && pa <= pc) return a;
+		return (pb <= pc) ? b : c;
+	}
+
+	/* Filters a scanline of RGBA bytes, returning the sum of the absolute values of
+	 * the filtered bytes (as signed), which is used to select the adaptive filter. */
+	unsigned int filterRow(int filter, const unsigned char* cur, const unsigned char* prior,
+							int rowbytes, unsigned char* out)
+	{
+		constexpr int BPP = 4;
+		unsigned int sum = 0;
+		for (int i = 0 ; i < rowbytes ; i++)
+		{
+			const int a = (i >= BPP) ? cur[i - BPP] : 0;
+			const int b = prior[i];
+			const int c = (i >= BPP) ? prior[i - BPP] : 0;
+			unsigned char v;
+			switch (filter)
+			{
+				case PNG_FILTER_SUB:     v = cur[i] - a; break;
+				case PNG_FILTER_UP:      v = cur[i] - b; break;
+				case PNG_FILTER_AVERAGE: v = cur[i] - ((a + b) >> 1); break;
+				case PNG_FILTER_PAETH:   v = cur[i] - paeth(a, b, c); break;
+				default:                 v = cur[i];
+			}
+			out[i] = v;
+			sum += (v < 128) ? v : 256 - v;
+		}
+		return sum;
+	}
+
+	/* A band of PNG rows, filtered and compressed by one thread. */
+	struct PngBand
+	{
+		int y0, y1;
+		bool first, last;
+		std::vector<unsigned char> data; // zlib stream fragment
+		unsigned int adler;
+		size_t raw_len;
+	};
+
+	void compressBand(const DisplayBuffer* buffer, PngFilter filter, PngBand* band)
+	{
+		const int w = buffer->getWidth();
+		const int rowbytes = 4 * w;
+
+		std::vector<unsigned int> scratch(w);
+		std::vector<unsigned char> prior(rowbytes, 0), cur(rowbytes);
+		std::vector<unsigned char> trial((filter == PNG_FILTER_ADAPTIVE) ? rowbytes : 0);
+		std::vector<unsigned char> raw((size_t)(band->y1 - band->y0) * (rowbytes + 1));
+
+		// the first row of the band is filtered against the last row of the previous one
+		if (band->y0 > 0)
+			rowToRGBA(buffer->readRow(band->y0 - 1, scratch.data()), w, prior.data());
+
+		unsigned char* out = raw.data();
+		for (int y = band->y0 ; y < band->y1 ; y++, out += rowbytes + 1)
+		{
+			rowToRGBA(buffer->readRow(y, scratch.data()), w, cur.data());
+			if (filter == PNG_FILTER_ADAPTIVE)
+			{
+				unsigned int best = ~0u;
+				for (int f = PNG_FILTER_NONE ; f <= PNG_FILTER_PAETH ; f++)
+				{
+					unsigned int sum = filterRow(f, cur.data(), prior.data(),
+												rowbytes, trial.data());
+					if (sum < best)
+					{
+						best = sum;
+						out[0] = f;
+						memcpy(out + 1, trial.data(), rowbytes);
+					}
+				}
+			}
+			else
+			{
+				out[0] = filter;
+				filterRow(filter, cur.data(), prior.data(), rowbytes, out + 1);
+			}
+			prior.swap(cur);
+		}
+
+		band->raw_len = raw.size();
+		band->adler = adler32(1, raw.data(), raw.size());
+		band->data.reserve(raw.size() / 4 + 64);
+		if (band->first)
+		{
+			band->data.push_back(0x78); // zlib header: deflate, 32K window
+			band->data.push_back(0x01);
+		}
+		deflateBlock(raw.data(), raw.size(), band->last, band->data);
+	}
+
+	void writeChunk(std::vector<unsigned char>& out, const char* type,
+					const unsigned char* data, unsigned int len)
+	{
+		putU32BE(out, len);
+		const size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + len);
+		putU32BE(out, ~crc32(0xFFFFFFFFu, out.data() + start, len + 4));
+	}
+}
+
+bool image::encodeQOI(const DisplayBuffer& buffer, std::vector<unsigned char>& out)
+{
+	if (!buffer || buffer.getWidth() <= 0 || buffer.getHeight() <= 0) return false;
+
+	const size_t npixels = (size_t)buffer.getWidth() * buffer.getHeight();
+	const size_t start = out.size();
+	out.resize(start + 14 + npixels * 5 + 8); // worst case
+	unsigned char* o = out.data() + start;
+
+	memcpy(o, "qoif", 4);
+	putU32BE(o + 4, buffer.getWidth());
+	putU32BE(o + 8, buffer.getHeight());
+	o[12] = 4; // RGBA
+	o[13] = 0; // sRGB with linear alpha
+	o += 14;
+
+	unsigned int index[64] = {0};
+	unsigned int px_prev = 0xFF000000;
+	int run = 0;
+	const int w = buffer.getWidth();
+	std::vector<unsigned int> scratch(w);
+	const unsigned int* pixels = nullptr;
+	for (size_t i = 0 ; i < npixels ; i++)
+	{
+		const int x = (int)(i % w);
+		if (x == 0) pixels = buffer.readRow((int)(i / w), scratch.data());
+		const unsigned int px = pixels[x];
+		if (px == px_prev)
+		{
+			if (++run == 62)
+			{
+				*o++ = 0xC0 | (run - 1);
+				run = 0;
+			}
+			continue;
+		}
+		if (run > 0)
+		{
+			*o++ = 0xC0 | (run - 1);
+			run = 0;
+		}
+
+		const unsigned char a = px >> 24, r = px >> 16, g = px >> 8, b = px;
+		const int h = (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+		if (index[h] == px)
+			*o++ = h;
+		else
+		{
+			index[h] = px;
+			if (a == (px_prev >> 24))
+			{
+				const signed char vr = r - (unsigned char)(px_prev >> 16);
+				const signed char vg = g - (unsigned char)(px_prev >> 8);
+				const signed char vb = b - (unsigned char)px_prev;
+				const signed char vg_r = vr - vg;
+				const signed char vg_b = vb - vg;
+				if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+					*o++ = 0x40 | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+				else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32
+						&& vg_b > -9 && vg_b < 8)
+				{
+					*o++ = 0x80 | (vg + 32);
+					*o++ = (vg_r + 8) << 4 | (vg_b + 8);
+				}
+				else
+				{
+					*o++ = 0xFE; *o++ = r; *o++ = g; *o++ = b;
+				}
+			}
+			else
+			{
+				*o++ = 0xFF; *o++ = r; *o++ = g; *o++ = b; *o++ = a;
+			}
+		}
+		px_prev = px;
+	}
+	if (run > 0) *o++ = 0xC0 | (run - 1);
+
+	static const unsigned char END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+	memcpy(o, END_MARKER, 8);
+	o += 8;
+
+	out.resize(o - out.data());
+	return true;
+}
+
+bool image::encodePNG(const DisplayBuffer& buffer, std::vector<unsigned char>& out,
+						PngFilter filter, unsigned int threads, WorkerPool* pool)
+{
+	const int w = buffer.getWidth(), h = buffer.getHeight();
+	if (!buffer || w <= 0 || h <= 0 || filter > PNG_FILTER_ADAPTIVE) return false;
+
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	int nbands = h / PNG_MIN_BAND_ROWS;
+	if (nbands > (int)threads) nbands = threads;
+	if (nbands < 1) nbands = 1;
+
+	std::vector<PngBand> bands(nbands);
+	for (int i = 0 ; i < nbands ; i++)
+	{
+		bands[i].y0 = (int)((long long)h * i / nbands);
+		bands[i].y1 = (int)((long long)h * (i+1) / nbands);
+		bands[i].first = (i == 0);
+		bands[i].last = (i == nbands - 1);
+	}
+
+	// the calling thread compresses the last band itself
+	if (nbands > 1)
+	{
+		// a pool kept for the later images encoded by this thread
+		static thread_local WorkerPool own_pool;
+		if (pool == nullptr) pool = &own_pool;
+		pool->run(nbands, [&](unsigned int i) {
+			compressBand(&buffer, filter, &bands[i]);
+		});
+	}
+	else compressBand(&buffer, filter, &bands[0]);
+
+	static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	out.insert(out.end(), SIGNATURE, SIGNATURE + 8);
+
+	unsigned char ihdr[13];
+	putU32BE(ihdr, w);
+	putU32BE(ihdr + 4, h);
+	ihdr[8] = 8;  // bit depth
+	ihdr[9] = 6;  // color type: RGBA
+	ihdr[10] = 0; // compression: deflate
+	ihdr[11] = 0; // filter method: adaptive
+	ihdr[12] = 0; // no interlace
+	writeChunk(out, "IHDR", ihdr, 13);
+
+	// one IDAT chunk per band, the last one also holding the zlib checksum
+	unsigned int adler = bands[0].adler;
+	for (int i = 1 ; i < nbands ; i++)
+		adler = adler32Combine(adler, bands[i].adler, bands[i].raw_len);
+	putU32BE(bands[nbands - 1].data, adler);
+	for (const PngBand& band : bands)
+		writeChunk(out, "IDAT", band.data.data(), band.data.size());
+
+	writeChunk(out, "IEND", nullptr, 0);
+	return true;
+}
+
+bool image::save(const DisplayBuffer& buffer, const char* path, ImageFormat format,
+					PngFilter filter, unsigned int threads, WorkerPool* pool)
+{
+	if (path == nullptr) return false;
+
+	std::vector<unsigned char> file;
+	bool r;
+	switch (format)
+	{
+		case IMAGE_QOI:
+			r = encodeQOI(buffer, file);
+			break;
+		case IMAGE_PNG:
+			r = encodePNG(buffer, file, filter, threads, pool);
+			break;
+		default:
+			r = false;
+	}
+	if (!r) return false;
+
+	FILE* f = fopen(path, "wb");
+	if (f == nullptr) return false;
+	r = fwrite(file.data(), 1, file.size(), f) == file.size();
+	return (fclose(f) == 0) && r;
+}
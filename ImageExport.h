@@ -0,0 +1,87 @@
+/** \file ImageExport.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \namespace derplot::image
+ *
+ * \brief Contains the functions for exporting the contents of a display buffer
+ * to image files.
+ *
+ * Two file formats are supported: QOI ("Quite OK Image" format), which is very fast
+ * to encode, and PNG. The PNG encoder filters each scanline with the selected filter
+ * and splits the image into bands of rows, which are filtered and deflated in
+ * parallel by the threads of a worker pool. Each band is terminated with a sync flush, so that the compressed bands
+ * can be concatenated into a single zlib stream. No external libraries are required.
+ *
+ * Pixels are read directly from the display buffer, without an intermediate copy
+ * of the whole image. Buffers in pixel formats other than ARGB8888 are converted
+ * one row at a time.
+ */
+#pragma once
+
+#include "DisplayBuffer.h"
+#include <vector>
+
+namespace derplot
+{
+
+class WorkerPool;
+
+enum ImageFormat : unsigned char
+{
+	IMAGE_QOI = 0x00,
+	IMAGE_PNG = 0x01
+};
+
+enum PngFilter : unsigned char
+{
+	PNG_FILTER_NONE     = 0x00,
+	PNG_FILTER_SUB      = 0x01,
+	PNG_FILTER_UP       = 0x02,
+	PNG_FILTER_AVERAGE  = 0x03,
+	PNG_FILTER_PAETH    = 0x04,
+	PNG_FILTER_ADAPTIVE = 0x05 ///< picks the best filter for each scanline
+};
+
+namespace image
+{
+	/**
+	 * Encodes the contents of the display buffer as a QOI image.
+	 * \param buffer the display buffer to encode
+	 * \param out the vector to which the encoded file is appended
+	 * \return whether the operation was successful
+	 */
+	bool encodeQOI(const DisplayBuffer& buffer, std::vector<unsigned char>& out);
+
+	/**
+	 * Encodes the contents of the display buffer as a PNG image (8-bit RGBA).
+	 * \param buffer the display buffer to encode
+	 * \param out the vector to which the encoded file is appended
+	 * \param filter the scanline filter to use
+	 * \param threads the number of threads compressing the image,
+	 * or \c 0 to use the number of hardware threads available
+	 * \param pool the pool whose threads compress the bands, or \c nullptr to use a
+	 * pool kept by the encoder for the calling thread
+	 * \return whether the operation was successful
+	 */
+	bool encodePNG(const DisplayBuffer& buffer, std::vector<unsigned char>& out,
+					PngFilter filter = PNG_FILTER_ADAPTIVE, unsigned int threads = 0,
+					WorkerPool* pool = nullptr);
+
+	/**
+	 * Saves the contents of the display buffer to an image file.
+	 * \param buffer the display buffer to save
+	 * \param path the path of the output file
+	 * \param format the file format ( \c IMAGE_QOI or \c IMAGE_PNG )
+	 * \param filter the scanline filter to use (PNG only)
+	 * \param threads the number of threads compressing the image (PNG only),
+	 * or \c 0 to use the number of hardware threads available
+	 * \param pool the pool whose threads compress the image (PNG only), or \c nullptr
+	 * to use a pool kept by the encoder for the calling thread
+	 * \return whether the operation was successful
+	 */
+	bool save(const DisplayBuffer& buffer, const char* path, ImageFormat format,
+				PngFilter filter = PNG_FILTER_ADAPTIVE, unsigned int threads = 0,
+				WorkerPool* pool = nullptr);
+};
+
+};
@@ -5,12 +5,17 @@
  * \class derplot::math::Mat4x4f
  * \brief This class defines a 4x4 bidimensional matrix of single precision
  * floating point values, used throughout the library.
+ *
+ * The elements are 16-byte aligned and stored in column order, so that each
+ * column can be handled with a single SIMD register. The class is a literal
+ * type, so matrices can be built in constant expressions.
  */
 #pragma once
 
 #include <initializer_list>
 #include <array>
 #include "Vector4f.h"
+#include "Simd.h"
 
 namespace derplot
 {
@@ -21,38 +26,50 @@ namespace math
 class Mat4x4f
 {
 private:
-	std::array<float, 4*4> m;
+	alignas(16) std::array<float, 4*4> m;
 public:
 
 	/**
 	 * Builds a blank matrix (with zeros)
 	 */
-	Mat4x4f(void);
+	constexpr Mat4x4f(void): m{} {}
 
 	/**
 	 * Constructor for copying a matrix
 	 */
-	Mat4x4f(const Mat4x4f& other);
+	Mat4x4f(const Mat4x4f& other) = default;
 
 	/**
 	 * Standard move constructor
 	 * \param other the other object to move from
 	 */
-	Mat4x4f(Mat4x4f&& other);
+	Mat4x4f(Mat4x4f&& other) = default;
 
 	/**
 	 * Copy assignment operator
 	 * \param other the object to copy from
 	 * \return reference to this
 	 */
-	Mat4x4f& operator=(const Mat4x4f& other);
+	Mat4x4f& operator=(const Mat4x4f& other) = default;
 
 	/**
 	 * Move assignment operator
 	 * \param other the object to move from
 	 * \return reference to this
 	 */
-	Mat4x4f& operator=(Mat4x4f&& other);
+	Mat4x4f& operator=(Mat4x4f&& other) = default;
+
+	/**
+	 * Builds the matrix from its 16 elements, in standard OpenGL
+	 * order (columns first). Unlike the initializer list constructor,
+	 * it can be used in constant expressions.
+	 */
+	constexpr Mat4x4f(float m0, float m1, float m2, float m3,
+			float m4, float m5, float m6, float m7,
+			float m8, float m9, float m10, float m11,
+			float m12, float m13, float m14, float m15)
+	:	m{{m0, m1, m2, m3, m4, m5, m6, m7,
+			m8, m9, m10, m11, m12, m13, m14, m15}} {}
 
 	/**
 	 * Array pointer constructor
@@ -62,7 +79,8 @@ public:
 	 *
 	 * \b Warning: unsafe. Other constructors should be preferred
 	 */
-	Mat4x4f(const float* p_m);
+	Mat4x4f(const float* p_m)
+	{ for (int i = 0 ; i < 4*4 ; i++) this->m[i] = p_m[i]; }
 
 	/**
 	 * Initializer list constructor
@@ -80,7 +98,7 @@ public:
 	 *
 	 * \return a pointer to the array holding the matrix elements
 	 */
-	operator const float* (void) const;
+	operator const float* (void) const { return this->m.data(); }
 
 	/**
 	 * Applies the sum of this matrix with the \b other matrix
@@ -90,7 +108,8 @@ public:
 	/**
 	 * \return the sum of two matrices
 	 */
-	const Mat4x4f& operator+ (const Mat4x4f& other) const;
+	Mat4x4f operator+ (const Mat4x4f& other) const
+	{ Mat4x4f out(*this); out += other; return out; }
 
 	/**
 	 * Applies the subtraction of this matrix with the \b other matrix
@@ -101,10 +120,13 @@ public:
 	/**
 	 * \return the result of subtracting two matrices
 	 */
-	const Mat4x4f& operator- (const Mat4x4f& other) const;
+	Mat4x4f operator- (const Mat4x4f& other) const
+	{ Mat4x4f out(*this); out -= other; return out; }
 
 	/**
 	 * Applies the product of this matrix with the \b other matrix
+	 * (<tt>this = this * other</tt>). Each column of the result is
+	 * accumulated with fused multiply-adds of the columns of this matrix.
 	 * \return the matrix itself
 	 */
 	Mat4x4f& operator*= (const Mat4x4f& other);
@@ -112,7 +134,8 @@ public:
 	/**
 	 * \return the product of two matrices
 	 */
-	const Mat4x4f& operator* (const Mat4x4f& other) const;
+	Mat4x4f operator* (const Mat4x4f& other) const
+	{ Mat4x4f out(*this); out *= other; return out; }
 
 	/**
 	 * Applies the product of this matrix with a scalar value
@@ -134,6 +157,40 @@ public:
 	 */
 	float get(unsigned int row, unsigned int col) const;
 
+	/**
+	 * Accesses the element at row \b row and column \b col, without
+	 * checking the bounds. Meant for internal use in tight loops.
+	 * \param row the row of the matrix's element. 0 <= row < 4
+	 * \param col the column of the matrix's element. 0 <= col < 4
+	 */
+	float at(unsigned int row, unsigned int col) const
+	{ return this->m[row + (col << 2)]; }
+
+	/**
+	 * Accesses the element at row \b row and column \b col, without
+	 * checking the bounds. Meant for internal use in tight loops.
+	 * \param row the row of the matrix's element. 0 <= row < 4
+	 * \param col the column of the matrix's element. 0 <= col < 4
+	 */
+	float& at(unsigned int row, unsigned int col)
+	{ return this->m[row + (col << 2)]; }
+
+	/**
+	 * Gets the column \b col, without checking the bounds.
+	 * \param col the column index. 0 <= col < 4
+	 * \return a pointer to the 4 contiguous, 16-byte aligned elements of the column
+	 */
+	const float* column(unsigned int col) const
+	{ return this->m.data() + (col << 2); }
+
+	/**
+	 * Gets the column \b col, without checking the bounds.
+	 * \param col the column index. 0 <= col < 4
+	 * \return a pointer to the 4 contiguous, 16-byte aligned elements of the column
+	 */
+	float* column(unsigned int col)
+	{ return this->m.data() + (col << 2); }
+
 	/**
 	 * Takes the values of the last column of the matrix and writes them
 	 * to the given vector in order.
@@ -148,6 +205,79 @@ public:
 	static const Mat4x4f IDENTITY;
 };
 
+inline Mat4x4f::Mat4x4f(const std::initializer_list<float> & list)
+{
+	int i;
+	auto it = list.begin();
+	for (i = 0 ; it != list.end() && i < 4*4 ; it++, i++ )
+		m[i] = *it;
+	for ( ; i < 4*4 ; i++)
+		m[i] = 0.0f;
+}
+
+inline Mat4x4f& Mat4x4f::operator+= (const Mat4x4f& other)
+{
+	for (int i = 0 ; i < 4*4 ; i += 4)
+		simd::store(&this->m[i], simd::add(simd::load(&this->m[i]), simd::load(&other.m[i])));
+	return *this;
+}
+
+inline Mat4x4f& Mat4x4f::operator-= (const Mat4x4f& other)
+{
+	for (int i = 0 ; i < 4*4 ; i += 4)
+		simd::store(&this->m[i], simd::sub(simd::load(&this->m[i]), simd::load(&other.m[i])));
+	return *this;
+}
+
+inline Mat4x4f& Mat4x4f::operator*= (const Mat4x4f& other)
+{
+	// column c of the result is the sum of the columns of this matrix,
+	// weighted by the elements of column c of the other matrix
+	const simd::float4 a0 = simd::load(&this->m[0]);
+	const simd::float4 a1 = simd::load(&this->m[4]);
+	const simd::float4 a2 = simd::load(&this->m[8]);
+	const simd::float4 a3 = simd::load(&this->m[12]);
+
+	// each column of the other matrix is read before the same column of this
+	// matrix is written, so that m *= m also works
+	for (int c = 0 ; c < 4*4 ; c += 4)
+	{
+		simd::float4 col = simd::mul(a0, simd::splat(other.m[c]));
+		col = simd::madd(a1, simd::splat(other.m[c + 1]), col);
+		col = simd::madd(a2, simd::splat(other.m[c + 2]), col);
+		col = simd::madd(a3, simd::splat(other.m[c + 3]), col);
+		simd::store(&this->m[c], col);
+	}
+	return *this;
+}
+
+inline Mat4x4f& Mat4x4f::operator*= (float fscalar)
+{
+	const simd::float4 s = simd::splat(fscalar);
+	for (int i = 0 ; i < 4*4 ; i += 4)
+		simd::store(&this->m[i], simd::mul(simd::load(&this->m[i]), s));
+	return *this;
+}
+
+inline float Mat4x4f::get(unsigned int index) const
+{
+	if (index >= 4*4) return 0.0f;
+	return this->m[index];
+}
+
+inline float Mat4x4f::get(unsigned int row, unsigned int col) const
+{
+	if (row >= 4 || col >= 4) return 0.0f;
+	return this->at(row, col);
+}
+
+inline Vector4f& Mat4x4f::takeVector(Vector4f& vector) const
+{
+	vector.x() = m[12]; vector.y() = m[13];
+	vector.z() = m[14]; vector.w() = m[15];
+	return vector;
+}
+
 };
 
 };
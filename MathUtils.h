@@ -13,6 +13,7 @@
 #include "Vector4f.h"
 
 #include <ostream>
+#include <math.h>
 
 namespace derplot
 {
@@ -39,68 +40,242 @@ namespace derplot
 		constexpr float radians2degrees(float angle)
 		{ return angle * 180.0f / (float)PI; }
 
+		/**
+		 * Chooses the spacing of the ticks of a plot axis: the smallest of 1, 2 or 5
+		 * times a power of ten that splits a range in at most \b count parts.
+		 * \param range the length of the axis
+		 * \param count the maximum number of parts
+		 * \return the spacing, or 0 if the range is not positive and finite or
+		 * \b count is not positive
+		 */
+		inline float tickStep(float range, int count)
+		{
+			if (!(range > 0) || !isfinite(range) || count <= 0) return 0;
+			const float part = range / count;
+			const float magnitude = powf(10.0f, floorf(log10f(part)));
+			const float r = part / magnitude;
+			return magnitude * ((r <= 1) ? 1 : (r <= 2) ? 2 : (r <= 5) ? 5 : 10);
+		}
+
 		/**
 		 * Multiplies a vector with a matrix.
 		 * \param vec the affected vector
 		 * \param mat the matrix for multiplication
 		 * \return the modified vector
 		 */
-		Vector4f& multiply(Vector4f& vec, const Mat4x4f& mat);
+		inline Vector4f& multiply(Vector4f& vec, const Mat4x4f& mat)
+		{
+			// the result is the sum of the matrix columns, weighted by the vector components
+			simd::float4 t = simd::mul(simd::load(mat.column(0)), simd::splat(vec.x()));
+			t = simd::madd(simd::load(mat.column(1)), simd::splat(vec.y()), t);
+			t = simd::madd(simd::load(mat.column(2)), simd::splat(vec.z()), t);
+			t = simd::madd(simd::load(mat.column(3)), simd::splat(vec.w()), t);
+			simd::store(vec.data(), t);
+			return vec;
+		}
+
+		/**
+		 * Perform a translation on the given matrix \b mat using the list of
+		 * coordinates \b x , \b y , \b z [, \b w ]
+		 * \return the same matrix, modified by the function
+		 */
+		inline Mat4x4f& translate(Mat4x4f& mat, float x, float y, float z, float w = 1.0f)
+		{
+			// only the last column changes: it becomes the combination of all columns
+			float* col3 = mat.column(3);
+			simd::float4 t = simd::mul(simd::load(col3), simd::splat(w));
+			t = simd::madd(simd::load(mat.column(0)), simd::splat(x), t);
+			t = simd::madd(simd::load(mat.column(1)), simd::splat(y), t);
+			t = simd::madd(simd::load(mat.column(2)), simd::splat(z), t);
+			simd::store(col3, t);
+			return mat;
+		}
 
 		/**
 		 * Perform a translation on the given matrix \b mat using a vector \b v
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& translate(Mat4x4f& mat, const Vector4f& v);
+		inline Mat4x4f& translate(Mat4x4f& mat, const Vector4f& v)
+		{
+			return translate(mat, v.x(), v.y(), v.z(), v.w());
+		}
 
 		/**
-		 * Perform a translation on the given matrix \b mat using the list of
+		 * Perform a scale transformation on the given matrix \b mat using the list of
 		 * coordinates \b x , \b y , \b z [, \b w ]
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& translate(Mat4x4f& mat, float x, float y, float z, float w = 1.0f);
+		inline Mat4x4f& scale(Mat4x4f& mat, float x, float y, float z, float w = 1.0f)
+		{
+			const float factors[4] = {x, y, z, w};
+			for (unsigned int c = 0 ; c < 4 ; c++)
+			{
+				float* col = mat.column(c);
+				simd::store(col, simd::mul(simd::load(col), simd::splat(factors[c])));
+			}
+			return mat;
+		}
 
 		/**
 		 * Perform a scale transformation on the given matrix \b mat using the
 		 * given vector
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& scale(Mat4x4f& mat, const Vector4f& v_scale);
+		inline Mat4x4f& scale(Mat4x4f& mat, const Vector4f& v)
+		{
+			return scale(mat, v[0], v[1], v[2], v[3]);
+		}
 
 		/**
-		 * Perform a scale transformation on the given matrix \b mat using the list of
-		 * coordinates \b x , \b y , \b z [, \b w ]
-		 * \return the same matrix, modified by the function
+		 * Applies a plane rotation to two columns of a matrix, which is all
+		 * that a rotation around one of the main axes changes:
+		 * <tt>a = a*cosine + b*sine</tt> and <tt>b = b*cosine - a*sine</tt>
 		 */
-		Mat4x4f& scale(Mat4x4f& mat, float x, float y, float z, float w = 1.0f);
+		inline void rotateColumns(float* a, float* b, float sine, float cosine)
+		{
+			const simd::float4 ca = simd::load(a), cb = simd::load(b);
+			const simd::float4 s = simd::splat(sine), c = simd::splat(cosine);
+			simd::store(a, simd::madd(cb, s, simd::mul(ca, c)));
+			simd::store(b, simd::sub(simd::mul(cb, c), simd::mul(ca, s)));
+		}
 
 		/**
 		 * Performs a rotation around the X axis.
 		 * \param ang the X angle value in radians
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& rotateAroundX(Mat4x4f& mat, float ang);
+		inline Mat4x4f& rotateAroundX(Mat4x4f& mat, float ang)
+		{
+			rotateColumns(mat.column(1), mat.column(2), (float)sin(ang), (float)cos(ang));
+			return mat;
+		}
 
 		/**
 		 * Performs a rotation around the Y axis.
 		 * \param ang the Y angle value in radians
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& rotateAroundY(Mat4x4f& mat, float ang);
+		inline Mat4x4f& rotateAroundY(Mat4x4f& mat, float ang)
+		{
+			rotateColumns(mat.column(2), mat.column(0), (float)sin(ang), (float)cos(ang));
+			return mat;
+		}
 
 		/**
 		 * Performs a rotation around the Z axis.
 		 * \param ang the Z angle value in radians
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& rotateAroundZ(Mat4x4f& mat, float ang);
+		inline Mat4x4f& rotateAroundZ(Mat4x4f& mat, float ang)
+		{
+			rotateColumns(mat.column(0), mat.column(1), (float)sin(ang), (float)cos(ang));
+			return mat;
+		}
+
+		/**
+		 * Replaces the upper 3x3 part of the matrix with the rotation described
+		 * by a quaternion. The remaining elements are set as in the identity matrix.
+		 * \param mat the matrix to set
+		 * \param q the rotation quaternion, in the form (x, y, z, w) where \b w is
+		 * the real part. It does not need to be normalized.
+		 * A null quaternion results in the identity matrix.
+		 * \return the same matrix, modified by the function
+		 */
+		inline Mat4x4f& setRotation(Mat4x4f& mat, const Vector4f& q)
+		{
+			const float n = q.dot(q);
+			const float s = (n > 0) ? 2.0f / n : 0.0f;
+			const float xs = q.x() * s, ys = q.y() * s, zs = q.z() * s;
+			const float wx = q.w() * xs, wy = q.w() * ys, wz = q.w() * zs;
+			const float xx = q.x() * xs, xy = q.x() * ys, xz = q.x() * zs;
+			const float yy = q.y() * ys, yz = q.y() * zs, zz = q.z() * zs;
+			mat = Mat4x4f(
+					1 - (yy + zz),       xy + wz,       xz - wy, 0,
+					      xy - wz, 1 - (xx + zz),       yz + wx, 0,
+					      xz + wy,       yz - wx, 1 - (xx + yy), 0,
+					            0,             0,             0, 1);
+			return mat;
+		}
+
+		/**
+		 * Replaces the matrix with a sequence of 3 rotations in this order: pitch,
+		 * yaw and roll (the same as applying \c rotate() on an identity matrix).
+		 * The matrix is built directly, with one sine and cosine per axis.
+		 * \param mat the matrix to set
+		 * \param pitch the pitch component (around the X axis) in radians
+		 * \param yaw the yaw component (around the Y axis) in radians
+		 * \param roll the roll component (around the Z axis) in radians
+		 * \return the same matrix, modified by the function
+		 */
+		inline Mat4x4f& setRotation(Mat4x4f& mat, float pitch, float yaw, float roll)
+		{
+			const float sx = (float)sin(pitch), cx = (float)cos(pitch);
+			const float sy = (float)sin(yaw), cy = (float)cos(yaw);
+			const float sz = (float)sin(roll), cz = (float)cos(roll);
+			mat = Mat4x4f(
+					cy * cz,  sx * sy * cz + cx * sz, sx * sz - cx * sy * cz, 0,
+					-cy * sz, cx * cz - sx * sy * sz, cx * sy * sz + sx * cz, 0,
+					sy,       -sx * cy,               cx * cy,                0,
+					0,        0,                      0,                      1);
+			return mat;
+		}
+
+		/**
+		 * Replaces the matrix with a full translate-rotate-scale transformation,
+		 * equivalent to translating, rotating and scaling an identity matrix
+		 * in this order.
+		 * \param mat the matrix to set
+		 * \param t the translation vector (the W component is ignored)
+		 * \param q the rotation quaternion, in the form (x, y, z, w) where \b w is
+		 * the real part
+		 * \param s the scale factors (the W component is ignored)
+		 * \return the same matrix, modified by the function
+		 */
+		inline Mat4x4f& setTransform(Mat4x4f& mat, const Vector4f& t, const Vector4f& q,
+									const Vector4f& s)
+		{
+			setRotation(mat, q);
+			for (unsigned int c = 0 ; c < 3 ; c++)
+			{
+				float* col = mat.column(c);
+				simd::store(col, simd::mul(simd::load(col), simd::splat(s[c])));
+			}
+			mat.at(0, 3) = t.x();
+			mat.at(1, 3) = t.y();
+			mat.at(2, 3) = t.z();
+			return mat;
+		}
+
+		/**
+		 * Builds the quaternion of a sequence of 3 rotations in this order: pitch,
+		 * yaw and roll.
+		 * \param pitch the pitch component (around the X axis) in radians
+		 * \param yaw the yaw component (around the Y axis) in radians
+		 * \param roll the roll component (around the Z axis) in radians
+		 * \return the unit quaternion, in the form (x, y, z, w)
+		 */
+		inline Vector4f euler2quaternion(float pitch, float yaw, float roll)
+		{
+			const float sx = (float)sin(pitch * 0.5f), cx = (float)cos(pitch * 0.5f);
+			const float sy = (float)sin(yaw * 0.5f), cy = (float)cos(yaw * 0.5f);
+			const float sz = (float)sin(roll * 0.5f), cz = (float)cos(roll * 0.5f);
+			return Vector4f(
+					sx * cy * cz + cx * sy * sz,
+					cx * sy * cz - sx * cy * sz,
+					cx * cy * sz + sx * sy * cz,
+					cx * cy * cz - sx * sy * sz);
+		}
 
 		/**
 		 * Performs a sequence of 3 rotations in this order: X, Y and Z.
 		 * \param ang the vector containing the 3 angle values in radians
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& rotate(Mat4x4f& mat, const Vector4f& ang);
+		inline Mat4x4f& rotate(Mat4x4f& mat, const Vector4f& ang)
+		{
+			Mat4x4f rotation;
+			return mat *= setRotation(rotation, ang.x(), ang.y(), ang.z());
+		}
 
 		/**
 		 * Performs a sequence of 3 rotations in this order: pitch, yaw and roll.
@@ -109,7 +284,11 @@ namespace derplot
 		 * \param roll the roll component in radians
 		 * \return the same matrix, modified by the function
 		 */
-		Mat4x4f& rotate(Mat4x4f& mat, float pitch, float yaw, float roll);
+		inline Mat4x4f& rotate(Mat4x4f& mat, float pitch, float yaw, float roll)
+		{
+			Mat4x4f rotation;
+			return mat *= setRotation(rotation, pitch, yaw, roll);
+		}
 
 		/**
 		 * Prints a simple textual presentation of a matrix to an output stream.
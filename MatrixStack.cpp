@@ -0,0 +1,36 @@
+/** \file MatrixStack.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+
+#include "MatrixStack.h"
+
+using namespace derplot::math;
+
+MatrixStack::MatrixStack(void)
+:	depth(0)
+{}
+
+bool MatrixStack::push(const Mat4x4f& mat)
+{
+	if (this->depth == CAPACITY) return false;
+	this->stack[this->depth++] = mat;
+	return true;
+}
+
+bool MatrixStack::pop(Mat4x4f& mat)
+{
+	if (this->depth == 0) return false;
+	mat = this->stack[--this->depth];
+	return true;
+}
+
+unsigned int MatrixStack::size(void) const
+{
+	return this->depth;
+}
+
+void MatrixStack::clear(void)
+{
+	this->depth = 0;
+}
@@ -0,0 +1,55 @@
+/** \file MatrixStack.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \class derplot::math::MatrixStack
+ * \brief Describes a stack of 4x4 matrices with a fixed capacity.
+ *
+ * All matrices are stored inside the object itself, so pushing and popping matrices
+ * never allocates memory.
+ */
+#pragma once
+
+#include "Mat4x4f.h"
+
+namespace derplot
+{
+
+namespace math
+{
+
+class MatrixStack
+{
+	public:
+		/** Maximum number of matrices in a stack */
+		static constexpr unsigned int CAPACITY = 32;
+
+	private:
+		Mat4x4f stack[CAPACITY];
+		unsigned int depth;
+
+	public:
+		/** Default constructor, creates an empty stack */
+		MatrixStack(void);
+
+		/** Pushes a copy of the matrix onto the stack
+		 * \param mat the matrix to push
+		 * \return \b false if the stack is full, in which case nothing is done
+		 */
+		bool push(const Mat4x4f& mat);
+
+		/** Pops the matrix on top of the stack
+		 * \param mat output reference to the popped matrix
+		 * \return \b false if the stack is empty, in which case \b mat is not modified
+		 */
+		bool pop(Mat4x4f& mat);
+
+		/** \return the number of matrices in the stack */
+		unsigned int size(void) const;
+
+		/** Removes all matrices from the stack */
+		void clear(void);
+};
+
+};
+
+};
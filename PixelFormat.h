@@ -0,0 +1,98 @@
+/** \file PixelFormat.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ *
+ * \brief Pixel formats supported by the display buffer.
+ *
+ * All colors passed to the renderer are 32-bit ARGB values. The \c PixelTraits
+ * templates describe how a color is converted to and from the memory representation
+ * of each pixel format, so that drawing kernels can be specialized for each format
+ * at compile time.
+ */
+#pragma once
+
+namespace derplot
+{
+
+enum PixelFormat : unsigned char
+{
+	PIXEL_ARGB8888 = 0x00, ///< 32-bit, 0xAARRGGBB in native byte order
+	PIXEL_ABGR8888 = 0x01, ///< 32-bit, 0xAABBGGRR in native byte order
+	PIXEL_RGB565   = 0x02, ///< 16-bit, 5 bits red, 6 bits green, 5 bits blue
+	PIXEL_GRAY8    = 0x03, ///< 8-bit luminance
+	PIXEL_INDEXED8 = 0x04  ///< 8-bit palette index, taken from the color's lowest byte
+};
+
+/** Number of supported pixel formats */
+constexpr int PIXEL_FORMAT_COUNT = 5;
+
+/**
+ * \return the number of bytes of each pixel in the given format,
+ * or \c 0 if the format is not valid
+ */
+constexpr int bytesPerPixel(PixelFormat format)
+{
+	return (format == PIXEL_ARGB8888 || format == PIXEL_ABGR8888) ? 4
+		: (format == PIXEL_RGB565) ? 2
+		: (format == PIXEL_GRAY8 || format == PIXEL_INDEXED8) ? 1 : 0;
+}
+
+/**
+ * \brief Compile-time description of a pixel format.
+ *
+ * Each specialization defines the pixel's storage \c type, and the \c pack and
+ * \c unpack functions for converting an ARGB color to a pixel and back. The palette
+ * given to \c unpack is only used by indexed formats.
+ */
+template <PixelFormat F> struct PixelTraits;
+
+template <> struct PixelTraits<PIXEL_ARGB8888>
+{
+	typedef unsigned int type;
+	static inline type pack(unsigned int color)
+	{ return color; }
+	static inline unsigned int unpack(type p, const unsigned int*)
+	{ return p; }
+};
+
+template <> struct PixelTraits<PIXEL_ABGR8888>
+{
+	typedef unsigned int type;
+	static inline type pack(unsigned int c)
+	{ return (c & 0xFF00FF00) | ((c >> 16) & 0xFF) | ((c & 0xFF) << 16); }
+	static inline unsigned int unpack(type p, const unsigned int*)
+	{ return pack(p); } // swapping red and blue is its own inverse
+};
+
+template <> struct PixelTraits<PIXEL_RGB565>
+{
+	typedef unsigned short type;
+	static inline type pack(unsigned int c)
+	{ return ((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F); }
+	static inline unsigned int unpack(type p, const unsigned int*)
+	{
+		const unsigned int r = p >> 11, g = (p >> 5) & 0x3F, b = p & 0x1F;
+		return 0xFF000000
+			| ((r << 3 | r >> 2) << 16) | ((g << 2 | g >> 4) << 8) | (b << 3 | b >> 2);
+	}
+};
+
+template <> struct PixelTraits<PIXEL_GRAY8>
+{
+	typedef unsigned char type;
+	static inline type pack(unsigned int c)
+	{ return (((c >> 16) & 0xFF) * 77 + ((c >> 8) & 0xFF) * 150 + (c & 0xFF) * 29) >> 8; }
+	static inline unsigned int unpack(type p, const unsigned int*)
+	{ return 0xFF000000 | (p * 0x010101u); }
+};
+
+template <> struct PixelTraits<PIXEL_INDEXED8>
+{
+	typedef unsigned char type;
+	static inline type pack(unsigned int c)
+	{ return c & 0xFF; }
+	static inline unsigned int unpack(type p, const unsigned int* palette)
+	{ return (palette != nullptr) ? palette[p] : 0xFF000000 | (p * 0x010101u); }
+};
+
+};
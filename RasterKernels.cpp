@@ -0,0 +1,218 @@
+/** \file RasterKernels.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+#include "RasterKernels.h"
+
+using namespace derplot;
+
+namespace
+{
+	// divides each of the two 16-bit lanes by 255, rounding to nearest
+	inline unsigned int div255Lanes(unsigned int x)
+	{
+		x += 0x00800080;
+		return ((x + ((x >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+	}
+
+	// adds the two 8-bit lanes (in 16-bit lanes), saturating at 255
+	inline unsigned int addSaturateLanes(unsigned int a, unsigned int b)
+	{
+		unsigned int sum = a + b;
+		const unsigned int overflow = sum & 0x01000100;
+		sum |= overflow - (overflow >> 8);
+		return sum & 0x00FF00FF;
+	}
+
+	template <BlendMode B> struct Blend;
+
+	template <> struct Blend<BLEND_REPLACE>
+	{
+		static inline unsigned int apply(unsigned int src, unsigned int)
+		{ return src; }
+	};
+
+	template <> struct Blend<BLEND_ALPHA>
+	{
+		static inline unsigned int apply(unsigned int src, unsigned int dst)
+		{
+			const unsigned int a = src >> 24, ia = 255 - a;
+			const unsigned int rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia;
+			// the alpha lane accumulates a*255 + dst_alpha*(255-a)
+			const unsigned int ag = ((src >> 8) & 0xFF) * a + (a * 255 << 16)
+									+ ((dst >> 8) & 0x00FF00FF) * ia;
+			return div255Lanes(rb) | div255Lanes(ag) << 8;
+		}
+	};
+
+	template <> struct Blend<BLEND_ADD>
+	{
+		static inline unsigned int apply(unsigned int src, unsigned int dst)
+		{
+			const unsigned int a = src >> 24;
+			const unsigned int rb = div255Lanes((src & 0x00FF00FF) * a);
+			const unsigned int ag = div255Lanes(((src >> 8) & 0xFF) * a) | (a << 16);
+			return addSaturateLanes(rb, dst & 0x00FF00FF)
+				| addSaturateLanes(ag, (dst >> 8) & 0x00FF00FF) << 8;
+		}
+	};
+
+	template <PixelFormat F, BlendMode B>
+	struct PixelWriter
+	{
+		typedef PixelTraits<F> T;
+		static inline void write(typename T::type* p, unsigned int color, typename T::type)
+		{ *p = T::pack(Blend<B>::apply(color, T::unpack(*p, nullptr))); }
+	};
+
+	template <PixelFormat F>
+	struct PixelWriter<F, BLEND_REPLACE>
+	{
+		typedef PixelTraits<F> T;
+		static inline void write(typename T::type* p, unsigned int, typename T::type packed)
+		{ *p = packed; }
+	};
+
+	template <PixelFormat F, BlendMode B>
+	void plotKernel(unsigned char* row, int x, unsigned int color)
+	{
+		typedef PixelTraits<F> T;
+		PixelWriter<F,B>::write(reinterpret_cast<typename T::type*>(row) + x,
+								color, T::pack(color));
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void spanKernel(unsigned char* row, int x, int length, unsigned int color)
+	{
+		typedef PixelTraits<F> T;
+		typename T::type* p = reinterpret_cast<typename T::type*>(row) + x;
+		const typename T::type packed = T::pack(color);
+		for (int i = 0 ; i < length ; i++)
+			PixelWriter<F,B>::write(p + i, color, packed);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void columnKernel(unsigned char* pixels, int pitch, int x, int y, int length,
+						unsigned int color)
+	{
+		typedef PixelTraits<F> T;
+		const typename T::type packed = T::pack(color);
+		unsigned char* row = pixels + (long long)pitch*y;
+		for (int i = 0 ; i < length ; i++, row += pitch)
+			PixelWriter<F,B>::write(reinterpret_cast<typename T::type*>(row) + x, color, packed);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void columnsKernel(unsigned char* pixels, int pitch, const int* xs, int count,
+						int y, int length, unsigned int color)
+	{
+		typedef PixelTraits<F> T;
+		const typename T::type packed = T::pack(color);
+		unsigned char* row = pixels + (long long)pitch*y;
+		for (int i = 0 ; i < length ; i++, row += pitch)
+		{
+			typename T::type* p = reinterpret_cast<typename T::type*>(row);
+			for (int k = 0 ; k < count ; k++)
+				PixelWriter<F,B>::write(p + xs[k], color, packed);
+		}
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void lineXKernel(unsigned char* pixels, int pitch, int x0, int x1,
+						long long y, long long slope, unsigned int color)
+	{
+		typedef PixelTraits<F> T;
+		const typename T::type packed = T::pack(color);
+		for (int x = x0 ; x <= x1 ; x++, y += slope)
+			PixelWriter<F,B>::write(
+				reinterpret_cast<typename T::type*>(pixels + pitch*(y >> 16)) + x,
+				color, packed);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void lineYKernel(unsigned char* pixels, int pitch, int y0, int y1,
+						long long x, long long slope, unsigned int color)
+	{
+		typedef PixelTraits<F> T;
+		const typename T::type packed = T::pack(color);
+		unsigned char* row = pixels + (long long)pitch*y0;
+		for (int y = y0 ; y <= y1 ; y++, x += slope, row += pitch)
+			PixelWriter<F,B>::write(
+				reinterpret_cast<typename T::type*>(row) + (x >> 16), color, packed);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	inline void writeShaded(unsigned char* row, int x, const ShadeColor& color)
+	{
+		typedef PixelTraits<F> T;
+		const unsigned int argb = color.argb();
+		PixelWriter<F,B>::write(reinterpret_cast<typename T::type*>(row) + x,
+								argb, T::pack(argb));
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void shadedSpanKernel(unsigned char* row, int x, int length,
+							ShadeColor color, ShadeColor inc)
+	{
+		for (int i = 0 ; i < length ; i++, color.advance(inc))
+			writeShaded<F,B>(row, x + i, color);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void shadedLineXKernel(unsigned char* pixels, int pitch, int x0, int x1,
+							long long y, long long slope, ShadeColor color, ShadeColor inc)
+	{
+		for (int x = x0 ; x <= x1 ; x++, y += slope, color.advance(inc))
+			writeShaded<F,B>(pixels + pitch*(y >> 16), x, color);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void shadedLineYKernel(unsigned char* pixels, int pitch, int y0, int y1,
+							long long x, long long slope, ShadeColor color, ShadeColor inc)
+	{
+		unsigned char* row = pixels + (long long)pitch*y0;
+		for (int y = y0 ; y <= y1 ; y++, x += slope, row += pitch, color.advance(inc))
+			writeShaded<F,B>(row, (int)(x >> 16), color);
+	}
+
+	template <PixelFormat F, BlendMode B>
+	void colorSpanKernel(unsigned char* row, int x, int length, const unsigned int* colors)
+	{
+		typedef PixelTraits<F> T;
+		typename T::type* p = reinterpret_cast<typename T::type*>(row) + x;
+		for (int i = 0 ; i < length ; i++)
+			PixelWriter<F,B>::write(p + i, colors[i], T::pack(colors[i]));
+	}
+
+	template <PixelFormat F, BlendMode B>
+	constexpr RasterKernels kernels(void)
+	{
+		return { plotKernel<F,B>, spanKernel<F,B>, columnKernel<F,B>, columnsKernel<F,B>,
+				lineXKernel<F,B>, lineYKernel<F,B>,
+				shadedSpanKernel<F,B>, shadedLineXKernel<F,B>, shadedLineYKernel<F,B>,
+				colorSpanKernel<F,B> };
+	}
+
+	const RasterKernels KERNELS[PIXEL_FORMAT_COUNT][BLEND_MODE_COUNT] = {
+		{ kernels<PIXEL_ARGB8888, BLEND_REPLACE>(),
+		  kernels<PIXEL_ARGB8888, BLEND_ALPHA>(),
+		  kernels<PIXEL_ARGB8888, BLEND_ADD>() },
+		{ kernels<PIXEL_ABGR8888, BLEND_REPLACE>(),
+		  kernels<PIXEL_ABGR8888, BLEND_ALPHA>(),
+		  kernels<PIXEL_ABGR8888, BLEND_ADD>() },
+		{ kernels<PIXEL_RGB565, BLEND_REPLACE>(),
+		  kernels<PIXEL_RGB565, BLEND_ALPHA>(),
+		  kernels<PIXEL_RGB565, BLEND_ADD>() },
+		{ kernels<PIXEL_GRAY8, BLEND_REPLACE>(),
+		  kernels<PIXEL_GRAY8, BLEND_ALPHA>(),
+		  kernels<PIXEL_GRAY8, BLEND_ADD>() },
+		{ kernels<PIXEL_INDEXED8, BLEND_REPLACE>(),
+		  kernels<PIXEL_INDEXED8, BLEND_REPLACE>(),
+		  kernels<PIXEL_INDEXED8, BLEND_REPLACE>() }
+	};
+}
+
+const RasterKernels& derplot::rasterKernels(PixelFormat format, BlendMode blend)
+{
+	return KERNELS[format][blend];
+}
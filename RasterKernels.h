@@ -0,0 +1,136 @@
+/** \file RasterKernels.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ *
+ * \brief Pixel writing kernels used by the rasterizer.
+ *
+ * Each set of kernels is a template instantiated on the pixel format of the buffer
+ * and on the blend mode, so that the inner loops contain no run-time checks. The
+ * renderer picks the set of kernels from a dispatch table only when its state changes
+ * (such as when a new blend mode is defined). Kernels do not clip: the caller must
+ * guarantee that every pixel they touch is inside the buffer.
+ */
+#pragma once
+
+#include "PixelFormat.h"
+
+namespace derplot
+{
+
+enum BlendMode : unsigned char
+{
+	BLEND_REPLACE = 0x00, ///< the color replaces the pixel
+	BLEND_ALPHA   = 0x01, ///< the color is composed over the pixel using its alpha
+	BLEND_ADD     = 0x02  ///< the color, scaled by its alpha, is added to the pixel
+};
+
+/** Number of supported blend modes */
+constexpr int BLEND_MODE_COUNT = 3;
+
+/**
+ * \brief A color with each channel in 8.16 fixed point, used to interpolate colors
+ * from pixel to pixel (Gouraud shading).
+ *
+ * The channels are kept biased by half a unit, so that truncating them to
+ * 8 bits rounds to the nearest value.
+ */
+struct ShadeColor
+{
+	int a, r, g, b;
+
+	/** \return the fixed point form of an ARGB color */
+	static ShadeColor of(unsigned int argb)
+	{
+		return { (int)(argb >> 24) << 16 | 0x8000, (int)((argb >> 16) & 0xFF) << 16 | 0x8000,
+				(int)((argb >> 8) & 0xFF) << 16 | 0x8000, (int)(argb & 0xFF) << 16 | 0x8000 };
+	}
+
+	/** \return the increment that reaches the color \b to from \b from in \b steps steps.
+	 * Both colors must be within range, and so are all colors in between. */
+	static ShadeColor step(const ShadeColor& from, const ShadeColor& to, int steps)
+	{
+		if (steps <= 0) return { 0, 0, 0, 0 };
+		return { (to.a - from.a) / steps, (to.r - from.r) / steps,
+				(to.g - from.g) / steps, (to.b - from.b) / steps };
+	}
+
+	/** \return the color at step \b t of the \b steps steps from \b from to \b to */
+	static ShadeColor lerp(const ShadeColor& from, const ShadeColor& to, long long t, long long steps)
+	{
+		if (steps <= 0) return from;
+		return { from.a + (int)((long long)(to.a - from.a) * t / steps),
+				from.r + (int)((long long)(to.r - from.r) * t / steps),
+				from.g + (int)((long long)(to.g - from.g) * t / steps),
+				from.b + (int)((long long)(to.b - from.b) * t / steps) };
+	}
+
+	/** \return the ARGB color */
+	unsigned int argb(void) const
+	{
+		return (unsigned int)(a >> 16) << 24 | (unsigned int)(r >> 16) << 16
+				| (unsigned int)(g >> 16) << 8 | (unsigned int)(b >> 16);
+	}
+
+	/** Advances the color by one increment */
+	void advance(const ShadeColor& inc)
+	{ a += inc.a; r += inc.r; g += inc.g; b += inc.b; }
+};
+
+/**
+ * \brief Set of rasterization kernels for a pixel format and blend mode.
+ *
+ * Lines are stepped in 16.16 fixed point along the major axis: the minor coordinate
+ * of each pixel is <tt>v >> 16</tt>, where \c v starts with the given value and is
+ * incremented by \c slope on each step.
+ */
+struct RasterKernels
+{
+	/** Writes the pixel at column \b x of the row */
+	void (*plot)(unsigned char* row, int x, unsigned int color);
+
+	/** Writes \b length pixels of the row, starting at column \b x */
+	void (*span)(unsigned char* row, int x, int length, unsigned int color);
+
+	/** Writes \b length pixels of column \b x , starting at row \b y */
+	void (*column)(unsigned char* pixels, int pitch, int x, int y, int length,
+					unsigned int color);
+
+	/** Writes \b length pixels of each of \b count columns, starting at row \b y ,
+	 * one row after the other */
+	void (*columns)(unsigned char* pixels, int pitch, const int* xs, int count,
+					int y, int length, unsigned int color);
+
+	/** Writes an X-major line, from column \b x0 to \b x1 (inclusive) */
+	void (*lineX)(unsigned char* pixels, int pitch, int x0, int x1,
+					long long y, long long slope, unsigned int color);
+
+	/** Writes a Y-major line, from row \b y0 to \b y1 (inclusive) */
+	void (*lineY)(unsigned char* pixels, int pitch, int y0, int y1,
+					long long x, long long slope, unsigned int color);
+
+	/** Writes \b length pixels of the row, starting at column \b x with \b color
+	 * and advancing the color by \b inc on each pixel */
+	void (*shadedSpan)(unsigned char* row, int x, int length,
+					ShadeColor color, ShadeColor inc);
+
+	/** Writes an X-major line as \c lineX , advancing the color by \b inc on each pixel */
+	void (*shadedLineX)(unsigned char* pixels, int pitch, int x0, int x1,
+					long long y, long long slope, ShadeColor color, ShadeColor inc);
+
+	/** Writes a Y-major line as \c lineY , advancing the color by \b inc on each pixel */
+	void (*shadedLineY)(unsigned char* pixels, int pitch, int y0, int y1,
+					long long x, long long slope, ShadeColor color, ShadeColor inc);
+
+	/** Writes \b length pixels of the row, starting at column \b x , with one
+	 * ARGB color each */
+	void (*colorSpan)(unsigned char* row, int x, int length, const unsigned int* colors);
+};
+
+/**
+ * \return the set of kernels for the given pixel format and blend mode. Palette
+ * indices cannot be blended, so all blend modes behave as \c BLEND_REPLACE
+ * for \c PIXEL_INDEXED8 .
+ */
+const RasterKernels& rasterKernels(PixelFormat format, BlendMode blend);
+
+};
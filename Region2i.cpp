@@ -100,7 +100,7 @@ bool Region2i::posOf(float x, float y, int& px, int& py) const
 
 	px = x_min + (int)(xdelta*(x+1)*0.5);
 	py = y_max - (int)(ydelta*(y+1)*0.5);
-	return !(x < 0 || x >= 1 || y < 0 || y >= 1);
+	return !(x < -1 || x >= 1 || y <= -1 || y > 1);
 }
 
 int Region2i::area(void) const
@@ -108,6 +108,44 @@ int Region2i::area(void) const
 	return (x_max - x_min)*(y_max - y_min);
 }
 
+bool Region2i::isEmpty(void) const
+{
+	return x_max <= x_min || y_max <= y_min;
+}
+
+bool Region2i::intersects(const Region2i& other) const
+{
+	return this->x_min < other.x_max && other.x_min < this->x_max
+		&& this->y_min < other.y_max && other.y_min < this->y_max;
+}
+
+bool Region2i::touches(const Region2i& other) const
+{
+	return this->x_min <= other.x_max && other.x_min <= this->x_max
+		&& this->y_min <= other.y_max && other.y_min <= this->y_max;
+}
+
+Region2i& Region2i::unite(const Region2i& other)
+{
+	if (other.isEmpty()) return *this;
+	if (this->isEmpty()) return *this = other;
+	if (other.x_min < this->x_min) this->x_min = other.x_min;
+	if (other.x_max > this->x_max) this->x_max = other.x_max;
+	if (other.y_min < this->y_min) this->y_min = other.y_min;
+	if (other.y_max > this->y_max) this->y_max = other.y_max;
+	return *this;
+}
+
+Region2i& Region2i::intersect(const Region2i& other)
+{
+	if (other.x_min > this->x_min) this->x_min = other.x_min;
+	if (other.x_max < this->x_max) this->x_max = other.x_max;
+	if (other.y_min > this->y_min) this->y_min = other.y_min;
+	if (other.y_max < this->y_max) this->y_max = other.y_max;
+	fix();
+	return *this;
+}
+
 void Region2i::fix(void)
 {
 	if (x_max < x_min) x_max = x_min;
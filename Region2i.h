@@ -94,6 +94,36 @@ class Region2i
 		 */
 		int area(void) const;
 
+		/**
+		 * \return whether the region contains no pixels
+		 */
+		bool isEmpty(void) const;
+
+		/**
+		 * \return whether the two regions share at least one pixel
+		 */
+		bool intersects(const Region2i& other) const;
+
+		/**
+		 * \return whether the two regions share at least one pixel
+		 * or are adjacent to each other
+		 */
+		bool touches(const Region2i& other) const;
+
+		/**
+		 * Expands the region to the bounding box of both regions.
+		 * Empty regions are ignored.
+		 * \return the region itself
+		 */
+		Region2i& unite(const Region2i& other);
+
+		/**
+		 * Shrinks the region to the pixels it shares with the other region.
+		 * The region becomes empty if they don't intersect.
+		 * \return the region itself
+		 */
+		Region2i& intersect(const Region2i& other);
+
 	protected:
 	private:
 		void fix(void);
@@ -4,7 +4,9 @@
  */
 
 #include "Renderer.h"
+#include "Trace.h"
 
+#include <algorithm>
 #include <string.h>
 
 #ifdef Derplotter_DEBUG
@@ -15,20 +17,46 @@ static void DEBUG(const char* s)
 static void DEBUG(const char* s){}
 #endif
 
+#ifdef Derplotter_PROFILE
+#include <chrono>
+typedef std::chrono::steady_clock profile_clock;
+static unsigned long long nanosecondsSince(profile_clock::time_point t)
+	{ return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				profile_clock::now() - t).count(); }
+#endif
+
 using namespace derplot;
 using namespace op;
 using namespace math;
 
 Renderer::Renderer()
-:	ok(false)
+:	q_capacity(0)
+,	q_policy(QUEUE_BLOCK)
+,	executing(false)
+,	supersampling_ops(0)
+,	supersampled(false)
+,	failed_saves(0)
+,	batch_size(DEFAULT_BATCH_SIZE)
+,	ok(false)
 {}
 
-Renderer::Renderer(int width, int height, void* extern_buffer)
-:	buffer(width, height, extern_buffer)
+Renderer::Renderer(int width, int height, void* extern_buffer,
+					int pitch, PixelFormat format)
+:	buffer(width, height, extern_buffer, pitch, format)
 ,	program(buffer)
-,	ok(true)
-,	thread(run, this)
-{}
+,	q_capacity(0)
+,	q_policy(QUEUE_BLOCK)
+,	executing(false)
+,	supersampling_ops(0)
+,	supersampled(false)
+,	failed_saves(0)
+,	batch_size(DEFAULT_BATCH_SIZE)
+,	ok(!!buffer)
+{
+	// an unusable buffer leaves the renderer stopped, with no thread to join
+	if (this->ok)
+		this->thread = std::thread(run, this);
+}
 
 Renderer::~Renderer()
 {}
@@ -41,100 +69,296 @@ bool Renderer::operator!(void) const
 int Renderer::bufferCopy(void* dest) const
 {
 	if (!(*this) || dest == nullptr) return 0;
-	memcpy(dest, this->buffer.data(),
-			buffer.getWidth()*buffer.getHeight()*sizeof(unsigned int));
+	memcpy(dest, this->buffer.data(), (size_t)buffer.getPitch()*buffer.getHeight());
 	return 1;
 }
 
-Renderer& Renderer::operator>>(op::RendererOperation* op)
+int Renderer::copyDirtyRegions(void* dest, std::vector<Region2i>* regions)
 {
-	if (!(*this)) return *this;
-	std::unique_lock<std::mutex> q_lock(this->q_mutex);
-	this->q.emplace(op);
-	this->q_hasOp.notify_all();
-	q_lock.unlock();
-	return *this;
+	if (!(*this) || dest == nullptr) return 0;
+	const int pitch = buffer.getPitch();
+	const int bpp = bytesPerPixel(buffer.getFormat());
+	for (const Region2i& r : program.dirtyRegions())
+	{
+		const size_t offset = (size_t)pitch*r.getMinY() + r.getMinX()*bpp;
+		const unsigned char* src = (const unsigned char*)this->buffer.data() + offset;
+		unsigned char* dst = (unsigned char*)dest + offset;
+		const size_t len = (r.getMaxX() - r.getMinX())*bpp;
+		for (int y = r.getMinY() ; y < r.getMaxY() ; y++, src += pitch, dst += pitch)
+			memcpy(dst, src, len);
+	}
+	if (regions != nullptr)
+		*regions = program.dirtyRegions();
+	program.resetDirtyRegions();
+	return 1;
 }
 
-void Renderer::flush(void)
+int Renderer::enqueue(op::RendererOperation* op)
 {
-	if (!(*this)) return;
-	std::unique_lock<std::mutex> q_lock(this->q_mutex);
-	if (!q.empty())
-		q_empty.wait(q_lock);
+	std::unique_ptr<RendererOperation> p_op(op);
+	if (!(*this)) return 1;
+	std::lock_guard<std::mutex> s_lock(this->stage_mutex);
+	if (this->q_capacity != 0 && this->q_policy == QUEUE_FAIL
+			&& op->getType() != OP_TERMINATE)
+	{
+		// reject it now, while the caller can still be told
+		std::unique_lock<std::mutex> q_lock(this->q_mutex);
+		if (this->q.size() + this->staged.size() >= this->q_capacity
+				&& !this->staged.empty())
+		{
+			q_lock.unlock();
+			this->publish(); // the staged operations may fit in the queue
+			q_lock.lock();
+		}
+		if (this->q.size() + this->staged.size() >= this->q_capacity)
+		{
+#ifdef Derplotter_PROFILE
+			this->profile.ops_dropped++;
+#endif
+			return 1;
+		}
+	}
+	if (p_op->getType() == OP_SUPERSAMPLING)
+		this->supersampling_ops++;
+	this->staged.push_back(std::move(p_op));
+	if (this->staged.size() >= this->batch_size)
+		return this->publish();
+	return 0;
 }
 
-void Renderer::terminate(void)
+int Renderer::publish(void)
 {
-	if (!(*this)) return;
-	*this >> new Terminate;
-	thread.join();
+	if (this->staged.empty()) return 0;
+#ifdef Derplotter_PROFILE
+	const profile_clock::time_point start = profile_clock::now();
+#endif
+	std::unique_lock<std::mutex> q_lock(this->q_mutex);
+	int r = 0;
+	if (this->q_policy == QUEUE_FAIL && this->q_capacity != 0
+			&& this->q.size() + this->staged.size() > this->q_capacity)
+	{
+		// the capacity was reduced since the operations were staged: they are rejected
+		// together, so that the operations of a command buffer are never run in part
+		for (std::unique_ptr<RendererOperation>& op : this->staged)
+		{
+			if (op->getType() == OP_TERMINATE)
+				this->q.push_back(std::move(op));
+			else
+			{
+#ifdef Derplotter_PROFILE
+				this->profile.ops_dropped++;
+#endif
+				if (op->getType() == OP_SUPERSAMPLING)
+					this->supersampling_ops--;
+			}
+		}
+		this->staged.clear();
+		r = 1;
+	}
+	for (std::unique_ptr<RendererOperation>& op : this->staged)
+	{
+		if (!this->ok)
+		{
+			r = 1;
+			break;
+		}
+		if (this->q_capacity != 0 && this->q.size() >= this->q_capacity
+				&& op->getType() != OP_TERMINATE)
+		{
+			if (this->q_policy == QUEUE_DROP_OLDEST_FRAME)
+				while (this->q.size() >= this->q_capacity && this->dropOldestFrame()) {}
+			if (this->q.size() >= this->q_capacity)
+			{
+				DERPLOTTER_TRACE_SCOPE("queue full");
+				this->q_hasOp.notify_one(); // let the renderer take what is queued
+				this->q_notFull.wait(q_lock, [this] {
+					return this->q_capacity == 0 || this->q.size() < this->q_capacity
+							|| !this->ok; });
+				if (!this->ok)
+				{
+					r = 1;
+					break;
+				}
+			}
+		}
+		this->q.push_back(std::move(op));
+	}
+	this->staged.clear();
+#ifdef Derplotter_PROFILE
+	this->profile.producer_wait += nanosecondsSince(start);
+	if (this->q.size() > this->profile.queue_high_water)
+		this->profile.queue_high_water = this->q.size();
+#endif
+	this->q_hasOp.notify_one();
+	return r;
 }
 
-void Renderer::clear(void)
-{	*this >> new Clear(); }
-
-void Renderer::drawRawPoint(std::pair<int,int> p)
-{	*this >> new RawPoint(p, 0); }
-
-void Renderer::drawRawBigPoint(std::pair<int,int> p)
-{	*this >> new RawPoint(p, 1); }
-
-void Renderer::drawRawLine(std::pair<int,int> point1, std::pair<int,int> point2)
-{	*this >> new RawLine(point1, point2); }
-
-void Renderer::drawPoint(const Vector4f& p)
-{	*this >> new Point(p, 0); }
-
-void Renderer::drawBigPoint(const Vector4f& p)
-{	*this >> new Point(p, 1); }
+int Renderer::submit(void)
+{
+	if (!(*this)) return 1;
+	std::lock_guard<std::mutex> s_lock(this->stage_mutex);
+	return this->publish();
+}
 
-void Renderer::drawLine(const math::Vector4f& point1, const math::Vector4f& point2)
-{	*this >> new Line(point1, point2); }
+int Renderer::submit(CommandBuffer& buffer)
+{
+	CommandBuffer* p_buffer = &buffer;
+	return this->submitBuffers(&p_buffer, 1);
+}
 
-void Renderer::orthoProjection(float left, float right, float bottom, float top,
-					float near, float far)
-{ *this >> new Ortho(left, right, top, bottom, near, far); }
+int Renderer::submit(const std::vector<CommandBuffer*>& buffers)
+{
+	return this->submitBuffers(buffers.data(), buffers.size());
+}
 
-void Renderer::perspectiveProjection(float fovy, float near,
-					float far, float aspect_ratio)
-{ *this >> new Perspective(fovy, near, far, aspect_ratio); }
+int Renderer::submitBuffers(CommandBuffer* const* buffers, size_t count)
+{
+	if (!(*this)) return 1;
+	size_t total = 0;
+	for (size_t i = 0 ; i < count ; i++)
+		if (buffers[i] != nullptr) total += buffers[i]->size();
 
-void Renderer::setProjectionMatrix(const math::Mat4x4f& mat)
-{ *this >> new MatrixSet(mat, 1); }
+	std::lock_guard<std::mutex> s_lock(this->stage_mutex);
+	if (this->q_capacity != 0 && this->q_policy == QUEUE_FAIL)
+	{
+		// all operations of the buffers are submitted, or none at all
+		this->publish();
+		std::lock_guard<std::mutex> q_lock(this->q_mutex);
+		if (this->q.size() + total > this->q_capacity)
+		{
+#ifdef Derplotter_PROFILE
+			this->profile.ops_dropped += total;
+#endif
+			return 1;
+		}
+	}
+	this->staged.reserve(this->staged.size() + total);
+	for (size_t i = 0 ; i < count ; i++)
+	{
+		if (buffers[i] == nullptr) continue;
+		for (std::unique_ptr<RendererOperation>& op : buffers[i]->ops)
+		{
+			if (op->getType() == OP_SUPERSAMPLING)
+				this->supersampling_ops++;
+			this->staged.push_back(std::move(op));
+		}
+		buffers[i]->ops.clear();
+	}
+	return this->publish();
+}
 
-void Renderer::setModelViewMatrix(const math::Mat4x4f& mat)
-{ *this >> new MatrixSet(mat, 0); }
+void Renderer::setBatchSize(size_t ops)
+{
+	std::lock_guard<std::mutex> s_lock(this->stage_mutex);
+	this->batch_size = (ops > 0) ? ops : 1;
+	if (this->staged.size() >= this->batch_size)
+		this->publish();
+}
 
-void Renderer::translate(const math::Vector4f& v, int matrix)
-{ *this >> new MatrixTranslate(v, matrix); }
+bool Renderer::dropOldestFrame(void)
+{
+	auto isFrameStart = [](const std::unique_ptr<RendererOperation>& op) {
+		return op->getType() == OP_CLEAR || op->getType() == OP_CLEAR_DRAWN; };
+	auto isDrawing = [](const std::unique_ptr<RendererOperation>& op) {
+		const OperationType type = op->getType();
+		return type == OP_RAW_POINT || type == OP_RAW_LINE
+			|| type == OP_POINT || type == OP_LINE || type == OP_DRAW_ARRAYS
+			|| type == OP_DRAW_BUFFER || type == OP_DRAW_ELEMENTS
+			|| type == OP_DRAW_BUFFER_ELEMENTS || type == OP_DRAW_VIEWPORTS
+			|| type == OP_BLIT || type == OP_DRAW_TEXT
+			|| type == OP_DRAW_GRID || type == OP_DRAW_AXIS; };
+	auto mustKeep = [](const std::unique_ptr<RendererOperation>& op) {
+		return op->getType() == OP_RENDER_TARGET || op->getType() == OP_SAVE_IMAGE; };
+
+	// frames are delimited by clears, and the last frame in queue is never complete;
+	// state changes are kept so that the following frames are not affected
+	auto first = this->q.begin();
+	while (first != this->q.end())
+	{
+		auto last = std::find_if(first + 1, this->q.end(), isFrameStart);
+		if (last == this->q.end()) break;
+		// offscreen targets may be drawn once and composed in later frames,
+		// and a saved image must show the frame it was requested for
+		if (std::find_if(first, last, mustKeep) != last)
+		{
+			first = last;
+			continue;
+		}
+		auto kept = std::remove_if(first, last, isDrawing);
+		if (kept != last)
+		{
+#ifdef Derplotter_PROFILE
+			this->profile.ops_dropped += last - kept;
+#endif
+			this->q.erase(kept, last);
+			return true;
+		}
+		first = last;
+	}
+	return false;
+}
 
-void Renderer::rotateX(float x_angle, int matrix)
-{ *this >> new MatrixRotate(x_angle, 0, matrix); }
+void Renderer::flush(void)
+{
+	if (!(*this)) return;
+	DERPLOTTER_TRACE_SCOPE("flush");
+	if (this->supersampled || this->supersampling_ops > 0)
+		this->resolve();
+	this->submit();
+	std::unique_lock<std::mutex> q_lock(this->q_mutex);
+	q_empty.wait(q_lock, [this] {
+		return (this->q.empty() && !this->executing) || !this->ok; });
+}
 
-void Renderer::rotateY(float y_angle, int matrix)
-{ *this >> new MatrixRotate(y_angle, 1, matrix); }
+void Renderer::setQueueCapacity(size_t capacity, QueuePolicy policy)
+{
+	std::lock_guard<std::mutex> s_lock(this->stage_mutex);
+	std::lock_guard<std::mutex> q_lock(this->q_mutex);
+	this->q_capacity = capacity;
+	this->q_policy = policy;
+	this->q_notFull.notify_all();
+}
 
-void Renderer::rotateZ(float z_angle, int matrix)
-{ *this >> new MatrixRotate(z_angle, 2, matrix); }
+RendererStats Renderer::stats(void)
+{
+	std::lock_guard<std::mutex> q_lock(this->q_mutex);
+	return this->profile;
+}
 
-void Renderer::scale(const math::Vector4f& v, int matrix)
-{ *this >> new MatrixScale(v, matrix); }
+void Renderer::resetStats(void)
+{
+	std::lock_guard<std::mutex> q_lock(this->q_mutex);
+	this->profile.reset();
+}
 
-void Renderer::front_color(unsigned int color)
-{ *this >> new FrontColor(color); }
+unsigned int Renderer::failedSaves(void)
+{
+	return this->failed_saves.exchange(0);
+}
 
-void Renderer::clear_color(unsigned int color)
-{ *this >> new ClearColor(color); }
+void Renderer::terminate(void)
+{
+	if (!(*this)) return;
+	this->enqueue(new Terminate);
+	this->submit();
+	thread.join();
+}
 
-void Renderer::setViewPort(const math::Region2i& viewport)
-{ *this >> new ViewPort(viewport); }
+int Renderer::saveImage(const char* path, ImageFormat format, PngFilter filter)
+{
+	if (RendererInvoker::saveImage(path, format, filter) != 0) return 1;
+	return this->submit();
+}
 
 void Renderer::run(Renderer* renderer)
 {
 	DEBUG("I live!");
+	trace::setThreadName("Renderer");
 	bool running = true;
-	RendererOperation* op = nullptr;
+	std::deque<std::unique_ptr<RendererOperation>> batch;
+#ifdef Derplotter_PROFILE
+	RendererStats batch_stats;
+#endif
 	do
 	{
 		std::unique_lock<std::mutex> q_lock(renderer->q_mutex);
@@ -143,35 +367,71 @@ void Renderer::run(Renderer* renderer)
 		if (renderer->q.empty())
 		{
 			DEBUG("Waiting for operation...");
-			renderer->q_hasOp.wait(q_lock);
+			DERPLOTTER_TRACE_SCOPE("wait");
+			renderer->q_hasOp.wait(q_lock, [renderer] { return !renderer->q.empty(); });
 			DEBUG("Woken up by \"hasOp\"\n");
 		}
 
-		// retrieve operation from operation queue
-		op = (RendererOperation*) renderer->q.front().release();
-		renderer->q.pop();
+		// retrieve all operations from operation queue at once
+		batch.swap(renderer->q);
+		renderer->executing = true;
+		if (renderer->q_capacity != 0)
+			renderer->q_notFull.notify_all();
 
 		q_lock.unlock();
 
-		if (op == nullptr) continue;
-
 		DEBUG("Executing...");
-		int r = op->onDispatch(renderer->program); // dispatch operation
+#ifdef Derplotter_TRACE
+		const unsigned long long batch_begin = trace::now();
+#endif
+		unsigned int supersampling_ops = 0;
+		for (std::unique_ptr<RendererOperation>& op : batch)
+		{
+			const OperationType type = op->getType();
+#ifdef Derplotter_PROFILE
+			const profile_clock::time_point start = profile_clock::now();
+			int r = op->onDispatch(renderer->program); // dispatch operation
+			batch_stats.op_count[type]++;
+			batch_stats.op_time[type] += nanosecondsSince(start);
+#else
+			int r = op->onDispatch(renderer->program); // dispatch operation
+#endif
+			if (type == OP_SUPERSAMPLING)
+				supersampling_ops++;
+			else if (type == OP_SAVE_IMAGE && r != 0)
+				renderer->failed_saves++;
+			if (r == -1) // termination code
+			{
+				running = false;
+				break;
+			}
+		}
+		// the new state is known before the changes stop counting
+		renderer->supersampled = renderer->program.getSupersampling() > 1;
+		renderer->supersampling_ops -= supersampling_ops;
+#ifdef Derplotter_TRACE
+		trace::record("batch", batch_begin, trace::now(), "ops", batch.size());
+#endif
+		batch.clear();
 		DEBUG("Done Executing.");
 
-		delete op;
-
-		if (r == -1) // termination code
+		q_lock.lock();
+		renderer->executing = false;
+		if (!running)
 		{
 			DEBUG("Terminating...");
-			q_lock.lock();
-			while (!renderer->q.empty()) renderer->q.pop(); // clear queue
-			running = false;
+			renderer->q.clear(); // clear queue
 			renderer->ok = false;
-			q_lock.unlock();
+			renderer->q_notFull.notify_all();
 		}
-
-		q_lock.lock();
+#ifdef Derplotter_PROFILE
+		RendererProgram& program = renderer->program;
+		batch_stats.pixels_written = program.pixels_written;
+		batch_stats.primitives_culled = program.primitives_culled;
+		program.pixels_written = program.primitives_culled = 0;
+		renderer->profile.add(batch_stats);
+		batch_stats.reset();
+#endif
 		if (renderer->q.empty())
 		{
 			DEBUG("Operation queue is empty. Signalling now.");
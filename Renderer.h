@@ -6,8 +6,9 @@
  *
  * When constructing a renderer, the display dimensions and a buffer large enough for
  * containing the whole pixels of the buffer are passed. If no buffer is specified,
- * an internal buffer is created. All buffers have a color depth of 32 bits and have
- * no additional padding bytes.
+ * an internal buffer is created. By default, buffers have a color depth of 32 bits
+ * (ARGB) and have no additional padding bytes. The buffer's pitch and pixel format can
+ * also be specified, so that the renderer can draw directly onto an external surface.
  *
  * Once the renderer is created, the operation invocation functions are used to send
  * the data blocks describing the full operation to perform in an internal operation
@@ -22,6 +23,23 @@
  * thread. The \c flush() function makes the caller thread wait until there are no more
  * operations left on the operation queue.
  *
+ * Invoked operations are first staged on the caller's side, and handed over to the
+ * rendering thread in batches, waking it up only once per batch. A batch is handed over
+ * when it reaches the batch size (see \c setBatchSize() ), on \c flush() , or
+ * explicitly with \c submit() .
+ *
+ * The invocation functions are not meant for concurrent callers, since their operations
+ * would be interleaved unpredictably. Instead, each thread can record its operations
+ * into its own \c CommandBuffer , and the command buffers are then submitted to the
+ * renderer in a defined order.
+ *
+ * By default, the operation queue is unbounded. A capacity can be defined with
+ * \c setQueueCapacity() , along with the policy to follow when the queue is full:
+ * blocking the caller until there is room, dropping the drawing operations of the oldest
+ * queued frame (frames start with \c clear() or \c clearDrawn() ), or rejecting the
+ * operation. All invocation functions return 0 when the operation is queued, or 1 when
+ * it is rejected (including when the renderer is not ready).
+ *
  * The \c terminate() function can be called to nicely terminate the renderer's process,
  * making it no longer usable. Invocation operations on the renderer will not be passed
  * to the operation queue, but the buffer can still be read for as long as it remains on
@@ -32,6 +50,10 @@
  * executed in the renderer thread. If an internal buffer is used, the result data
  * can be copied to a buffer using <tt>bufferCopy(void*)</tt>, under the same conditions
  * of reading access to an external buffer.
+ *
+ * When the library is compiled with the \c Derplotter_PROFILE macro defined, the
+ * renderer keeps profiling counters of its operations, which can be retrieved with
+ * <tt>stats()</tt> and reset with <tt>resetStats()</tt> (such as once per frame).
  */
 
 #pragma once
@@ -41,24 +63,50 @@
 #include "Vector4f.h"
 #include "RendererProgram.h"
 #include "RendererOps.h"
+#include "RendererInvoker.h"
+#include "CommandBuffer.h"
+#include "RendererStats.h"
 #include <memory>
-#include <queue>
+#include <atomic>
+#include <deque>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <vector>
 
 namespace derplot
 {
 
-class Renderer
+/** Policy followed when an operation is passed to a full operation queue */
+enum QueuePolicy : unsigned char
+{
+	QUEUE_BLOCK             = 0x00, ///< the caller waits until there is room
+	QUEUE_DROP_OLDEST_FRAME = 0x01, ///< drawing operations of the oldest frame are dropped
+	QUEUE_FAIL              = 0x02  ///< the operation is rejected
+};
+
+class Renderer : public RendererInvoker
 {
 	private:
 		DisplayBuffer buffer;
 		RendererProgram program;
 
-		std::queue<std::unique_ptr<op::RendererOperation>> q;
+		std::deque<std::unique_ptr<op::RendererOperation>> q;
 		std::mutex q_mutex;
-		std::condition_variable q_empty, q_hasOp;
+		std::condition_variable q_empty, q_hasOp, q_notFull;
+		size_t q_capacity; // 0 if unbounded
+		QueuePolicy q_policy;
+		bool executing; // whether an operation is being executed
+		// whether flushing must resolve: supersampling changes staged but not executed,
+		// and whether the program was supersampling after the last batch
+		std::atomic<unsigned int> supersampling_ops;
+		std::atomic<bool> supersampled;
+		std::atomic<unsigned int> failed_saves; // since the last call to failedSaves()
+
+		std::mutex stage_mutex; // locked before q_mutex when both are needed
+		std::vector<std::unique_ptr<op::RendererOperation>> staged;
+		size_t batch_size;
+		RendererStats profile; // guarded by q_mutex
 
 		volatile bool ok;
 		std::thread thread;
@@ -67,8 +115,17 @@ class Renderer
 		/** Default constructor */
 		Renderer();
 
-		/** Main Constructor */
-		Renderer(int width, int height, void* extern_buffer = nullptr);
+		/** Main Constructor
+		 * \param width
+		 * \param height
+		 * \param extern_buffer the buffer to draw on, or \c nullptr for
+		 * creating an internal buffer
+		 * \param pitch the number of bytes between the start of two rows, which
+		 * must be a multiple of the size of a pixel, or \c 0 if there is no padding
+		 * \param format the pixel format of the buffer
+		 */
+		Renderer(int width, int height, void* extern_buffer = nullptr,
+					int pitch = 0, PixelFormat format = PIXEL_ARGB8888);
 
 		/** Default destructor */
 		~Renderer();
@@ -84,215 +141,157 @@ class Renderer
 		bool operator!(void) const;
 
 		/** Makes the caller thread wait until the renderer
-		 * has finished all operations in queue.
+		 * has finished all operations in queue. When supersampling,
+		 * the changed samples are resolved into the buffer last.
 		 */
 		void flush(void);
 
-		/** Copies the current buffer content to the given destination buffer
-		 * \warning A buffer overflow will occur if the destination buffer isn't large
-		 * enough for the renderer's buffer contents (it must be at least 4*width*height
-		 * large, in bytes).
-		 * \param dest destination buffer
+		/** Hands the staged operations over to the rendering thread, without
+		 * waiting for them to be executed.
+		 * \return 0 on success, 1 if any operation was rejected
 		 */
-		int bufferCopy(void* dest) const;
-
-		/** Renderer program invocation
-		 *
-		 * Passes a termination operation and waits
-		 * until the renderer stops
+		int submit(void);
+
+		/** Submits the operations recorded in a command buffer, after the operations
+		 * already invoked on the renderer, and hands them all over to the rendering
+		 * thread. The command buffer is left empty, ready for recording again.
+		 * If the queue is bounded with \c QUEUE_FAIL and the operations do not fit,
+		 * none of them are submitted and the command buffer is left untouched.
+		 * \param buffer the command buffer to submit
+		 * \return 0 on success, 1 if the operations were rejected
 		 */
-		void terminate(void);
+		int submit(CommandBuffer& buffer);
 
-		/** Renderer program invocation
-		 *
-		 * Clears the whole display buffer using the current clear color
+		/** Submits the operations recorded in several command buffers, one buffer
+		 * after the other in the given order, as in \c submit(CommandBuffer&) .
+		 * No other operations are interleaved with them.
+		 * \param buffers the command buffers to submit, in order
+		 * \return 0 on success, 1 if the operations were rejected
 		 */
-		void clear(void);
+		int submit(const std::vector<CommandBuffer*>& buffers);
 
-		/** Renderer program invocation
-		 *
-		 * Draws a point at the specified pixel coordinates, with the current
-		 * front color. No transformations are applied. The pixel coordinates
-		 * are relative to the top-left corner.
-		 * \param point
+		/** Defines the number of staged operations which are automatically handed
+		 * over to the rendering thread. Larger batches reduce the synchronization
+		 * overhead, while smaller batches let the rendering thread start sooner.
+		 * \param ops the batch size, where \c 1 hands every operation over
+		 * immediately (default is \c DEFAULT_BATCH_SIZE )
 		 */
-		void drawRawPoint(std::pair<int,int> point);
-
-		/** Renderer program invocation
-		 *
-		 * Like in \c drawRawPoint() , this function draws a slightly bigger point
-		 * at the specified pixel coordinates, with the current front color. Adjacent up,
-		 * down, left and right pixels are also plotted.
-		 * \param point
-		 */
-		void drawRawBigPoint(std::pair<int,int> point);
-
-		/** Renderer program invocation
-		 *
-		 * Draws a line from \b point1 to \b point2 , with no transformations, using the
-		 * current front color. Point order is irrelevant.
-		 * \param point1
-		 * \param point2
-		 */
-		void drawRawLine(std::pair<int,int> point1, std::pair<int,int> point2);
-
-		/** Renderer program invocation
-		 *
-		 * Draws a 3D point. Modelview, projection and normalization transformations are
-		 * applied before drawing the result using the current front color.
-		 * \param point
+		void setBatchSize(size_t ops);
+
+		/** Limits the number of operations waiting in the queue. When the queue is
+		 * full, invocations follow the given policy. If the policy is
+		 * \c QUEUE_DROP_OLDEST_FRAME but the queue holds a single frame, the caller
+		 * waits as in \c QUEUE_BLOCK , since the frame being built is never dropped.
+		 * Neither are frames that switch render targets or save an image.
+		 * Terminating the renderer is never refused. With \c QUEUE_FAIL , staged
+		 * operations count towards the capacity, so that the invocation itself fails,
+		 * and operations staged before the capacity is reduced are rejected together if
+		 * they no longer fit; with the other policies, the capacity is enforced when a
+		 * batch is handed over.
+		 * \param capacity the maximum number of queued operations, or \c 0 for an
+		 * unbounded queue (the default)
+		 * \param policy the policy to follow when the queue is full
 		 */
-		void drawPoint(const math::Vector4f& point);
+		void setQueueCapacity(size_t capacity, QueuePolicy policy = QUEUE_BLOCK);
 
-		/** Renderer program invocation
-		 *
-		 * Behaves like \c drawPoint() , but draws a slightly bigger point.
-		 * \param point
-		 */
-		void drawBigPoint(const math::Vector4f& point);
-
-		/** Renderer program invocation
-		 *
-		 * Draws a line from two 3D points, using the current front color.
-		 * Modelview, projection and normalization transformations are applied before
-		 * drawing. Point order is irrelevant.
-		 * \param point1
-		 * \param point2
-		 */
-		void drawLine(const math::Vector4f& point1, const math::Vector4f& point2);
-
-		/** Renderer program invocation
-		 *
-		 * Passes the projection matrix being used to the renderer
-		 * \param mat the projection matrix
+		/** Copies the current buffer content to the given destination buffer, which
+		 * has the same pitch and pixel format of the renderer's buffer.
+		 * \warning A buffer overflow will occur if the destination buffer isn't large
+		 * enough for the renderer's buffer contents (it must be at least pitch*height
+		 * large, in bytes, which is 4*width*height for the default format).
+		 * \param dest destination buffer
 		 */
-		void setProjectionMatrix(const math::Mat4x4f& mat);
-
+		int bufferCopy(void* dest) const;
 
-		/** Renderer program invocation
-		 *
-		 * Applies an orthographic projection transformation in the projection matrix
-		 * according to the given parameters. The matrix is not modified if either one
-		 * of the parameters is invalid.
-		 * \param left the X minimum plane
-		 * \param right the X maximum plane
-		 * \param bottom the Y minimum plane
-		 * \param top the Y maximum plane
-		 * \param near the z near plane
-		 * \param far the z far plane
-		 * \param aspect_ratio the screen aspect ration
+		/** Copies the regions of the buffer changed since the last call to this
+		 * function to the given destination buffer, at the same positions. Only the
+		 * changed pixels are copied, which makes this function suitable for updating
+		 * a destination buffer that already holds the previous frame. The same
+		 * reading conditions and destination layout of \c bufferCopy() apply.
+		 * \warning A buffer overflow will occur if the destination buffer isn't large
+		 * enough for the renderer's buffer contents (it must be at least pitch*height
+		 * large, in bytes).
+		 * \param dest destination buffer
+		 * \param regions if not null, receives the list of copied regions
+		 * \return 1 on success, 0 if the renderer or destination buffer are not valid
 		 */
-		void orthoProjection(float left, float right, float bottom, float top,
-							float near, float far);
+		int copyDirtyRegions(void* dest, std::vector<math::Region2i>* regions = nullptr);
 
-		/** Renderer program invocation
-		 *
-		 * Applies a perspective projection transformation in the projection matrix
-		 * according to the given parameters. The matrix is not modified if either one
-		 * of the parameters is invalid.
-		 * \param fovy the Y Field of View angle in degrees
-		 * \param near the z near plane
-		 * \param far the z far plane
-		 * \param aspect_ratio the screen aspect ration
+		/** Retrieves a snapshot of the profiling counters. Operations still in the
+		 * queue are not accounted for, so this is usually called after a \c flush() .
+		 * All counters are zero if the library was not compiled with the
+		 * \c Derplotter_PROFILE macro defined.
+		 * \return the profiling counters since the last reset
 		 */
-		void perspectiveProjection(float fovy, float near, float far, float aspect_ratio);
+		RendererStats stats(void);
 
-		/** Renderer program invocation
-		 *
-		 * Passes the modelview matrix being used to the renderer
-		 * \param mat the modelview matrix
+		/** Sets all profiling counters to zero.
 		 */
-		void setModelViewMatrix(const math::Mat4x4f& mat);
+		void resetStats(void);
 
-		/** Renderer program invocation
-		 *
-		 * Performs a translation transformation on the selected matrix
-		 * used by the renderer. The transformation is ignored if the given matrix
-		 * identification number is invalid.
-		 * \param v the transformation vector
-		 * \param matrix the identification matrix
-		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		/** Counts the images that could not be encoded or written to their file since
+		 * the last call. Images are saved by the rendering thread, so \c flush() first
+		 * to include all images requested so far.
+		 * \return the number of failed image saves
 		 */
-		void translate(const math::Vector4f& v, int matrix = MATRIX_MODELVIEW);
+		unsigned int failedSaves(void);
 
 		/** Renderer program invocation
 		 *
-		 * Performs a rotation transformation, around the X axis, on the selected matrix
-		 * used by the renderer. The transformation is ignored if the given matrix
-		 * identification number is invalid.
-		 * \param x_angle the angle of the counterclockwise rotation, in radians
-		 * \param matrix the identification matrix
-		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 * Passes a termination operation and waits
+		 * until the renderer stops
 		 */
-		void rotateX(float x_angle, int matrix = MATRIX_MODELVIEW);
+		void terminate(void);
 
 		/** Renderer program invocation
 		 *
-		 * Performs a rotation transformation, around the Y axis, on the selected matrix
-		 * used by the renderer. The transformation is ignored if the given matrix
-		 * identification number is invalid.
-		 * \param y_angle the angle of the counterclockwise rotation, in radians
-		 * \param matrix the identification matrix
-		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 * Saves the contents of the display buffer to an image file, once all
+		 * previously invoked operations are performed. The operation is handed over
+		 * immediately, so the caller doesn't need to \c flush() nor copy the buffer.
+		 * Whether the file was written is reported later by \c failedSaves() .
+		 * \param path the path of the output file, not \c nullptr
+		 * \param format the file format ( \c IMAGE_QOI or \c IMAGE_PNG )
+		 * \param filter the PNG scanline filter, ignored for QOI images
+		 * \return 0 if the operation was handed over, 1 if the path is null or the
+		 * operation was rejected
 		 */
-		void rotateY(float y_angle, int matrix = MATRIX_MODELVIEW);
+		int saveImage(const char* path, ImageFormat format = IMAGE_PNG,
+						PngFilter filter = PNG_FILTER_ADAPTIVE);
 
-		/** Renderer program invocation
-		 *
-		 * Performs a rotation transformation, around the Z axis, on the selected matrix
-		 * used by the renderer. The transformation is ignored if the given matrix
-		 * identification number is invalid.
-		 * \param z_angle the angle of the counterclockwise rotation, in radians
-		 * \param matrix the identification matrix
-		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
-		 */
-		void rotateZ(float z_angle, int matrix = MATRIX_MODELVIEW);
+		static constexpr unsigned int DEFAULT_FRONT_COLOR = 0xFFFFFFFF;
+		static constexpr unsigned int DEFAULT_CLEAR_COLOR = 0xFF000000;
+		static constexpr size_t DEFAULT_BATCH_SIZE = 256;
 
-		/** Renderer program invocation
-		 *
-		 * Performs a scale transformation on the selected matrix
-		 * used by the renderer. The transformation is ignored if the given matrix
-		 * identification number is invalid.
-		 * \param v the transformation vector
-		 * \param matrix the identification matrix
-		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
-		 */
-		void scale(const math::Vector4f& v_scale, int matrix = MATRIX_MODELVIEW);
+	protected:
+	private:
 
-		/** Renderer program invocation
-		 *
-		 * Sets the front color for the succeding drawing operations.
-		 * \param color the desired front color in ARGB format
+		/** Pass a renderer operation instance to the renderer, staging it until the
+		 * next batch is handed over. The renderer takes ownership of the operation.
+		 * \param op the operation to pass to the renderer
+		 * \return 0 if the operation was queued, 1 if it was rejected
 		 */
-		void front_color(unsigned int color);
+		int enqueue(op::RendererOperation* op);
 
-		/** Renderer program invocation
-		 *
-		 * Sets the clear color for the succeding drawing operations.
-		 * \param color the desired clear color in ARGB format
+		/** Moves the operations of the command buffers to the staging buffer,
+		 * in the given order, and hands them over.
+		 * \return 0 on success, 1 if the operations were rejected
 		 */
-		void clear_color(unsigned int color);
+		int submitBuffers(CommandBuffer* const* buffers, size_t count);
 
-		/** Renderer program invocation
-		 *
-		 * Passes the viewport region being used to the renderer
-		 * \param viewport the viewport region
+		/** Moves the staged operations to the operation queue, following the queue
+		 * policy if the queue becomes full, and wakes up the rendering thread. With
+		 * \c QUEUE_FAIL , the staged operations are rejected together if they do not
+		 * all fit. Must be called with the staging buffer locked.
+		 * \return 0 on success, 1 if any operation was rejected
 		 */
-		void setViewPort(const math::Region2i& viewport);
-
-		static constexpr unsigned int DEFAULT_FRONT_COLOR = 0xFFFFFFFF;
-		static constexpr unsigned int DEFAULT_CLEAR_COLOR = 0xFF000000;
-		static constexpr int MATRIX_MODELVIEW = 0;
-		static constexpr int MATRIX_PROJECTION = 1;
+		int publish(void);
 
-	protected:
-	private:
-
-		/** Pass a renderer operation instance to the renderer
-		 * \param op the operation to pass to the renderer
-		 * \return a reference to this
+		/** Removes the drawing operations of the oldest complete frame in queue
+		 * which neither switches render targets nor saves an image.
+		 * Must be called with the queue locked.
+		 * \return whether any operation was removed
 		 */
-		Renderer& operator>>(op::RendererOperation* op);
+		bool dropOldestFrame(void);
 
 		/** Renderer thread main function */
 		static void run(Renderer* renderer);
@@ -0,0 +1,222 @@
+/** \file RendererInvoker.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+
+#include "RendererInvoker.h"
+
+#include <atomic>
+
+using namespace derplot;
+using namespace op;
+using namespace math;
+
+RendererInvoker::~RendererInvoker()
+{}
+
+int RendererInvoker::clear(void)
+{	return this->enqueue(new Clear()); }
+
+int RendererInvoker::clearRegion(const math::Region2i& region)
+{	return this->enqueue(new ClearRegion(region)); }
+
+int RendererInvoker::clearDrawn(void)
+{	return this->enqueue(new ClearDrawn()); }
+
+int RendererInvoker::drawRawPoint(std::pair<int,int> p)
+{	return this->enqueue(new RawPoint(p, 0)); }
+
+int RendererInvoker::drawRawBigPoint(std::pair<int,int> p)
+{	return this->enqueue(new RawPoint(p, 1)); }
+
+int RendererInvoker::drawRawLine(std::pair<int,int> point1, std::pair<int,int> point2)
+{	return this->enqueue(new RawLine(point1, point2)); }
+
+int RendererInvoker::drawPoint(const Vector4f& p)
+{	return this->enqueue(new Point(p, 0)); }
+
+int RendererInvoker::drawBigPoint(const Vector4f& p)
+{	return this->enqueue(new Point(p, 1)); }
+
+int RendererInvoker::drawLine(const math::Vector4f& point1, const math::Vector4f& point2)
+{	return this->enqueue(new Line(point1, point2)); }
+
+int RendererInvoker::drawArrays(RendererDrawMode mode, const float* xyz, unsigned int count,
+								const math::Bounds& bounds)
+{	return this->enqueue(new DrawArrays(mode, xyz, nullptr, count, bounds)); }
+
+int RendererInvoker::drawArrays(RendererDrawMode mode, const float* xyz,
+								const unsigned int* colors, unsigned int count,
+								const math::Bounds& bounds)
+{	return this->enqueue(new DrawArrays(mode, xyz, colors, count, bounds)); }
+
+int RendererInvoker::drawElements(RendererDrawMode mode, const float* xyz,
+								unsigned int vertex_count, const unsigned int* indices,
+								unsigned int count, const math::Bounds& bounds)
+{	return this->enqueue(new DrawElements(mode, xyz, nullptr, vertex_count, indices, count, bounds)); }
+
+int RendererInvoker::drawElements(RendererDrawMode mode, const float* xyz,
+								const unsigned int* colors, unsigned int vertex_count,
+								const unsigned int* indices, unsigned int count,
+								const math::Bounds& bounds)
+{	return this->enqueue(new DrawElements(mode, xyz, colors, vertex_count, indices, count, bounds)); }
+
+unsigned int RendererInvoker::createBuffer(void)
+{
+	static std::atomic<unsigned int> last_buffer(0);
+	return ++last_buffer;
+}
+
+int RendererInvoker::uploadVertices(unsigned int buffer, const float* xyz, unsigned int count)
+{	return this->enqueue(new UploadVertices(buffer, xyz, nullptr, count)); }
+
+int RendererInvoker::uploadVertices(unsigned int buffer, const float* xyz,
+								const unsigned int* colors, unsigned int count)
+{	return this->enqueue(new UploadVertices(buffer, xyz, colors, count)); }
+
+int RendererInvoker::drawBuffer(unsigned int buffer, RendererDrawMode mode,
+								unsigned int first, unsigned int count)
+{	return this->enqueue(new DrawBuffer(buffer, mode, first, count)); }
+
+int RendererInvoker::drawBufferElements(unsigned int buffer, RendererDrawMode mode,
+								const unsigned int* indices, unsigned int count)
+{	return this->enqueue(new DrawBufferElements(buffer, mode, indices, count)); }
+
+int RendererInvoker::deleteBuffer(unsigned int buffer)
+{	return this->enqueue(new DeleteBuffer(buffer)); }
+
+unsigned int RendererInvoker::createTarget(int width, int height)
+{
+	static std::atomic<unsigned int> last_target(0);
+	const unsigned int target = ++last_target;
+	return (this->enqueue(new CreateTarget(target, width, height)) == 0) ? target : 0;
+}
+
+int RendererInvoker::setRenderTarget(unsigned int target)
+{	return this->enqueue(new SetRenderTarget(target)); }
+
+int RendererInvoker::deleteTarget(unsigned int target)
+{	return this->enqueue(new DeleteTarget(target)); }
+
+int RendererInvoker::setSupersampling(int factor)
+{	return this->enqueue(new SetSupersampling(factor)); }
+
+int RendererInvoker::resolve(void)
+{	return this->enqueue(new Resolve()); }
+
+unsigned int RendererInvoker::createFont(const unsigned char* atlas, int width, int height,
+						int cell_width, int cell_height, unsigned char first)
+{
+	static std::atomic<unsigned int> last_font(0);
+	Font font(atlas, width, height, cell_width, cell_height, first);
+	if (!font) return 0;
+	const unsigned int id = ++last_font;
+	return (this->enqueue(new CreateFont(id, std::move(font))) == 0) ? id : 0;
+}
+
+int RendererInvoker::deleteFont(unsigned int font)
+{	return this->enqueue(new DeleteFont(font)); }
+
+int RendererInvoker::drawText(const math::Vector4f& position, const char* text, unsigned int font)
+{
+	const TextLabel label = { position, text, 0, 0 };
+	return this->enqueue(new DrawText(font, &label, 1, nullptr));
+}
+
+int RendererInvoker::drawText(const TextLabel* labels, unsigned int count,
+							const unsigned int* colors, unsigned int font)
+{	return this->enqueue(new DrawText(font, labels, count, colors)); }
+
+int RendererInvoker::drawGrid(float x_min, float x_max, float y_min, float y_max,
+							float x_step, float y_step)
+{	return this->enqueue(new DrawGrid(x_min, x_max, y_min, y_max, x_step, y_step)); }
+
+int RendererInvoker::drawAxis(int axis, float from, float to, float at, float step,
+							int tick_length)
+{	return this->enqueue(new DrawAxis(axis, from, to, at, step, tick_length)); }
+
+int RendererInvoker::blit(unsigned int source, const math::Region2i& src_region,
+				const math::Region2i& dst_region, BlitFilter filter)
+{	return this->enqueue(new Blit(source, src_region, dst_region, filter)); }
+
+int RendererInvoker::orthoProjection(float left, float right, float bottom, float top,
+					float near, float far)
+{ return this->enqueue(new Ortho(left, right, top, bottom, near, far)); }
+
+int RendererInvoker::perspectiveProjection(float fovy, float near,
+					float far, float aspect_ratio)
+{ return this->enqueue(new Perspective(fovy, near, far, aspect_ratio)); }
+
+int RendererInvoker::setProjectionMatrix(const math::Mat4x4f& mat)
+{ return this->enqueue(new MatrixSet(mat, 1)); }
+
+int RendererInvoker::setModelViewMatrix(const math::Mat4x4f& mat)
+{ return this->enqueue(new MatrixSet(mat, 0)); }
+
+int RendererInvoker::multiplyMatrix(const math::Mat4x4f& mat, int matrix)
+{ return this->enqueue(new MatrixMultiply(mat, matrix)); }
+
+int RendererInvoker::translate(const math::Vector4f& v, int matrix)
+{ return this->enqueue(new MatrixTranslate(v, matrix)); }
+
+int RendererInvoker::rotateX(float x_angle, int matrix)
+{ return this->enqueue(new MatrixRotate(x_angle, 0, matrix)); }
+
+int RendererInvoker::rotateY(float y_angle, int matrix)
+{ return this->enqueue(new MatrixRotate(y_angle, 1, matrix)); }
+
+int RendererInvoker::rotateZ(float z_angle, int matrix)
+{ return this->enqueue(new MatrixRotate(z_angle, 2, matrix)); }
+
+int RendererInvoker::scale(const math::Vector4f& v, int matrix)
+{ return this->enqueue(new MatrixScale(v, matrix)); }
+
+int RendererInvoker::setRotation(const math::Vector4f& quaternion, int matrix)
+{ return this->enqueue(new MatrixQuaternion(quaternion, matrix)); }
+
+int RendererInvoker::setRotation(float pitch, float yaw, float roll, int matrix)
+{ return this->enqueue(new MatrixEuler(pitch, yaw, roll, matrix)); }
+
+int RendererInvoker::setTransform(const math::Vector4f& translation,
+		const math::Vector4f& rotation, const math::Vector4f& scale, int matrix)
+{ return this->enqueue(new MatrixTRS(translation, rotation, scale, matrix)); }
+
+int RendererInvoker::pushMatrix(int matrix)
+{ return this->enqueue(new PushMatrix(matrix)); }
+
+int RendererInvoker::popMatrix(int matrix)
+{ return this->enqueue(new PopMatrix(matrix)); }
+
+int RendererInvoker::front_color(unsigned int color)
+{ return this->enqueue(new FrontColor(color)); }
+
+int RendererInvoker::clear_color(unsigned int color)
+{ return this->enqueue(new ClearColor(color)); }
+
+int RendererInvoker::setViewPort(const math::Region2i& viewport)
+{ return this->enqueue(new ViewPort(viewport)); }
+
+int RendererInvoker::setScissor(const math::Region2i& region)
+{ return this->enqueue(new Scissor(region)); }
+
+int RendererInvoker::disableScissor(void)
+{ return this->enqueue(new Scissor()); }
+
+int RendererInvoker::setViewportSlot(unsigned int index, const math::Region2i& viewport,
+						const math::Mat4x4f& projection, const math::Mat4x4f& modelview)
+{ return this->enqueue(new SetViewportSlot(index, viewport, projection, modelview)); }
+
+int RendererInvoker::drawViewports(const ViewportDraw* draws, unsigned int count)
+{ return this->enqueue(new DrawViewports(draws, count)); }
+
+int RendererInvoker::setBlendMode(BlendMode mode)
+{ return this->enqueue(new SetBlendMode(mode)); }
+
+int RendererInvoker::setPalette(const unsigned int* colors, int count)
+{ return this->enqueue(new SetPalette(colors, count)); }
+
+int RendererInvoker::saveImage(const char* path, ImageFormat format, PngFilter filter)
+{
+	if (path == nullptr) return 1;
+	return this->enqueue(new SaveImage(path, format, filter));
+}
@@ -0,0 +1,660 @@
+/** \file RendererInvoker.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \class derplot::RendererInvoker
+ * \brief Base class of the objects on which renderer operations are invoked.
+ *
+ * Each invocation function creates the data block describing the operation and passes
+ * it to \c enqueue() , which is implemented by the derived classes: the \c Renderer
+ * passes it to its rendering thread, while a \c CommandBuffer records it for
+ * submitting later.
+ *
+ * All invocation functions return 0 when the operation is accepted, or 1 when
+ * it is rejected.
+ */
+#pragma once
+
+#include "Mat4x4f.h"
+#include "Vector4f.h"
+#include "Region2i.h"
+#include "Bounds.h"
+#include "RendererOps.h"
+#include <utility>
+
+namespace derplot
+{
+
+class RendererInvoker
+{
+	public:
+		/** Default destructor */
+		virtual ~RendererInvoker();
+
+		/** Renderer program invocation
+		 *
+		 * Clears the whole display buffer using the current clear color
+		 */
+		int clear(void);
+
+		/** Renderer program invocation
+		 *
+		 * Clears a region of the display buffer using the current clear color
+		 * \param region the region to clear, in pixel coordinates
+		 */
+		int clearRegion(const math::Region2i& region);
+
+		/** Renderer program invocation
+		 *
+		 * Clears, using the current clear color, only the regions of the display buffer
+		 * drawn since the last \c clear() or \c clearDrawn() . When few things change
+		 * between frames, calling this function at the start of each frame instead of
+		 * \c clear() avoids touching the rest of the buffer.
+		 */
+		int clearDrawn(void);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a point at the specified pixel coordinates, with the current
+		 * front color. No transformations are applied. The pixel coordinates
+		 * are relative to the top-left corner.
+		 * \param point
+		 */
+		int drawRawPoint(std::pair<int,int> point);
+
+		/** Renderer program invocation
+		 *
+		 * Like in \c drawRawPoint() , this function draws a slightly bigger point
+		 * at the specified pixel coordinates, with the current front color. Adjacent up,
+		 * down, left and right pixels are also plotted.
+		 * \param point
+		 */
+		int drawRawBigPoint(std::pair<int,int> point);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a line from \b point1 to \b point2 , with no transformations, using the
+		 * current front color. Point order is irrelevant.
+		 * \param point1
+		 * \param point2
+		 */
+		int drawRawLine(std::pair<int,int> point1, std::pair<int,int> point2);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a 3D point. Modelview, projection and normalization transformations are
+		 * applied before drawing the result using the current front color.
+		 * \param point
+		 */
+		int drawPoint(const math::Vector4f& point);
+
+		/** Renderer program invocation
+		 *
+		 * Behaves like \c drawPoint() , but draws a slightly bigger point.
+		 * \param point
+		 */
+		int drawBigPoint(const math::Vector4f& point);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a line from two 3D points, using the current front color.
+		 * Modelview, projection and normalization transformations are applied before
+		 * drawing. Point order is irrelevant.
+		 * \param point1
+		 * \param point2
+		 */
+		int drawLine(const math::Vector4f& point1, const math::Vector4f& point2);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a batch of 3D vertices as points, lines or triangles, using the current
+		 * front color. The vertices are copied, so the array can be reused right away.
+		 * \c POINTS and \c BIG_POINTS draw each vertex as with \c drawPoint() and
+		 * \c drawBigPoint() ; \c LINES draws a line for each pair of vertices;
+		 * \c LINE_STRIP connects each vertex to the next one; \c LINE_LOOP also
+		 * connects the last vertex to the first one; \c TRIANGLES fills a triangle
+		 * for each three vertices.
+		 *
+		 * When the bounding volume of the vertices is given, the whole batch is skipped
+		 * without transforming any vertex if it lies outside the view frustum.
+		 * \param mode the kind of primitives to draw
+		 * \param xyz the X, Y and Z coordinates of each vertex, contiguously
+		 * \param count the number of vertices
+		 * \param bounds the bounding volume of all vertices, in object coordinates
+		 * (see \c math::Bounds::box() and \c math::Bounds::sphere() )
+		 */
+		int drawArrays(RendererDrawMode mode, const float* xyz, unsigned int count,
+						const math::Bounds& bounds = math::Bounds());
+
+		/** Renderer program invocation
+		 *
+		 * Draws a batch of 3D vertices as in \c drawArrays() , each with its own color
+		 * instead of the front color. Points take the color of their vertex, while
+		 * the colors of lines and triangles are interpolated from their vertices
+		 * (Gouraud shading), so multicolored geometry needs no color changes.
+		 * \param mode the kind of primitives to draw
+		 * \param xyz the X, Y and Z coordinates of each vertex, contiguously
+		 * \param colors the ARGB color of each vertex
+		 * \param count the number of vertices
+		 * \param bounds the bounding volume of all vertices, in object coordinates
+		 */
+		int drawArrays(RendererDrawMode mode, const float* xyz, const unsigned int* colors,
+						unsigned int count, const math::Bounds& bounds = math::Bounds());
+
+		/** Renderer program invocation
+		 *
+		 * Draws a batch of indexed 3D vertices, as in \c drawArrays() , where each
+		 * primitive takes its vertices from the array by index. Vertices shared by
+		 * several primitives are transformed only once. Nothing is drawn if an index
+		 * is out of range.
+		 * \param mode the kind of primitives to draw
+		 * \param xyz the X, Y and Z coordinates of each vertex, contiguously
+		 * \param vertex_count the number of vertices
+		 * \param indices the index of each vertex to draw, in primitive order
+		 * \param count the number of indices
+		 * \param bounds the bounding volume of all vertices, in object coordinates
+		 */
+		int drawElements(RendererDrawMode mode, const float* xyz, unsigned int vertex_count,
+						const unsigned int* indices, unsigned int count,
+						const math::Bounds& bounds = math::Bounds());
+
+		/** Renderer program invocation
+		 *
+		 * Draws a batch of indexed 3D vertices as in \c drawElements() , each with its
+		 * own color, as in the colored version of \c drawArrays() .
+		 * \param mode the kind of primitives to draw
+		 * \param xyz the X, Y and Z coordinates of each vertex, contiguously
+		 * \param colors the ARGB color of each vertex
+		 * \param vertex_count the number of vertices
+		 * \param indices the index of each vertex to draw, in primitive order
+		 * \param count the number of indices
+		 * \param bounds the bounding volume of all vertices, in object coordinates
+		 */
+		int drawElements(RendererDrawMode mode, const float* xyz, const unsigned int* colors,
+						unsigned int vertex_count, const unsigned int* indices,
+						unsigned int count, const math::Bounds& bounds = math::Bounds());
+
+		/** Creates a handle for a new vertex buffer. Vertex buffers keep vertices
+		 * in the renderer, so that static geometry is sent only once and then drawn
+		 * by handle with \c drawBuffer() . The handle is assigned right away, without
+		 * waiting for the renderer, and is unique across all renderers.
+		 * \return the handle of the buffer, which is never 0
+		 */
+		unsigned int createBuffer(void);
+
+		/** Renderer program invocation
+		 *
+		 * Replaces the vertices of a vertex buffer. The buffer is allocated on the
+		 * first upload. The vertices are copied, so the array can be reused right away.
+		 * \param buffer the handle of the buffer, given by \c createBuffer()
+		 * \param xyz the X, Y and Z coordinates of each vertex, contiguously
+		 * \param count the number of vertices
+		 */
+		int uploadVertices(unsigned int buffer, const float* xyz, unsigned int count);
+
+		/** Renderer program invocation
+		 *
+		 * Replaces the vertices of a vertex buffer, along with a color for each vertex
+		 * that is used instead of the front color when drawing the buffer.
+		 * \param buffer the handle of the buffer, given by \c createBuffer()
+		 * \param xyz the X, Y and Z coordinates of each vertex, contiguously
+		 * \param colors the ARGB color of each vertex
+		 * \param count the number of vertices
+		 */
+		int uploadVertices(unsigned int buffer, const float* xyz, const unsigned int* colors,
+						unsigned int count);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a range of the vertices of a vertex buffer, as in \c drawArrays() ,
+		 * using the colors uploaded with the vertices, or else the current front color. The bounding box of the whole buffer is used
+		 * for culling. Nothing is drawn if the buffer was not uploaded or the range
+		 * does not fit in it.
+		 * \param buffer the handle of the buffer
+		 * \param mode the kind of primitives to draw
+		 * \param first the index of the first vertex to draw
+		 * \param count the number of vertices to draw
+		 */
+		int drawBuffer(unsigned int buffer, RendererDrawMode mode,
+						unsigned int first, unsigned int count);
+
+		/** Renderer program invocation
+		 *
+		 * Draws indexed vertices of a vertex buffer, as in \c drawElements() . The
+		 * indices are copied, so the array can be reused right away.
+		 * \param buffer the handle of the buffer
+		 * \param mode the kind of primitives to draw
+		 * \param indices the index of each vertex to draw, in primitive order
+		 * \param count the number of indices
+		 */
+		int drawBufferElements(unsigned int buffer, RendererDrawMode mode,
+						const unsigned int* indices, unsigned int count);
+
+		/** Renderer program invocation
+		 *
+		 * Releases the vertices of a vertex buffer. The handle should not be used again.
+		 * \param buffer the handle of the buffer
+		 */
+		int deleteBuffer(unsigned int buffer);
+
+		/** Renderer program invocation
+		 *
+		 * Creates an offscreen render target, in the pixel format of the display
+		 * buffer, for composing plots inside the rendering thread with \c blit() .
+		 * The handle is assigned right away, as with \c createBuffer() .
+		 * \param width the width of the target
+		 * \param height the height of the target
+		 * \return the handle of the target, or 0 if the operation was not enqueued
+		 */
+		unsigned int createTarget(int width, int height);
+
+		/** Renderer program invocation
+		 *
+		 * Makes the succeeding operations draw to (and clear) a render target. Each
+		 * target keeps its own viewport and scissor region, which start as the whole
+		 * target. Only the changes to the display buffer become dirty regions.
+		 * \param target the handle of the target, or 0 for the display buffer
+		 */
+		int setRenderTarget(unsigned int target);
+
+		/** Renderer program invocation
+		 *
+		 * Releases a render target. The handle should not be used again.
+		 * \param target the handle of the target
+		 */
+		int deleteTarget(unsigned int target);
+
+		/** Renderer program invocation
+		 *
+		 * Copies a region of a render target to a region of the current target,
+		 * scaling it to fit. The pixels are composed with the current blend mode
+		 * (such as \c BLEND_ALPHA for alpha blending), and clipped to the scissor region.
+		 * \param source the handle of the source target, or 0 for the display buffer;
+		 * it must not be the current target
+		 * \param src_region the region to copy, within the source
+		 * \param dst_region the region to cover in the current target
+		 * \param filter how the source is sampled when scaled
+		 */
+		int blit(unsigned int source, const math::Region2i& src_region,
+				const math::Region2i& dst_region, BlitFilter filter = BLIT_NEAREST);
+
+		/** Renderer program invocation
+		 *
+		 * Anti-aliases all primitives by drawing the display with \b factor x
+		 * \b factor samples per pixel, which are averaged into the display buffer
+		 * on \c resolve() (and on each <tt>Renderer::flush()</tt>). While
+		 * supersampling, pixel coordinates (such as those of the viewport, the scissor
+		 * region, raw primitives and cleared regions) are in samples, so raw lines and
+		 * points are one sample wide.
+		 * \param factor the number of samples along each axis: 1 (no supersampling),
+		 * 2 or 4
+		 */
+		int setSupersampling(int factor);
+
+		/** Renderer program invocation
+		 *
+		 * Averages the samples changed since the last resolve into the display
+		 * buffer, when supersampling.
+		 */
+		int resolve(void);
+
+		/** Renderer program invocation
+		 *
+		 * Defines a bitmap font for \c drawText() , from an atlas of pre-rasterized
+		 * glyphs (see \c Font ). The glyphs are prepared right away, in the calling
+		 * thread, and the handle is assigned as with \c createBuffer() .
+		 * \param atlas the coverage of each pixel of the atlas (0 to 255), row by row
+		 * \param width the width of the atlas
+		 * \param height the height of the atlas
+		 * \param cell_width the width of each glyph
+		 * \param cell_height the height of each glyph
+		 * \param first the character code of the first glyph
+		 * \return the handle of the font, or 0 if the atlas is not valid or the
+		 * operation was not enqueued
+		 */
+		unsigned int createFont(const unsigned char* atlas, int width, int height,
+						int cell_width, int cell_height, unsigned char first = ' ');
+
+		/** Renderer program invocation
+		 *
+		 * Releases a font. The handle should not be used again.
+		 * \param font the handle of the font
+		 */
+		int deleteFont(unsigned int font);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a text with the front color, with its top-left corner at the pixel
+		 * a point is transformed to. Glyph edges are blended over the buffer.
+		 * \param position the point
+		 * \param text the null-terminated text, with lines separated by '\\n'
+		 * \param font the handle of the font, or 0 for the built-in font
+		 */
+		int drawText(const math::Vector4f& position, const char* text, unsigned int font = 0);
+
+		/** Renderer program invocation
+		 *
+		 * Draws many texts at once, such as all labels of a plot, each placed at
+		 * a point. The texts are copied.
+		 * \param labels the texts and their points
+		 * \param count the number of texts
+		 * \param colors the color of each text, or \c nullptr for the front color
+		 * \param font the handle of the font, or 0 for the built-in font
+		 */
+		int drawText(const TextLabel* labels, unsigned int count,
+					const unsigned int* colors = nullptr, unsigned int font = 0);
+
+		/** Renderer program invocation
+		 *
+		 * Draws the lines of a plot grid in the XY plane with the front color, at each
+		 * multiple of the spacing along each axis. Lines that are horizontal or
+		 * vertical in the buffer are written as plain rows or columns of pixels.
+		 * \param x_min the left edge of the grid
+		 * \param x_max the right edge of the grid
+		 * \param y_min the bottom edge of the grid
+		 * \param y_max the top edge of the grid
+		 * \param x_step the spacing of the vertical lines, or 0 for none
+		 * \param y_step the spacing of the horizontal lines, or 0 for none
+		 */
+		int drawGrid(float x_min, float x_max, float y_min, float y_max,
+					float x_step, float y_step);
+
+		/** Renderer program invocation
+		 *
+		 * Draws a plot axis in the XY plane with the front color, with ticks of a fixed
+		 * length in pixels at each multiple of the spacing. The ticks extend below a
+		 * horizontal axis and to the left of a vertical one. A spacing can be chosen
+		 * with \c math::tickStep() .
+		 * \param axis 0 for an axis along X, 1 for an axis along Y
+		 * \param from the first coordinate along the axis
+		 * \param to the last coordinate along the axis
+		 * \param at the coordinate of the axis along the other axis
+		 * \param step the spacing of the ticks, or 0 for none
+		 * \param tick_length the length of the ticks in pixels, negative for ticks
+		 * above or to the right of the axis
+		 */
+		int drawAxis(int axis, float from, float to, float at, float step, int tick_length);
+
+		/** Renderer program invocation
+		 *
+		 * Passes the projection matrix being used to the renderer
+		 * \param mat the projection matrix
+		 */
+		int setProjectionMatrix(const math::Mat4x4f& mat);
+
+
+		/** Renderer program invocation
+		 *
+		 * Applies an orthographic projection transformation in the projection matrix
+		 * according to the given parameters. The matrix is not modified if either one
+		 * of the parameters is invalid.
+		 * \param left the X minimum plane
+		 * \param right the X maximum plane
+		 * \param bottom the Y minimum plane
+		 * \param top the Y maximum plane
+		 * \param near the z near plane
+		 * \param far the z far plane
+		 * \param aspect_ratio the screen aspect ration
+		 */
+		int orthoProjection(float left, float right, float bottom, float top,
+							float near, float far);
+
+		/** Renderer program invocation
+		 *
+		 * Applies a perspective projection transformation in the projection matrix
+		 * according to the given parameters. The matrix is not modified if either one
+		 * of the parameters is invalid.
+		 * \param fovy the Y Field of View angle in degrees
+		 * \param near the z near plane
+		 * \param far the z far plane
+		 * \param aspect_ratio the screen aspect ration
+		 */
+		int perspectiveProjection(float fovy, float near, float far, float aspect_ratio);
+
+		/** Renderer program invocation
+		 *
+		 * Passes the modelview matrix being used to the renderer
+		 * \param mat the modelview matrix
+		 */
+		int setModelViewMatrix(const math::Mat4x4f& mat);
+
+		/** Renderer program invocation
+		 *
+		 * Multiplies the selected matrix by the given matrix (<tt>m = m * mat</tt>),
+		 * as the other transformations do.
+		 * \param mat the transformation matrix
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int multiplyMatrix(const math::Mat4x4f& mat, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Performs a translation transformation on the selected matrix
+		 * used by the renderer. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param v the transformation vector
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int translate(const math::Vector4f& v, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Performs a rotation transformation, around the X axis, on the selected matrix
+		 * used by the renderer. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param x_angle the angle of the counterclockwise rotation, in radians
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int rotateX(float x_angle, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Performs a rotation transformation, around the Y axis, on the selected matrix
+		 * used by the renderer. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param y_angle the angle of the counterclockwise rotation, in radians
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int rotateY(float y_angle, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Performs a rotation transformation, around the Z axis, on the selected matrix
+		 * used by the renderer. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param z_angle the angle of the counterclockwise rotation, in radians
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int rotateZ(float z_angle, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Performs a scale transformation on the selected matrix
+		 * used by the renderer. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param v the transformation vector
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int scale(const math::Vector4f& v_scale, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Replaces the selected matrix with the rotation described by a quaternion.
+		 * The transformation is ignored if the given matrix identification number
+		 * is invalid.
+		 * \param quaternion the rotation quaternion, in the form (x, y, z, w) where
+		 * \b w is the real part
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int setRotation(const math::Vector4f& quaternion, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Replaces the selected matrix with a sequence of rotations around the X, Y
+		 * and Z axes, in this order. It is equivalent to loading an identity matrix
+		 * and calling \c rotateX() , \c rotateY() and \c rotateZ() , but the matrix
+		 * is built at once. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param pitch the angle of the rotation around the X axis, in radians
+		 * \param yaw the angle of the rotation around the Y axis, in radians
+		 * \param roll the angle of the rotation around the Z axis, in radians
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int setRotation(float pitch, float yaw, float roll, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Replaces the selected matrix with a translation, a rotation and a scale
+		 * transformation, applied in this order. It is equivalent to loading an identity
+		 * matrix and calling \c translate() , \c setRotation() and \c scale() , but
+		 * the matrix is built at once. The transformation is ignored if the given matrix
+		 * identification number is invalid.
+		 * \param translation the translation vector
+		 * \param rotation the rotation quaternion, in the form (x, y, z, w) where
+		 * \b w is the real part (see \c math::euler2quaternion() )
+		 * \param scale the scale factors
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int setTransform(const math::Vector4f& translation, const math::Vector4f& rotation,
+						const math::Vector4f& scale, int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Saves a copy of the selected matrix on top of its stack, so that it can be
+		 * restored later with \c popMatrix() . Each matrix has its own stack, which
+		 * holds up to \c math::MatrixStack::CAPACITY matrices. Pushing onto a full
+		 * stack is ignored.
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int pushMatrix(int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Restores the selected matrix to the one on top of its stack, removing it
+		 * from the stack. Popping from an empty stack is ignored.
+		 * \param matrix the identification matrix
+		 * ( \c MATRIX_MODELVIEW or \c MATRIX_PROJECTION )
+		 */
+		int popMatrix(int matrix = MATRIX_MODELVIEW);
+
+		/** Renderer program invocation
+		 *
+		 * Sets the front color for the succeding drawing operations.
+		 * \param color the desired front color in ARGB format
+		 */
+		int front_color(unsigned int color);
+
+		/** Renderer program invocation
+		 *
+		 * Sets the clear color for the succeding drawing operations.
+		 * \param color the desired clear color in ARGB format
+		 */
+		int clear_color(unsigned int color);
+
+		/** Renderer program invocation
+		 *
+		 * Passes the viewport region being used to the renderer
+		 * \param viewport the viewport region
+		 */
+		int setViewPort(const math::Region2i& viewport);
+
+		/** Renderer program invocation
+		 *
+		 * Restricts the succeeding primitives to a region of the buffer, such as the
+		 * viewport, so that lines leaving it write no pixels elsewhere. Primitives are
+		 * clipped to the region, rather than tested pixel by pixel. Clears are not
+		 * affected.
+		 * \param region the scissor region
+		 */
+		int setScissor(const math::Region2i& region);
+
+		/** Renderer program invocation
+		 *
+		 * Lets the succeeding primitives cover the whole buffer again.
+		 */
+		int disableScissor(void);
+
+		/** Renderer program invocation
+		 *
+		 * Defines a viewport of the viewport array, with its own projection and
+		 * modelview matrices, for drawing many plots (such as a grid of small plots)
+		 * into the same buffer with a single \c drawViewports() .
+		 * \param index the index of the viewport, below
+		 * \c RendererProgram::MAX_VIEWPORT_SLOTS
+		 * \param viewport the viewport region, to which its draws are also clipped
+		 * \param projection the projection matrix of the viewport
+		 * \param modelview the modelview matrix of the viewport
+		 */
+		int setViewportSlot(unsigned int index, const math::Region2i& viewport,
+						const math::Mat4x4f& projection, const math::Mat4x4f& modelview);
+
+		/** Renderer program invocation
+		 *
+		 * Draws ranges of vertex buffers into viewports of the viewport array, each
+		 * with the matrices of its viewport rather than the current ones. Viewports
+		 * whose regions do not overlap are drawn concurrently by the rendering thread
+		 * and a pool of helper threads, if there are enough vertices to share among them.
+		 * The draws are copied, so the array can be reused right away.
+		 * \param draws the draws, each naming its viewport, buffer, mode and range
+		 * \param count the number of draws
+		 */
+		int drawViewports(const ViewportDraw* draws, unsigned int count);
+
+		/** Renderer program invocation
+		 *
+		 * Defines how the front color is combined with the pixels it is drawn over
+		 * by the succeeding drawing operations. The default mode is \c BLEND_REPLACE .
+		 * Clearing operations always replace the pixels.
+		 * \param mode the blend mode
+		 */
+		int setBlendMode(BlendMode mode);
+
+		/** Renderer program invocation
+		 *
+		 * Defines the palette of a buffer in the \c PIXEL_INDEXED8 format. When drawing
+		 * on such a buffer, the lowest byte of each color is the palette index. The
+		 * palette is used for converting the pixels back to colors (such as when
+		 * saving an image).
+		 * \param colors the ARGB colors of the palette
+		 * \param count the number of colors (up to 256)
+		 */
+		int setPalette(const unsigned int* colors, int count);
+
+		/** Renderer program invocation
+		 *
+		 * Saves the contents of the display buffer to an image file, once all
+		 * previously invoked operations are performed. The image is encoded directly
+		 * from the display buffer in the renderer thread. PNG images are compressed
+		 * in parallel. Failures to write the file are counted by
+		 * <tt>Renderer::failedSaves()</tt> .
+		 * \param path the path of the output file, not \c nullptr
+		 * \param format the file format ( \c IMAGE_QOI or \c IMAGE_PNG )
+		 * \param filter the PNG scanline filter, ignored for QOI images
+		 * \return 0 if the operation was enqueued, 1 if the path is null or the
+		 * operation was rejected
+		 */
+		virtual int saveImage(const char* path, ImageFormat format = IMAGE_PNG,
+						PngFilter filter = PNG_FILTER_ADAPTIVE);
+
+		static constexpr int MATRIX_MODELVIEW = 0;
+		static constexpr int MATRIX_PROJECTION = 1;
+
+	protected:
+		/** Pass a renderer operation instance to this object, which takes
+		 * ownership of the operation.
+		 * \param op the operation to pass
+		 * \return 0 if the operation was accepted, 1 if it was rejected
+		 */
+		virtual int enqueue(op::RendererOperation* op) = 0;
+};
+
+};
@@ -6,6 +6,7 @@
 
 #include "MathUtils.h"
 #include <math.h>
+#include <string.h>
 
 using namespace derplot;
 using namespace math;
@@ -21,6 +22,26 @@ int ViewPort::onDispatch( RendererProgram& prg)
 	return 0;
 }
 
+bool ViewPort::sameState(const RendererOperation& other) const
+{
+	const math::Region2i& v = static_cast<const ViewPort&>(other).viewport;
+	return v.getMinX() == viewport.getMinX() && v.getMaxX() == viewport.getMaxX()
+		&& v.getMinY() == viewport.getMinY() && v.getMaxY() == viewport.getMaxY();
+}
+
+int Scissor::onDispatch( RendererProgram& prg)
+{
+	return this->enabled ? prg.setScissor(this->region) : prg.disableScissor();
+}
+
+bool Scissor::sameState(const RendererOperation& other) const
+{
+	const Scissor& s = static_cast<const Scissor&>(other);
+	if (!s.enabled || !this->enabled) return s.enabled == this->enabled;
+	return s.region.getMinX() == region.getMinX() && s.region.getMaxX() == region.getMaxX()
+		&& s.region.getMinY() == region.getMinY() && s.region.getMaxY() == region.getMaxY();
+}
+
 int Ortho::onDispatch( RendererProgram& prg)
 {
 	if ( this->near >= this->far ||
@@ -61,6 +82,182 @@ int Perspective::onDispatch( RendererProgram& prg)
 	return 0;
 }
 
+namespace
+{
+	void copyVertices(std::vector<math::Vector4f>& out, const float* xyz, unsigned int count)
+	{
+		out.reserve(count);
+		for (unsigned int i = 0 ; i < count ; i++)
+			out.emplace_back(xyz[i*3], xyz[i*3 + 1], xyz[i*3 + 2]);
+	}
+
+	// vertex colors are optional
+	void copyColors(std::vector<unsigned int>& out, const unsigned int* colors, unsigned int count)
+	{
+		if (colors) out.assign(colors, colors + count);
+	}
+
+	const unsigned int* colorData(const std::vector<unsigned int>& colors)
+	{
+		return colors.empty() ? nullptr : colors.data();
+	}
+}
+
+DrawArrays::DrawArrays(RendererDrawMode mode, const float* xyz, const unsigned int* colors,
+						unsigned int count, const math::Bounds& bounds)
+:	bounds(bounds), mode(mode)
+{
+	copyVertices(this->vertices, xyz, count);
+	copyColors(this->colors, colors, count);
+}
+
+int DrawArrays::onDispatch( RendererProgram& prg)
+{
+	return prg.drawArrays(this->mode, this->vertices.data(), this->vertices.size(), this->bounds,
+							colorData(this->colors));
+}
+
+bool DrawArrays::vertexBatch(VertexBatch& batch) const
+{
+	if (this->mode == LINE_STRIP || this->mode == LINE_LOOP) return false;
+	batch = { this->mode, this->vertices.data(), colorData(this->colors),
+			(unsigned int)this->vertices.size() };
+	return true;
+}
+
+DrawElements::DrawElements(RendererDrawMode mode, const float* xyz, const unsigned int* colors,
+						unsigned int vertex_count, const unsigned int* indices,
+						unsigned int count, const math::Bounds& bounds)
+:	indices(indices, indices + count), bounds(bounds), mode(mode)
+{
+	copyVertices(this->vertices, xyz, vertex_count);
+	copyColors(this->colors, colors, vertex_count);
+}
+
+int DrawElements::onDispatch( RendererProgram& prg)
+{
+	return prg.drawElements(this->mode, this->vertices.data(), this->vertices.size(),
+							this->indices.data(), this->indices.size(), this->bounds,
+							colorData(this->colors));
+}
+
+UploadVertices::UploadVertices(unsigned int id, const float* xyz, const unsigned int* colors,
+								unsigned int count)
+:	id(id)
+{
+	copyVertices(this->vertices, xyz, count);
+	copyColors(this->colors, colors, count);
+}
+
+int UploadVertices::onDispatch( RendererProgram& prg)
+{
+	return prg.uploadVertices(this->id, this->vertices, this->colors);
+}
+
+int DrawBuffer::onDispatch( RendererProgram& prg)
+{
+	return prg.drawBuffer(this->id, this->mode, this->first, this->count);
+}
+
+int DrawBufferElements::onDispatch( RendererProgram& prg)
+{
+	return prg.drawBufferElements(this->id, this->mode, this->indices.data(), this->indices.size());
+}
+
+int DeleteBuffer::onDispatch( RendererProgram& prg)
+{
+	return prg.deleteBuffer(this->id);
+}
+
+int CreateTarget::onDispatch( RendererProgram& prg)
+{
+	return prg.createTarget(this->id, this->width, this->height);
+}
+
+int SetRenderTarget::onDispatch( RendererProgram& prg)
+{
+	return prg.setRenderTarget(this->id);
+}
+
+int DeleteTarget::onDispatch( RendererProgram& prg)
+{
+	return prg.deleteTarget(this->id);
+}
+
+int SetSupersampling::onDispatch( RendererProgram& prg)
+{
+	return prg.setSupersampling(this->factor);
+}
+
+int Resolve::onDispatch( RendererProgram& prg)
+{
+	return prg.resolve();
+}
+
+int Blit::onDispatch( RendererProgram& prg)
+{
+	return prg.blit(this->source, this->src_region, this->dst_region, this->filter);
+}
+
+int CreateFont::onDispatch( RendererProgram& prg)
+{
+	return prg.createFont(this->id, std::move(this->font));
+}
+
+int DeleteFont::onDispatch( RendererProgram& prg)
+{
+	return prg.deleteFont(this->id);
+}
+
+DrawText::DrawText(unsigned int font, const TextLabel* labels, unsigned int count,
+				const unsigned int* colors)
+:	labels(labels, labels + count)
+,	font(font)
+{
+	// all texts are copied to one buffer, sized up front so that it is never moved
+	size_t length = 0;
+	for (unsigned int i = 0 ; i < count ; i++)
+		length += strlen(labels[i].text) + 1;
+	this->text.resize(length);
+	char* p = this->text.data();
+	for (TextLabel& label : this->labels)
+	{
+		const size_t n = strlen(label.text) + 1;
+		memcpy(p, label.text, n);
+		label.text = p;
+		p += n;
+	}
+	copyColors(this->colors, colors, count);
+}
+
+int DrawText::onDispatch( RendererProgram& prg)
+{
+	return prg.drawText(this->font, this->labels.data(), this->labels.size(),
+						colorData(this->colors));
+}
+
+int DrawGrid::onDispatch( RendererProgram& prg)
+{
+	return prg.drawGrid(this->x_min, this->x_max, this->y_min, this->y_max,
+						this->x_step, this->y_step);
+}
+
+int DrawAxis::onDispatch( RendererProgram& prg)
+{
+	return prg.drawAxis(this->axis, this->from, this->to, this->at, this->step,
+						this->tick_length);
+}
+
+int SetViewportSlot::onDispatch( RendererProgram& prg)
+{
+	return prg.setViewportSlot(this->index, this->viewport, this->proj, this->modelview);
+}
+
+int DrawViewports::onDispatch( RendererProgram& prg)
+{
+	return prg.drawViewports(this->draws.data(), this->draws.size());
+}
+
 int MatrixSet::onDispatch( RendererProgram& prg)
 {
 	if (this->type == 1)
@@ -70,6 +267,27 @@ int MatrixSet::onDispatch( RendererProgram& prg)
 	return 0;
 }
 
+MatrixEffect MatrixSet::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	mat = this->mat;
+	matrix = (this->type == 1) ? 1 : 0;
+	return MATRIX_LOAD;
+}
+
+int MatrixMultiply::onDispatch( RendererProgram& prg)
+{
+	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
+	mat *= this->mat;
+	return 0;
+}
+
+MatrixEffect MatrixMultiply::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	mat = this->mat;
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_MULTIPLY;
+}
+
 int MatrixTranslate::onDispatch( RendererProgram& prg)
 {
 	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
@@ -77,6 +295,14 @@ int MatrixTranslate::onDispatch( RendererProgram& prg)
 	return 0;
 }
 
+MatrixEffect MatrixTranslate::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	mat = Mat4x4f::IDENTITY;
+	math::translate(mat, this->v);
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_MULTIPLY;
+}
+
 int MatrixScale::onDispatch( RendererProgram& prg)
 {
 	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
@@ -84,6 +310,25 @@ int MatrixScale::onDispatch( RendererProgram& prg)
 	return 0;
 }
 
+MatrixEffect MatrixScale::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	mat = Mat4x4f::IDENTITY;
+	math::scale(mat, this->v);
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_MULTIPLY;
+}
+
+MatrixEffect MatrixRotate::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	if (this->axis < 0 || this->axis > 2) return MATRIX_NONE;
+	mat = Mat4x4f::IDENTITY;
+	if (this->axis == 0) math::rotateAroundX(mat, this->ang);
+	else if (this->axis == 1) math::rotateAroundY(mat, this->ang);
+	else math::rotateAroundZ(mat, this->ang);
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_MULTIPLY;
+}
+
 int MatrixRotate::onDispatch( RendererProgram& prg)
 {
 	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
@@ -103,11 +348,73 @@ int MatrixRotate::onDispatch( RendererProgram& prg)
 	return 0;
 }
 
+int MatrixQuaternion::onDispatch( RendererProgram& prg)
+{
+	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
+	math::setRotation(mat, this->q);
+	return 0;
+}
+
+MatrixEffect MatrixQuaternion::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	math::setRotation(mat, this->q);
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_LOAD;
+}
+
+int MatrixEuler::onDispatch( RendererProgram& prg)
+{
+	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
+	math::setRotation(mat, this->pitch, this->yaw, this->roll);
+	return 0;
+}
+
+MatrixEffect MatrixEuler::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	math::setRotation(mat, this->pitch, this->yaw, this->roll);
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_LOAD;
+}
+
+int MatrixTRS::onDispatch( RendererProgram& prg)
+{
+	math::Mat4x4f& mat = (this->matrix == 1) ? prg.proj : prg.modelview;
+	math::setTransform(mat, this->t, this->q, this->s);
+	return 0;
+}
+
+MatrixEffect MatrixTRS::matrixEffect(math::Mat4x4f& mat, int& matrix) const
+{
+	math::setTransform(mat, this->t, this->q, this->s);
+	matrix = (this->matrix == 1) ? 1 : 0;
+	return MATRIX_LOAD;
+}
+
+int PushMatrix::onDispatch( RendererProgram& prg)
+{
+	return prg.pushMatrix(this->matrix);
+}
+
+int PopMatrix::onDispatch( RendererProgram& prg)
+{
+	return prg.popMatrix(this->matrix);
+}
+
 int Clear::onDispatch( RendererProgram& prg)
 {
 	return prg.raw_clear();
 }
 
+int ClearRegion::onDispatch( RendererProgram& prg)
+{
+	return prg.raw_clearRegion(this->region);
+}
+
+int ClearDrawn::onDispatch( RendererProgram& prg)
+{
+	return prg.raw_clearDrawn();
+}
+
 int RawPoint::onDispatch( RendererProgram& prg)
 {
 	if (type == 1)
@@ -122,7 +429,13 @@ int RawLine::onDispatch( RendererProgram& prg)
 
 int Line::onDispatch( RendererProgram& prg)
 {
-	return prg.drawLine(this->point1, this->point2);
+	return prg.drawLine(this->points[0], this->points[1]);
+}
+
+bool Line::vertexBatch(VertexBatch& batch) const
+{
+	batch = { LINES, this->points, nullptr, 2 };
+	return true;
 }
 
 int Point::onDispatch( RendererProgram& prg)
@@ -132,14 +445,50 @@ int Point::onDispatch( RendererProgram& prg)
 	return prg.drawPoint(this->point);
 }
 
+bool Point::vertexBatch(VertexBatch& batch) const
+{
+	batch = { (type == 1) ? BIG_POINTS : POINTS, &this->point, nullptr, 1 };
+	return true;
+}
+
 int ClearColor::onDispatch( RendererProgram& prg)
 {
 	prg.clear_color = this->color;
 	return 0;
 }
 
+bool ClearColor::sameState(const RendererOperation& other) const
+{
+	return static_cast<const ClearColor&>(other).color == this->color;
+}
+
 int FrontColor::onDispatch( RendererProgram& prg)
 {
 	prg.front_color = this->color;
 	return 0;
 }
+
+bool FrontColor::sameState(const RendererOperation& other) const
+{
+	return static_cast<const FrontColor&>(other).color == this->color;
+}
+
+int SetBlendMode::onDispatch( RendererProgram& prg)
+{
+	return prg.setBlendMode(this->mode);
+}
+
+bool SetBlendMode::sameState(const RendererOperation& other) const
+{
+	return static_cast<const SetBlendMode&>(other).mode == this->mode;
+}
+
+int SetPalette::onDispatch( RendererProgram& prg)
+{
+	return prg.setPalette(this->colors.data(), this->colors.size());
+}
+
+int SaveImage::onDispatch( RendererProgram& prg)
+{
+	return prg.saveImage(this->path.c_str(), this->format, this->filter);
+}
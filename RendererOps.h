@@ -8,6 +8,11 @@
 #include "Mat4x4f.h"
 #include "Vector4f.h"
 #include "Region2i.h"
+#include "Bounds.h"
+#include "ImageExport.h"
+#include "RendererStats.h"
+#include <string>
+#include <vector>
 
 /**
  * \namespace derplot::op
@@ -17,6 +22,25 @@ namespace derplot
 {
 	namespace op
 	{
+		/** Effect of an operation on a matrix, see \c RendererOperation::matrixEffect() */
+		enum MatrixEffect
+		{
+			MATRIX_NONE = 0, ///< the operation does not define a matrix
+			MATRIX_LOAD,     ///< the operation replaces a matrix
+			MATRIX_MULTIPLY  ///< the operation multiplies a matrix by another
+		};
+
+		/**
+		 * \brief Vertices drawn by an operation, as seen when merging adjacent draws
+		 */
+		struct VertexBatch
+		{
+			RendererDrawMode mode;
+			const math::Vector4f* vertices;
+			const unsigned int* colors; ///< the color of each vertex, or \c nullptr
+			unsigned int count;
+		};
+
 		/**
 		* \brief abstract class of all renderer operations
 		*/
@@ -28,6 +52,38 @@ namespace derplot
 			 * \return 0 on success, -1 on terminator error
 			 */
 			virtual int onDispatch( RendererProgram& prg) = 0;
+			/**
+			 * \return the type of the operation. Besides profiling, the renderer
+			 * relies on it to find frame boundaries and drawing operations when
+			 * dropping the oldest frame ( \c Renderer::dropOldestFrame() ), and
+			 * \c CommandBuffer::optimize() relies on it to tell which operations
+			 * only change state, so a wrong type changes the drawn pixels.
+			 */
+			virtual OperationType getType(void) const = 0;
+
+			// the following describe operations to CommandBuffer::optimize()
+
+			/**
+			 * Describes how the operation changes a matrix.
+			 * \param mat receives the matrix that replaces the target matrix, or
+			 * that the target matrix is multiplied by
+			 * \param matrix receives the target matrix ( \c 1 for the projection)
+			 */
+			virtual MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const
+			{ return MATRIX_NONE; }
+			/**
+			 * Describes the primitives drawn by the operation.
+			 * \return false if the operation does not draw a list of independent
+			 * points, lines or triangles with no other state
+			 */
+			virtual bool vertexBatch(VertexBatch& batch) const
+			{ return false; }
+			/**
+			 * \return whether the operation defines the same state as \b other ,
+			 * which is an operation of the same type
+			 */
+			virtual bool sameState(const RendererOperation& other) const
+			{ return false; }
 		};
 
 		/**
@@ -38,6 +94,8 @@ namespace derplot
 			public:
 			int onDispatch( RendererProgram& prg)
 			{ return -1; }
+			OperationType getType(void) const
+			{ return OP_TERMINATE; }
 		};
 
 		/**
@@ -50,6 +108,44 @@ namespace derplot
 			ViewPort(math::Region2i viewport)
 				:	viewport(viewport){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_VIEWPORT; }
+			bool sameState(const RendererOperation& other) const;
+		};
+
+		/**
+		 * \brief Operation for setting or disabling the scissor region
+		 */
+		class Scissor : public RendererOperation
+		{
+			math::Region2i region;
+			bool enabled;
+			public:
+			Scissor(void)
+				:	enabled(false) {}
+			Scissor(const math::Region2i& region)
+				:	region(region), enabled(true) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_SCISSOR; }
+			bool sameState(const RendererOperation& other) const;
+		};
+
+		/**
+		 * \brief Operation for defining a viewport of the viewport array
+		 */
+		class SetViewportSlot : public RendererOperation
+		{
+			unsigned int index;
+			math::Region2i viewport;
+			math::Mat4x4f proj, modelview;
+			public:
+			SetViewportSlot(unsigned int index, const math::Region2i& viewport,
+						const math::Mat4x4f& proj, const math::Mat4x4f& modelview)
+				:	index(index), viewport(viewport), proj(proj), modelview(modelview) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_VIEWPORT_SLOT; }
 		};
 
 		/**
@@ -59,6 +155,33 @@ namespace derplot
 		{
 			public:
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_CLEAR; }
+		};
+
+		/**
+		 * \brief Operation for clearing a region of the display
+		 */
+		class ClearRegion : public RendererOperation
+		{
+			math::Region2i region;
+			public:
+			ClearRegion(const math::Region2i& region)
+				:	region(region){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_CLEAR_REGION; }
+		};
+
+		/**
+		 * \brief Operation for clearing the regions drawn since the last clear
+		 */
+		class ClearDrawn : public RendererOperation
+		{
+			public:
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_CLEAR_DRAWN; }
 		};
 
 		/**
@@ -72,6 +195,8 @@ namespace derplot
 			RawPoint(std::pair<int,int> point, int type)
 				:	point(point), type(type){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_RAW_POINT; }
 		};
 
 		/**
@@ -84,6 +209,8 @@ namespace derplot
 			RawLine(std::pair<int,int> point1, std::pair<int,int> point2)
 				:  point1(point1), point2(point2){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_RAW_LINE; }
 		};
 
 		/**
@@ -97,6 +224,9 @@ namespace derplot
 			Point(math::Vector4f point, int type)
 				:	point(point), type(type){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_POINT; }
+			bool vertexBatch(VertexBatch& batch) const;
 		};
 
 		/**
@@ -104,11 +234,295 @@ namespace derplot
 		 */
 		class Line : public RendererOperation
 		{
-			math::Vector4f point1, point2;
+			math::Vector4f points[2];
 			public:
 			Line(const math::Vector4f& point1, const math::Vector4f& point2)
-				:  point1(point1), point2(point2){}
+				:  points{point1, point2}{}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_LINE; }
+			bool vertexBatch(VertexBatch& batch) const;
+		};
+
+		/**
+		 * \brief Operation for drawing a batch of 3D primitives
+		 */
+		class DrawArrays : public RendererOperation
+		{
+			std::vector<math::Vector4f> vertices;
+			std::vector<unsigned int> colors;
+			math::Bounds bounds;
+			RendererDrawMode mode;
+			public:
+			DrawArrays(RendererDrawMode mode, const float* xyz, const unsigned int* colors,
+						unsigned int count, const math::Bounds& bounds);
+			DrawArrays(RendererDrawMode mode, std::vector<math::Vector4f>&& vertices,
+						std::vector<unsigned int>&& colors, const math::Bounds& bounds)
+				:	vertices(std::move(vertices)), colors(std::move(colors)),
+					bounds(bounds), mode(mode) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_ARRAYS; }
+			bool vertexBatch(VertexBatch& batch) const;
+		};
+
+		/**
+		 * \brief Operation for drawing a batch of indexed vertices
+		 */
+		class DrawElements : public RendererOperation
+		{
+			std::vector<math::Vector4f> vertices;
+			std::vector<unsigned int> colors;
+			std::vector<unsigned int> indices;
+			math::Bounds bounds;
+			RendererDrawMode mode;
+			public:
+			DrawElements(RendererDrawMode mode, const float* xyz, const unsigned int* colors,
+						unsigned int vertex_count, const unsigned int* indices,
+						unsigned int count, const math::Bounds& bounds);
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_ELEMENTS; }
+		};
+
+		/**
+		 * \brief Operation for replacing the vertices of a vertex buffer
+		 */
+		class UploadVertices : public RendererOperation
+		{
+			std::vector<math::Vector4f> vertices;
+			std::vector<unsigned int> colors;
+			unsigned int id;
+			public:
+			UploadVertices(unsigned int id, const float* xyz, const unsigned int* colors,
+						unsigned int count);
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_UPLOAD_VERTICES; }
+		};
+
+		/**
+		 * \brief Operation for drawing a range of a vertex buffer
+		 */
+		class DrawBuffer : public RendererOperation
+		{
+			unsigned int id, first, count;
+			RendererDrawMode mode;
+			public:
+			DrawBuffer(unsigned int id, RendererDrawMode mode,
+						unsigned int first, unsigned int count)
+				:	id(id), first(first), count(count), mode(mode) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_BUFFER; }
+		};
+
+		/**
+		 * \brief Operation for drawing indexed vertices of a vertex buffer
+		 */
+		class DrawBufferElements : public RendererOperation
+		{
+			std::vector<unsigned int> indices;
+			unsigned int id;
+			RendererDrawMode mode;
+			public:
+			DrawBufferElements(unsigned int id, RendererDrawMode mode,
+						const unsigned int* indices, unsigned int count)
+				:	indices(indices, indices + count), id(id), mode(mode) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_BUFFER_ELEMENTS; }
+		};
+
+		/**
+		 * \brief Operation for drawing ranges of vertex buffers into viewports
+		 * of the viewport array
+		 */
+		class DrawViewports : public RendererOperation
+		{
+			std::vector<ViewportDraw> draws;
+			public:
+			DrawViewports(const ViewportDraw* draws, unsigned int count)
+				:	draws(draws, draws + count) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_VIEWPORTS; }
+		};
+
+		/**
+		 * \brief Operation for releasing a vertex buffer
+		 */
+		class DeleteBuffer : public RendererOperation
+		{
+			unsigned int id;
+			public:
+			DeleteBuffer(unsigned int id)
+				:	id(id) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DELETE_BUFFER; }
+		};
+
+		/**
+		 * \brief Operation for creating an offscreen render target
+		 */
+		class CreateTarget : public RendererOperation
+		{
+			unsigned int id;
+			int width, height;
+			public:
+			CreateTarget(unsigned int id, int width, int height)
+				:	id(id), width(width), height(height) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_CREATE_TARGET; }
+		};
+
+		/**
+		 * \brief Operation for choosing the render target
+		 */
+		class SetRenderTarget : public RendererOperation
+		{
+			unsigned int id;
+			public:
+			SetRenderTarget(unsigned int id)
+				:	id(id) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_RENDER_TARGET; }
+		};
+
+		/**
+		 * \brief Operation for releasing an offscreen render target
+		 */
+		class DeleteTarget : public RendererOperation
+		{
+			unsigned int id;
+			public:
+			DeleteTarget(unsigned int id)
+				:	id(id) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DELETE_TARGET; }
+		};
+
+		/**
+		 * \brief Operation for defining the supersampling factor of the display
+		 */
+		class SetSupersampling : public RendererOperation
+		{
+			int factor;
+			public:
+			SetSupersampling(int factor)
+				:	factor(factor) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_SUPERSAMPLING; }
+		};
+
+		/**
+		 * \brief Operation for resolving the changed samples into the display
+		 */
+		class Resolve : public RendererOperation
+		{
+			public:
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_RESOLVE; }
+		};
+
+		/**
+		 * \brief Operation for copying a region of a render target to the current one
+		 */
+		class Blit : public RendererOperation
+		{
+			math::Region2i src_region, dst_region;
+			unsigned int source;
+			BlitFilter filter;
+			public:
+			Blit(unsigned int source, const math::Region2i& src_region,
+					const math::Region2i& dst_region, BlitFilter filter)
+				:	src_region(src_region), dst_region(dst_region), source(source), filter(filter) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_BLIT; }
+		};
+
+		/**
+		 * \brief Operation for defining a font
+		 */
+		class CreateFont : public RendererOperation
+		{
+			Font font;
+			unsigned int id;
+			public:
+			CreateFont(unsigned int id, Font&& font)
+				:	font(std::move(font)), id(id) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_CREATE_FONT; }
+		};
+
+		/**
+		 * \brief Operation for releasing a font
+		 */
+		class DeleteFont : public RendererOperation
+		{
+			unsigned int id;
+			public:
+			DeleteFont(unsigned int id)
+				:	id(id) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DELETE_FONT; }
+		};
+
+		/**
+		 * \brief Operation for drawing texts placed at points
+		 */
+		class DrawText : public RendererOperation
+		{
+			std::vector<TextLabel> labels; // pointing to the text below
+			std::vector<char> text;
+			std::vector<unsigned int> colors;
+			unsigned int font;
+			public:
+			DrawText(unsigned int font, const TextLabel* labels, unsigned int count,
+					const unsigned int* colors);
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_TEXT; }
+		};
+
+		/**
+		 * \brief Operation for drawing the lines of a plot grid
+		 */
+		class DrawGrid : public RendererOperation
+		{
+			float x_min, x_max, y_min, y_max, x_step, y_step;
+			public:
+			DrawGrid(float x_min, float x_max, float y_min, float y_max,
+					float x_step, float y_step)
+				:	x_min(x_min), x_max(x_max), y_min(y_min), y_max(y_max)
+				,	x_step(x_step), y_step(y_step) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_GRID; }
+		};
+
+		/**
+		 * \brief Operation for drawing a plot axis and its ticks
+		 */
+		class DrawAxis : public RendererOperation
+		{
+			float from, to, at, step;
+			int axis, tick_length;
+			public:
+			DrawAxis(int axis, float from, float to, float at, float step, int tick_length)
+				:	from(from), to(to), at(at), step(step), axis(axis), tick_length(tick_length) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_DRAW_AXIS; }
 		};
 
 		/**
@@ -122,6 +536,25 @@ namespace derplot
 			MatrixSet(const math::Mat4x4f& mat, int matrix)
 				:	mat(mat), type(matrix){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_SET; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
+		};
+
+		/**
+		 * \brief Operation for multiplying a matrix by another
+		 */
+		class MatrixMultiply : public RendererOperation
+		{
+			math::Mat4x4f mat;
+			int matrix;
+			public:
+			MatrixMultiply(const math::Mat4x4f& mat, int matrix = 0)
+				:	mat(mat), matrix(matrix){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_MULTIPLY; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
 		};
 
 		/**
@@ -136,6 +569,8 @@ namespace derplot
 				:	left(left), right(right), top(top),
 					bottom(bottom), near(near), far(far) {}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_ORTHO; }
 		};
 
 		/**
@@ -148,6 +583,8 @@ namespace derplot
 			Perspective( float fovy, float near, float far, float aspect_ratio)
 				:	fovy(fovy), near(near), far(far), ratio(aspect_ratio) {}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_PERSPECTIVE; }
 		};
 
 		/**
@@ -161,6 +598,9 @@ namespace derplot
 			MatrixTranslate(const math::Vector4f& v, int matrix = 0)
 				:	v(v), matrix(matrix){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_TRANSLATE; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
 		};
 
 		/**
@@ -175,6 +615,9 @@ namespace derplot
 			MatrixRotate(float angle, int axis, int matrix = 0)
 				:	ang(angle), axis(axis), matrix(matrix){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_ROTATE; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
 		};
 
 		/**
@@ -187,6 +630,87 @@ namespace derplot
 			MatrixScale(const math::Vector4f& v, int matrix = 0)
 				:	v(v), matrix(matrix){}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_SCALE; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
+		};
+
+		/**
+		 * \brief Operation for setting a matrix to the rotation of a quaternion
+		 */
+		class MatrixQuaternion : public RendererOperation
+		{
+			math::Vector4f q; int matrix;
+			public:
+			MatrixQuaternion(const math::Vector4f& q, int matrix = 0)
+				:	q(q), matrix(matrix){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_QUATERNION; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
+		};
+
+		/**
+		 * \brief Operation for setting a matrix to a sequence of rotations around
+		 * the X, Y and Z axes
+		 */
+		class MatrixEuler : public RendererOperation
+		{
+			float pitch, yaw, roll;
+			int matrix;
+			public:
+			MatrixEuler(float pitch, float yaw, float roll, int matrix = 0)
+				:	pitch(pitch), yaw(yaw), roll(roll), matrix(matrix){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_EULER; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
+		};
+
+		/**
+		 * \brief Operation for setting a matrix to a translate-rotate-scale
+		 * transformation
+		 */
+		class MatrixTRS : public RendererOperation
+		{
+			math::Vector4f t, q, s;
+			int matrix;
+			public:
+			MatrixTRS(const math::Vector4f& t, const math::Vector4f& q,
+					const math::Vector4f& s, int matrix = 0)
+				:	t(t), q(q), s(s), matrix(matrix){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_MATRIX_TRS; }
+			MatrixEffect matrixEffect(math::Mat4x4f& mat, int& matrix) const;
+		};
+
+		/**
+		 * \brief Operation for saving a matrix onto its stack
+		 */
+		class PushMatrix : public RendererOperation
+		{
+			int matrix;
+			public:
+			PushMatrix(int matrix = 0)
+				:	matrix(matrix){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_PUSH_MATRIX; }
+		};
+
+		/**
+		 * \brief Operation for restoring a matrix from its stack
+		 */
+		class PopMatrix : public RendererOperation
+		{
+			int matrix;
+			public:
+			PopMatrix(int matrix = 0)
+				:	matrix(matrix){}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_POP_MATRIX; }
 		};
 
 		/**
@@ -199,6 +723,9 @@ namespace derplot
 			ClearColor(unsigned int color)
 				:	color(color) {}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_CLEAR_COLOR; }
+			bool sameState(const RendererOperation& other) const;
 		};
 
 		/**
@@ -211,6 +738,54 @@ namespace derplot
 			FrontColor(unsigned int color)
 				:	color(color) {}
 			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_FRONT_COLOR; }
+			bool sameState(const RendererOperation& other) const;
+		};
+
+		/**
+		 * \brief Operation for defining the blend mode
+		 */
+		class SetBlendMode : public RendererOperation
+		{
+			BlendMode mode;
+			public:
+			SetBlendMode(BlendMode mode)
+				:	mode(mode) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_BLEND_MODE; }
+			bool sameState(const RendererOperation& other) const;
+		};
+
+		/**
+		 * \brief Operation for defining the palette of an indexed buffer
+		 */
+		class SetPalette : public RendererOperation
+		{
+			std::vector<unsigned int> colors;
+			public:
+			SetPalette(const unsigned int* colors, int count)
+				:	colors(colors, colors + ((count > 0) ? count : 0)) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_PALETTE; }
+		};
+
+		/**
+		 * \brief Operation for saving the display buffer to an image file
+		 */
+		class SaveImage : public RendererOperation
+		{
+			std::string path;
+			ImageFormat format;
+			PngFilter filter;
+			public:
+			SaveImage(const char* path, ImageFormat format, PngFilter filter)
+				:	path(path), format(format), filter(filter) {}
+			int onDispatch( RendererProgram& prg);
+			OperationType getType(void) const
+			{ return OP_SAVE_IMAGE; }
 		};
 
 	};
@@ -5,21 +5,108 @@
 #include "RendererProgram.h"
 
 #include "MathUtils.h"
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <thread>
+
+#ifdef Derplotter_PROFILE
+#define PROFILE_COUNT(counter, n) (this->counter += (n))
+#else
+#define PROFILE_COUNT(counter, n)
+#endif
 
 using namespace derplot;
 using namespace math;
 
+constexpr unsigned char RendererProgram::UNTRANSFORMED;
+
+namespace
+{
+	// interpolates two ARGB colors, with the weight of \b b in [0,256)
+	inline unsigned int lerpColor(unsigned int a, unsigned int b, unsigned int f)
+	{
+		const unsigned int rb = ((a & 0x00FF00FF) * (256 - f) + (b & 0x00FF00FF) * f) >> 8;
+		const unsigned int ag = ((a >> 8) & 0x00FF00FF) * (256 - f) + ((b >> 8) & 0x00FF00FF) * f;
+		return (rb & 0x00FF00FF) | (ag & 0xFF00FF00);
+	}
+
+	// scales a region by num/den, covering every pixel it partly covers
+	Region2i scaleRegion(const Region2i& r, int num, int den)
+	{
+		auto low = [=](int v) { return (int)(((long long)v * num - (v < 0 ? den - 1 : 0)) / den); };
+		auto high = [=](int v) { return (int)(((long long)v * num + (v > 0 ? den - 1 : 0)) / den); };
+		return Region2i(low(r.getMinX()), high(r.getMaxX()), low(r.getMinY()), high(r.getMaxY()));
+	}
+
+	// averages each block of factor x factor samples (ARGB8888) of the rows [y0,y1)
+	// and columns [x0,x1) of the display, summing two channels per 32-bit lane
+	template<int F>
+	void resolveBand(const DisplayBuffer* samples, DisplayBuffer* display,
+					const RasterKernels* kernels, int x0, int x1, int y0, int y1)
+	{
+		constexpr int shift = (F == 2) ? 2 : 4;
+		constexpr unsigned int bias = 0x00010001u << (shift - 1);
+		const int length = x1 - x0;
+		std::vector<unsigned int> line(length);
+		for (int y = y0 ; y < y1 ; y++)
+		{
+			const unsigned int* rows[F];
+			for (int k = 0 ; k < F ; k++)
+				rows[k] = (const unsigned int*)((const unsigned char*)samples->data()
+						+ (long long)samples->getPitch()*(y * F + k)) + x0 * F;
+			// red/blue and alpha/green are summed in separate 16-bit lanes
+			for (int i = 0 ; i < length ; i++)
+			{
+				unsigned int rb = bias, ag = bias;
+				for (int k = 0 ; k < F ; k++)
+					for (int j = 0 ; j < F ; j++)
+					{
+						const unsigned int p = rows[k][i*F + j];
+						rb += p & 0x00FF00FF;
+						ag += (p >> 8) & 0x00FF00FF;
+					}
+				line[i] = ((rb >> shift) & 0x00FF00FF) | ((ag >> shift) & 0x00FF00FF) << 8;
+			}
+			kernels->colorSpan(display->pixels() + (long long)display->getPitch()*y, x0,
+								length, line.data());
+		}
+	}
+
+	// source position of the center of destination pixel d, in 16.16 fixed point
+	inline long long sourcePosition(int d, int d0, int dsize, int s0, int ssize)
+	{
+		return (long long)s0 * 65536 + ((2LL*(d - d0) + 1) * ssize * 65536) / (2LL*dsize);
+	}
+}
+
 RendererProgram::RendererProgram(void)
 :	p_buffer(nullptr)
+,	p_display(nullptr)
+,	kernels(nullptr)
+,	blend_mode(BLEND_REPLACE)
+,	target(0)
+,	supersampling(1)
+,	pixels_written(0)
+,	primitives_culled(0)
 {}
 
 RendererProgram::RendererProgram(DisplayBuffer& buffer)
 :	p_buffer(&buffer)
+,	p_display(&buffer)
+,	kernels(&rasterKernels(buffer.getFormat(), BLEND_REPLACE))
+,	blend_mode(BLEND_REPLACE)
+,	clip(buffer.getWidth(), buffer.getHeight())
+,	target(0)
+,	supersampling(1)
 ,	modelview(Mat4x4f::IDENTITY)
 ,	proj(Mat4x4f::IDENTITY)
 ,	viewport(0, buffer.getWidth(), 0, buffer.getHeight())
 ,	front_color(DEFAULT_FRONT_COLOR)
 ,	clear_color(DEFAULT_CLEAR_COLOR)
+,	pixels_written(0)
+,	primitives_culled(0)
 {
 }
 
@@ -34,79 +121,254 @@ bool RendererProgram::operator!(void) const
 
 int RendererProgram::raw_clear(void)
 {
-	if (this->p_buffer->clear(this->clear_color))
-		return 0;
-	return 1;
+	DERPLOTTER_TRACE_SCOPE("clear");
+	if (!this->p_buffer->clear(this->clear_color))
+		return 1;
+	if (this->target == 0)
+		this->changed().assign(1, Region2i(p_buffer->getWidth(), p_buffer->getHeight()));
+	this->drawn.clear();
+	PROFILE_COUNT(pixels_written, (unsigned long long)p_buffer->getWidth()*p_buffer->getHeight());
+	return 0;
 }
 
-int RendererProgram::raw_drawPoint(const std::pair<int,int>& p)
+int RendererProgram::raw_clearRegion(const Region2i& region)
 {
-	const int& x = p.first, &y = p.second;
-	if (x < 0 || y < 0 )
+	DERPLOTTER_TRACE_SCOPE("clearRegion");
+	if (!this->p_buffer->clear(this->clear_color, region))
 		return 1;
+	this->markDirty(region);
+#ifdef Derplotter_PROFILE
+	Region2i r = region;
+	r.intersect(Region2i(p_buffer->getWidth(), p_buffer->getHeight()));
+	if (!r.isEmpty())
+		PROFILE_COUNT(pixels_written, r.area());
+#endif
+	return 0;
+}
 
-	return p_buffer->plot(x, y, this->front_color) ? 0 : 1; // plot it!
+int RendererProgram::raw_clearDrawn(void)
+{
+	DERPLOTTER_TRACE_SCOPE("clearDrawn");
+	for (const Region2i& r : this->drawn)
+	{
+		if (!this->p_buffer->clear(this->clear_color, r))
+			return 1;
+		if (this->target == 0)
+			addRegion(this->changed(), r);
+		PROFILE_COUNT(pixels_written, r.area());
+	}
+	this->drawn.clear();
+	return 0;
 }
 
-int RendererProgram::raw_drawBigPoint(const std::pair<int,int>& p)
+int RendererProgram::raw_drawPoint(const std::pair<int,int>& p, unsigned int color)
 {
 	const int& x = p.first, &y = p.second;
-	if (x < 0 || y < 0 )
+	const int pitch = p_buffer->getPitch();
+	if (x < clip.getMinX() || y < clip.getMinY() || x >= clip.getMaxX() || y >= clip.getMaxY())
+	{
+		PROFILE_COUNT(primitives_culled, 1);
 		return 1;
+	}
+
+	kernels->plot(p_buffer->pixels() + (long long)pitch*y, x, color); // plot it!
+	PROFILE_COUNT(pixels_written, 1);
+	this->markDrawn(Region2i(x, x+1, y, y+1));
+	return 0;
+}
 
-	if (!p_buffer->plot(x, y, this->front_color)) return 1;
+int RendererProgram::raw_drawBigPoint(const std::pair<int,int>& p, unsigned int color)
+{
+	const int& x = p.first, &y = p.second;
+	const int min_x = clip.getMinX(), max_x = clip.getMaxX();
+	const int min_y = clip.getMinY(), max_y = clip.getMaxY();
+	const int pitch = p_buffer->getPitch();
+	// the arms of a point just outside the clip region may still be inside
+	if (x < min_x - 1 || y < min_y - 1 || x > max_x || y > max_y)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 1;
+	}
 
-	p_buffer->plot(x-1, y, this->front_color);
-	p_buffer->plot(x+1, y, this->front_color);
-	p_buffer->plot(x, y-1, this->front_color);
-	p_buffer->plot(x, y+1, this->front_color);
+	// middle row, clipped horizontally, and the pixels above and below
+	const int x0 = std::max(x-1, min_x);
+	const int x1 = std::min(x+1, max_x-1);
+	const bool row_in = y >= min_y && y < max_y && x0 <= x1;
+	const bool column_in = x >= min_x && x < max_x;
+	const bool up = column_in && y-1 >= min_y && y-1 < max_y;
+	const bool down = column_in && y+1 >= min_y && y+1 < max_y;
+	if (!row_in && !up && !down)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 1;
+	}
+	unsigned char* row = p_buffer->pixels() + (long long)pitch*y;
+	if (row_in)
+		kernels->span(row, x0, x1-x0+1, color);
+	if (up)
+		kernels->plot(row - pitch, x, color);
+	if (down)
+		kernels->plot(row + pitch, x, color);
+	PROFILE_COUNT(pixels_written, (row_in ? x1-x0+1 : 0) + up + down);
+	this->markDrawn(Region2i(x-1, x+2, y-1, y+2));
 	return 0;
 }
 
-int RendererProgram::raw_drawLine(std::pair<int,int>& p1, std::pair<int,int>& p2)
+int RendererProgram::raw_drawShadedLine(std::pair<int,int>& p1, std::pair<int,int>& p2,
+										unsigned int c1, unsigned int c2)
 {
-	if (p1 == p2) return raw_drawPoint(p1);
+	if (p1 == p2) return raw_drawPoint(p1, c1);
+
+	// bounding box of the line, with a margin for rounding errors
+	this->markDrawn(Region2i(
+		std::min(p1.first, p2.first) - 1, std::max(p1.first, p2.first) + 2,
+		std::min(p1.second, p2.second) - 1, std::max(p1.second, p2.second) + 2));
 
-	float m, b;
 	const int dx = p2.first - p1.first;
 	const int dy = p2.second - p1.second;
 	const int abs_dx = (dx >= 0) ? dx : -dx;
 	const int abs_dy = (dy >= 0) ? dy : -dy;
+	const bool shaded = c1 != c2;
 	if (abs_dx > abs_dy) // X range greater than Y range
 	{
 		if (p1.first > p2.first)
+		{
 			p1.swap(p2);
+			std::swap(c1, c2);
+		}
 
-		// m = dy / dx ; y = x*m + b <=> b = y1-x1*m;
-		m = (float)dy / (float)dx;
-		b = p1.second - p1.first*m;
-		int x = (p1.first < 0) ? 0 : p1.first;
-		const int xmax = (p2.first > p_buffer->getWidth())
-			? p_buffer->getWidth()-1 : p2.first;
-		for (; x <= xmax ; x++)
+		// y = (v0 + x*slope) >> 16, with v0 rounding to the nearest pixel
+		const long long slope = (long long)(p2.second - p1.second) * 65536 / abs_dx;
+		const long long v0 = (long long)p1.second * 65536 + 0x8000 - p1.first*slope;
+		int x0 = std::max(p1.first, clip.getMinX());
+		int x1 = std::min(p2.first, clip.getMaxX()-1);
+		if (!clipLine(x0, x1, v0, slope, clip.getMinY(), clip.getMaxY()))
+		{
+			PROFILE_COUNT(primitives_culled, 1);
+			return 0;
+		}
+		PROFILE_COUNT(pixels_written, x1-x0+1);
+		if (shaded)
 		{
-			int y = (int)(x*m + b);
-			p_buffer->plot(x, y, this->front_color);
+			const ShadeColor from = ShadeColor::of(c1), to = ShadeColor::of(c2);
+			kernels->shadedLineX(p_buffer->pixels(), p_buffer->getPitch(), x0, x1,
+							v0 + x0*slope, slope, ShadeColor::lerp(from, to, x0 - p1.first, abs_dx),
+							ShadeColor::step(from, to, abs_dx));
 		}
+		else if (slope == 0) // horizontal line
+			kernels->span(p_buffer->pixels() + (long long)p_buffer->getPitch()*p1.second,
+							x0, x1-x0+1, c1);
+		else
+			kernels->lineX(p_buffer->pixels(), p_buffer->getPitch(), x0, x1,
+							v0 + x0*slope, slope, c1);
 	}
 	else // Y range greater than X range
 	{
 		if (p1.second > p2.second)
+		{
 			p1.swap(p2);
+			std::swap(c1, c2);
+		}
 
-		// m = dx / dy ; x = y*m + b <=> b = x1-y1*m;
-		m = (float)dx / (float) dy;
-		b = p1.first - p1.second*m;
-		int y = (p1.second < 0) ? 0 : p1.second;
-		const int ymax = (p2.second > p_buffer->getHeight())
-			? p_buffer->getHeight()-1 : p2.second;
-		for ( ; y <= ymax ; y++)
+		// x = (v0 + y*slope) >> 16, with v0 rounding to the nearest pixel
+		const long long slope = (long long)(p2.first - p1.first) * 65536 / abs_dy;
+		const long long v0 = (long long)p1.first * 65536 + 0x8000 - p1.second*slope;
+		int y0 = std::max(p1.second, clip.getMinY());
+		int y1 = std::min(p2.second, clip.getMaxY()-1);
+		if (!clipLine(y0, y1, v0, slope, clip.getMinX(), clip.getMaxX()))
 		{
-			int x = (int)(y*m + b);
-			p_buffer->plot(x, y, this->front_color);
+			PROFILE_COUNT(primitives_culled, 1);
+			return 0;
 		}
+		PROFILE_COUNT(pixels_written, y1-y0+1);
+		if (shaded)
+		{
+			const ShadeColor from = ShadeColor::of(c1), to = ShadeColor::of(c2);
+			kernels->shadedLineY(p_buffer->pixels(), p_buffer->getPitch(), y0, y1,
+							v0 + y0*slope, slope, ShadeColor::lerp(from, to, y0 - p1.second, abs_dy),
+							ShadeColor::step(from, to, abs_dy));
+		}
+		else if (slope == 0) // vertical line
+			kernels->column(p_buffer->pixels(), p_buffer->getPitch(), p1.first,
+							y0, y1-y0+1, c1);
+		else
+			kernels->lineY(p_buffer->pixels(), p_buffer->getPitch(), y0, y1,
+							v0 + y0*slope, slope, c1);
+	}
+
+	return 0;
+}
+
+int RendererProgram::raw_fillShadedTriangle(std::pair<int,int> p1, std::pair<int,int> p2,
+										std::pair<int,int> p3, unsigned int c1, unsigned int c2,
+										unsigned int c3)
+{
+	// sort the vertices from top to bottom
+	if (p1.second > p2.second) { p1.swap(p2); std::swap(c1, c2); }
+	if (p2.second > p3.second) { p2.swap(p3); std::swap(c2, c3); }
+	if (p1.second > p2.second) { p1.swap(p2); std::swap(c1, c2); }
+
+	const int clip_x0 = clip.getMinX(), clip_x1 = clip.getMaxX();
+	const int y0 = std::max(p1.second, clip.getMinY()), y1 = std::min(p3.second, clip.getMaxY());
+	const int min_x = std::min(std::min(p1.first, p2.first), p3.first);
+	const int max_x = std::max(std::max(p1.first, p2.first), p3.first);
+	// coordinates beyond the guard band would overflow the edge positions
+	const int guard = 1 << 20;
+	if (y0 >= y1 || max_x < clip_x0 || min_x >= clip_x1
+		|| min_x < -guard || max_x > guard || p1.second < -guard || p3.second > guard)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 0;
 	}
+	this->markDrawn(Region2i(min_x, max_x + 1, p1.second, p3.second));
+
+	// the color is a linear function of the pixel position, C(x,y) = C1 + x*dcdx + y*dcdy
+	// relative to p1, and is sampled at both ends of each span (clamped to the range
+	// of the vertex colors) so that the kernels only step from one to the other
+	const bool shaded = c1 != c2 || c2 != c3;
+	const long long ex1 = p2.first - p1.first, ey1 = p2.second - p1.second;
+	const long long ex2 = p3.first - p1.first, ey2 = p3.second - p1.second;
+	const long long area = ex1*ey2 - ex2*ey1;
+	const ShadeColor s1 = ShadeColor::of(c1), s2 = ShadeColor::of(c2), s3 = ShadeColor::of(c3);
+	auto colorAt = [&](int x, int y) {
+		const long long px = x - p1.first, py = y - p1.second;
+		auto channel = [&](int v1, int v2, int v3) {
+			const long long d2 = v2 - v1, d3 = v3 - v1;
+			const long long v = v1 + (long long)(((double)px*(d2*ey2 - d3*ey1)
+					+ (double)py*(d3*ex1 - d2*ex2)) / area);
+			const int lo = std::min(std::min(v1, v2), v3), hi = std::max(std::max(v1, v2), v3);
+			return (int)std::min(std::max(v, (long long)lo), (long long)hi);
+		};
+		return ShadeColor{ channel(s1.a, s2.a, s3.a), channel(s1.r, s2.r, s3.r),
+							channel(s1.g, s2.g, s3.g), channel(s1.b, s2.b, s3.b) };
+	};
 
+	// rows [p1.y, p3.y) are covered, from the long edge (p1,p3) to one of the short
+	// edges; the positions are exact in 16.16 fixed point, and pixels are covered
+	// from ceil(left) up to, but not including, ceil(right)
+	auto edgeX = [](const std::pair<int,int>& a, const std::pair<int,int>& b, int y) {
+		return (long long)a.first * 65536
+				+ ((long long)(b.first - a.first) * (y - a.second) * 65536) / (b.second - a.second);
+	};
+	const int pitch = p_buffer->getPitch();
+	unsigned char* row = p_buffer->pixels() + (long long)pitch*y0;
+	for (int y = y0 ; y < y1 ; y++, row += pitch)
+	{
+		long long xa = edgeX(p1, p3, y);
+		long long xb = (y < p2.second) ? edgeX(p1, p2, y) : edgeX(p2, p3, y);
+		if (xa > xb) std::swap(xa, xb);
+		const int x0 = std::max((int)((xa + 0xFFFF) >> 16), clip_x0);
+		const int x1 = std::min((int)((xb + 0xFFFF) >> 16), clip_x1);
+		if (x0 >= x1) continue;
+		if (shaded && area != 0)
+		{
+			const ShadeColor from = colorAt(x0, y), to = colorAt(x1 - 1, y);
+			kernels->shadedSpan(row, x0, x1 - x0, from, ShadeColor::step(from, to, x1 - x0 - 1));
+		}
+		else
+			kernels->span(row, x0, x1 - x0, c1);
+		PROFILE_COUNT(pixels_written, x1 - x0);
+	}
 	return 0;
 }
 
@@ -115,7 +377,11 @@ int RendererProgram::drawPoint(const Vector4f& point)
 	Vector4f p = point;
 	std::pair<int,int> rp(-1,-1);
 	int r = this->transformPoint(p, rp);
-	if (r != 0) return 0;
+	if (r != 0)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 0;
+	}
 	this->raw_drawPoint(rp);
 	return 0;
 }
@@ -125,7 +391,11 @@ int RendererProgram::drawBigPoint(const Vector4f& point)
 	Vector4f p = point;
 	std::pair<int,int> rp(-1,-1);
 	int r = this->transformPoint(p, rp);
-	if (r != 0) return 0;
+	if (r != 0)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 0;
+	}
 	this->raw_drawBigPoint(rp);
 	return 0;
 }
@@ -137,15 +407,1061 @@ int RendererProgram::drawLine(const Vector4f& point1, const Vector4f& point2)
 	Vector4f p = point1;
 	int r;
 	r = this->transformPoint(p, rp1);
-	if (r == 2) return 0;
+	if (r == 2)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 0;
+	}
 	p = point2;
 	r = this->transformPoint(p, rp2);
-	if (r == 2) return 0;
+	if (r == 2)
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 0;
+	}
 
 	// draw a raw line with them
 	return this->raw_drawLine(rp1, rp2);
 }
 
+int RendererProgram::drawArrays(RendererDrawMode mode, const Vector4f* vertices,
+								unsigned int count, const Bounds& bounds,
+								const unsigned int* colors)
+{
+	unsigned int primitives;
+	if (!primitiveCount(mode, count, primitives)) return 1;
+	if (primitives == 0) return 0;
+
+	const Mat4x4f mvp = this->proj * this->modelview;
+	const Frustum::Visibility visibility = Frustum(mvp).classify(bounds);
+	if (visibility == Frustum::OUTSIDE)
+	{
+		PROFILE_COUNT(primitives_culled, primitives);
+		return 0;
+	}
+
+	// transform each vertex once
+	this->batch_pos.resize(count);
+	this->batch_clip.resize(count);
+	for (unsigned int i = 0 ; i < count ; i++)
+		this->transformBatchVertex(vertices[i], i, mvp, visibility == Frustum::INSIDE);
+
+	this->drawBatch(mode, nullptr, count, primitives, colors);
+	return 0;
+}
+
+int RendererProgram::drawElements(RendererDrawMode mode, const Vector4f* vertices,
+								unsigned int vertex_count, const unsigned int* indices,
+								unsigned int count, const Bounds& bounds,
+								const unsigned int* colors)
+{
+	unsigned int primitives;
+	if (!primitiveCount(mode, count, primitives)) return 1;
+	for (unsigned int k = 0 ; k < count ; k++)
+		if (indices[k] >= vertex_count) return 1;
+	if (primitives == 0) return 0;
+
+	const Mat4x4f mvp = this->proj * this->modelview;
+	const Frustum::Visibility visibility = Frustum(mvp).classify(bounds);
+	if (visibility == Frustum::OUTSIDE)
+	{
+		PROFILE_COUNT(primitives_culled, primitives);
+		return 0;
+	}
+
+	// post-transform cache: each referenced vertex is transformed on its first use
+	this->batch_pos.resize(vertex_count);
+	this->batch_clip.assign(vertex_count, UNTRANSFORMED);
+	for (unsigned int k = 0 ; k < count ; k++)
+	{
+		const unsigned int i = indices[k];
+		if (this->batch_clip[i] == UNTRANSFORMED)
+			this->transformBatchVertex(vertices[i], i, mvp, visibility == Frustum::INSIDE);
+	}
+
+	this->drawBatch(mode, indices, count, primitives, colors);
+	return 0;
+}
+
+bool RendererProgram::primitiveCount(RendererDrawMode mode, unsigned int count,
+									unsigned int& primitives)
+{
+	switch (mode)
+	{
+		case NOTHING: primitives = 0; return true;
+		case POINTS: case BIG_POINTS: primitives = count; return true;
+		case LINES: primitives = count / 2; return true;
+		case LINE_STRIP: primitives = (count > 1) ? count - 1 : 0; return true;
+		case LINE_LOOP: primitives = (count > 2) ? count : (count > 1) ? 1 : 0; return true;
+		case TRIANGLES: primitives = count / 3; return true;
+		default: return false;
+	}
+}
+
+void RendererProgram::transformBatchVertex(const Vector4f& v, unsigned int i,
+											const Mat4x4f& mvp, bool inside)
+{
+	Vector4f p = v;
+	math::multiply(p, mvp);
+	std::pair<int,int>& rp = this->batch_pos[i];
+	if (inside && p.w() != 0)
+	{
+		// the right and bottom edges of the frustum map to just past the viewport,
+		// so vertices there are clipped as projectPoint() does
+		p.normalize();
+		this->batch_clip[i] = this->viewport.posOf(p.x(), p.y(), rp.first, rp.second) ? 0 : 1;
+	}
+	else
+	{
+		rp.first = rp.second = -1;
+		this->batch_clip[i] = (unsigned char)this->projectPoint(p, rp);
+	}
+}
+
+void RendererProgram::drawBatch(RendererDrawMode mode, const unsigned int* indices,
+								unsigned int count, unsigned int primitives,
+								const unsigned int* colors)
+{
+	auto index = [indices](unsigned int k) { return indices ? indices[k] : k; };
+	const unsigned int front = this->front_color;
+	auto color = [colors, front](unsigned int i) { return colors ? colors[i] : front; };
+
+	// assemble the primitives, with the same rules as drawPoint() and drawLine()
+	if (mode == POINTS || mode == BIG_POINTS)
+	{
+		for (unsigned int k = 0 ; k < count ; k++)
+		{
+			const unsigned int i = index(k);
+			if (this->batch_clip[i] != 0)
+				PROFILE_COUNT(primitives_culled, 1);
+			else if (mode == POINTS)
+				this->raw_drawPoint(this->batch_pos[i], color(i));
+			else
+				this->raw_drawBigPoint(this->batch_pos[i], color(i));
+		}
+		return;
+	}
+
+	if (mode == TRIANGLES)
+	{
+		for (unsigned int k = 0 ; k < primitives*3 ; k += 3)
+		{
+			const unsigned int a = index(k), b = index(k+1), c = index(k+2);
+			if (this->batch_clip[a] == 2 || this->batch_clip[b] == 2 || this->batch_clip[c] == 2)
+			{
+				PROFILE_COUNT(primitives_culled, 1);
+				continue;
+			}
+			this->raw_fillShadedTriangle(this->batch_pos[a], this->batch_pos[b],
+								this->batch_pos[c], color(a), color(b), color(c));
+		}
+		return;
+	}
+
+	const unsigned int step = (mode == LINES) ? 2 : 1;
+	for (unsigned int k = 0 ; k < primitives ; k++)
+	{
+		const unsigned int i = index(k * step);
+		const unsigned int j = index((k * step + 1 < count) ? k * step + 1 : 0); // closes the loop
+		if (this->batch_clip[i] == 2 || this->batch_clip[j] == 2)
+		{
+			PROFILE_COUNT(primitives_culled, 1);
+			continue;
+		}
+		std::pair<int,int> rp1 = this->batch_pos[i], rp2 = this->batch_pos[j];
+		this->raw_drawShadedLine(rp1, rp2, color(i), color(j));
+	}
+}
+
+int RendererProgram::uploadVertices(unsigned int id, std::vector<Vector4f>& vertices,
+									std::vector<unsigned int>& colors)
+{
+	if (id == 0 || (!colors.empty() && colors.size() != vertices.size())) return 1;
+	VertexBuffer& buffer = this->buffers[id];
+	buffer.vertices.swap(vertices);
+	buffer.colors.swap(colors);
+	buffer.bounds = Bounds::box(buffer.vertices.data(), buffer.vertices.size());
+	return 0;
+}
+
+int RendererProgram::drawBuffer(unsigned int id, RendererDrawMode mode,
+								unsigned int first, unsigned int count)
+{
+	auto it = this->buffers.find(id);
+	if (it == this->buffers.end()) return 1;
+	const VertexBuffer& buffer = it->second;
+	if (first > buffer.vertices.size() || count > buffer.vertices.size() - first)
+		return 1;
+	// the bounds of the whole buffer also contain any range of it
+	return this->drawArrays(mode, buffer.vertices.data() + first, count, buffer.bounds,
+							buffer.colors.empty() ? nullptr : buffer.colors.data() + first);
+}
+
+int RendererProgram::drawBufferElements(unsigned int id, RendererDrawMode mode,
+										const unsigned int* indices, unsigned int count)
+{
+	auto it = this->buffers.find(id);
+	if (it == this->buffers.end()) return 1;
+	const VertexBuffer& buffer = it->second;
+	return this->drawElements(mode, buffer.vertices.data(), buffer.vertices.size(),
+								indices, count, buffer.bounds,
+								buffer.colors.empty() ? nullptr : buffer.colors.data());
+}
+
+int RendererProgram::deleteBuffer(unsigned int id)
+{
+	return (this->buffers.erase(id) > 0) ? 0 : 1;
+}
+
+int RendererProgram::setViewportSlot(unsigned int index, const Region2i& region,
+									const Mat4x4f& proj, const Mat4x4f& modelview)
+{
+	if (index >= MAX_VIEWPORT_SLOTS) return 1;
+	if (index >= this->viewport_slots.size())
+		this->viewport_slots.resize(index + 1,
+				ViewportSlot{ this->viewport, Mat4x4f::IDENTITY, Mat4x4f::IDENTITY });
+	this->viewport_slots[index] = ViewportSlot{ region, proj, modelview };
+	return 0;
+}
+
+int RendererProgram::drawViewports(const ViewportDraw* draws, unsigned int count,
+									unsigned int threads)
+{
+	DERPLOTTER_TRACE_SCOPE("drawViewports");
+	// validate all draws first, resolving their buffers
+	std::vector<const VertexBuffer*> sources(count);
+	for (unsigned int k = 0 ; k < count ; k++)
+	{
+		const ViewportDraw& draw = draws[k];
+		unsigned int primitives;
+		auto it = this->buffers.find(draw.buffer);
+		if (draw.viewport >= this->viewport_slots.size() || it == this->buffers.end()
+			|| !primitiveCount(draw.mode, draw.count, primitives))
+			return 1;
+		const VertexBuffer& buffer = it->second;
+		if (draw.first > buffer.vertices.size() || draw.count > buffer.vertices.size() - draw.first)
+			return 1;
+		sources[k] = &buffer;
+	}
+
+	// group the draws by viewport, keeping their order within each one
+	std::vector<unsigned int> order(count);
+	for (unsigned int k = 0 ; k < count ; k++) order[k] = k;
+	std::stable_sort(order.begin(), order.end(), [draws](unsigned int a, unsigned int b) {
+		return draws[a].viewport < draws[b].viewport; });
+	std::vector<unsigned int> groups; // the start of each group in the order
+	for (unsigned int k = 0 ; k < count ; k++)
+		if (k == 0 || draws[order[k]].viewport != draws[order[k-1]].viewport)
+			groups.push_back(k);
+
+	// the draws into overlapping viewports are made in the given order instead,
+	// so that later ones stay on top
+	const Region2i bounds(p_buffer->getWidth(), p_buffer->getHeight());
+	bool disjoint = true;
+	for (size_t g = 0 ; g < groups.size() && disjoint ; g++)
+	{
+		Region2i r = this->viewport_slots[draws[order[groups[g]]].viewport].region;
+		r.intersect(bounds);
+		for (size_t h = g + 1 ; h < groups.size() && disjoint ; h++)
+			disjoint = !r.intersects(this->viewport_slots[draws[order[groups[h]]].viewport].region);
+	}
+
+	// handing a few vertices over to another thread costs more than drawing them
+	unsigned long long vertices = 0;
+	for (unsigned int k = 0 ; k < count ; k++)
+		vertices += draws[k].count;
+	// nor do more threads than the hardware runs at once
+	const unsigned int hardware = std::thread::hardware_concurrency();
+	if (threads == 0 || (hardware > 0 && threads > hardware)) threads = hardware;
+	if (threads > groups.size()) threads = groups.size();
+	if (threads > vertices / VIEWPORTS_MIN_THREAD_VERTICES)
+		threads = vertices / VIEWPORTS_MIN_THREAD_VERTICES;
+	if (!disjoint || threads <= 1)
+	{
+		for (unsigned int k = 0 ; k < count ; k++)
+		{
+			const unsigned int i = disjoint ? order[k] : k;
+			this->drawInSlot(this->viewport_slots[draws[i].viewport], *sources[i], draws[i]);
+		}
+		return 0;
+	}
+
+	// each thread takes the next viewport left, drawing with its own program;
+	// the viewports are clipped to disjoint regions, so they never write the same pixel
+	std::atomic<unsigned int> next(0);
+	groups.push_back(count);
+	auto work = [&](RendererProgram& prg) {
+		DERPLOTTER_TRACE_SCOPE("viewports");
+		for (unsigned int g = next++ ; g + 1 < groups.size() ; g = next++)
+			for (unsigned int k = groups[g] ; k < groups[g+1] ; k++)
+			{
+				const unsigned int i = order[k];
+				prg.drawInSlot(this->viewport_slots[draws[i].viewport], *sources[i], draws[i]);
+			}
+	};
+	while (this->workers.size() < threads - 1)
+		this->workers.emplace_back(new RendererProgram(*this->p_buffer));
+	for (unsigned int t = 0 ; t < threads - 1 ; t++)
+	{
+		RendererProgram& worker = *this->workers[t];
+		worker.p_buffer = this->p_buffer;
+		worker.setBlendMode(this->blend_mode);
+		worker.front_color = this->front_color;
+		worker.clip = this->clip;
+	}
+	this->workerPool().run(threads, [&](unsigned int t) {
+		work((t < threads - 1) ? *this->workers[t] : *this);
+	});
+
+	// gather what the workers have drawn
+	for (unsigned int t = 0 ; t < threads - 1 ; t++)
+	{
+		RendererProgram& worker = *this->workers[t];
+		for (const Region2i& r : worker.drawn)
+			this->markDrawn(r);
+		worker.dirty.clear();
+		worker.drawn.clear();
+		this->pixels_written += worker.pixels_written;
+		this->primitives_culled += worker.primitives_culled;
+		worker.pixels_written = worker.primitives_culled = 0;
+	}
+	return 0;
+}
+
+WorkerPool& RendererProgram::workerPool(void)
+{
+	if (!this->pool) this->pool.reset(new WorkerPool());
+	return *this->pool;
+}
+
+void RendererProgram::drawInSlot(const ViewportSlot& slot, const VertexBuffer& buffer,
+								const ViewportDraw& draw)
+{
+	const Region2i viewport = this->viewport, clip = this->clip;
+	const Mat4x4f proj = this->proj, modelview = this->modelview;
+	this->viewport = slot.region;
+	this->clip.intersect(slot.region);
+	this->proj = slot.proj;
+	this->modelview = slot.modelview;
+	// the bounds of the whole buffer also contain any range of it
+	this->drawArrays(draw.mode, buffer.vertices.data() + draw.first, draw.count, buffer.bounds,
+					buffer.colors.empty() ? nullptr : buffer.colors.data() + draw.first);
+	this->viewport = viewport;
+	this->clip = clip;
+	this->proj = proj;
+	this->modelview = modelview;
+}
+
+int RendererProgram::pushMatrix(int matrix)
+{
+	if (matrix == 1)
+		return this->proj_stack.push(this->proj) ? 0 : 1;
+	return this->modelview_stack.push(this->modelview) ? 0 : 1;
+}
+
+int RendererProgram::popMatrix(int matrix)
+{
+	if (matrix == 1)
+		return this->proj_stack.pop(this->proj) ? 0 : 1;
+	return this->modelview_stack.pop(this->modelview) ? 0 : 1;
+}
+
+int RendererProgram::setSupersampling(int factor)
+{
+	if ((factor != 1 && factor != 2 && factor != 4) || this->target != 0
+		|| (factor > 1 && p_display->getFormat() == PIXEL_INDEXED8))
+		return 1;
+	const int previous = this->supersampling;
+	if (factor == previous) return 0;
+	this->resolve();
+
+	const int width = p_display->getWidth(), height = p_display->getHeight();
+	if (factor > 1)
+	{
+		// the samples start as copies of the pixels of the display
+		DisplayBuffer buffer(width * factor, height * factor, nullptr, 0, PIXEL_ARGB8888);
+		if (!buffer) return 1;
+		std::vector<unsigned int> scratch(width);
+		for (int y = 0 ; y < height ; y++)
+		{
+			const unsigned int* pixels = p_display->readRow(y, scratch.data());
+			for (int sy = y * factor ; sy < (y + 1) * factor ; sy++)
+			{
+				unsigned int* s = (unsigned int*)(buffer.pixels() + (long long)buffer.getPitch()*sy);
+				for (int x = 0 ; x < width * factor ; x++)
+					s[x] = pixels[x / factor];
+			}
+		}
+		this->samples = std::move(buffer);
+	}
+	else
+		this->samples = DisplayBuffer();
+	this->supersampling = factor;
+	this->p_buffer = this->displayTarget();
+	this->kernels = &rasterKernels(p_buffer->getFormat(), this->blend_mode);
+
+	// the state in display coordinates follows the new resolution
+	this->viewport = scaleRegion(this->viewport, factor, previous);
+	this->clip = scaleRegion(this->clip, factor, previous);
+	this->clip.intersect(Region2i(p_buffer->getWidth(), p_buffer->getHeight()));
+	for (ViewportSlot& slot : this->viewport_slots)
+		slot.region = scaleRegion(slot.region, factor, previous);
+	for (Region2i& r : this->drawn)
+		r = scaleRegion(r, factor, previous);
+	return 0;
+}
+
+int RendererProgram::getSupersampling(void) const
+{
+	return this->supersampling;
+}
+
+int RendererProgram::resolve(unsigned int threads)
+{
+	if (this->supersampling == 1 || this->unresolved.empty()) return 0;
+	DERPLOTTER_TRACE_SCOPE("resolve");
+	const int factor = this->supersampling;
+	const RasterKernels* out = &rasterKernels(p_display->getFormat(), BLEND_REPLACE);
+	const auto band = (factor == 2) ? resolveBand<2> : resolveBand<4>;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	// regions are resolved one after the other, since their pixels may overlap
+	for (const Region2i& r : this->unresolved)
+	{
+		Region2i pixels = scaleRegion(r, 1, factor);
+		pixels.intersect(Region2i(p_display->getWidth(), p_display->getHeight()));
+		if (pixels.isEmpty()) continue;
+		const int x0 = pixels.getMinX(), x1 = pixels.getMaxX();
+		const int y0 = pixels.getMinY(), rows = pixels.getMaxY() - y0;
+		int nbands = rows / RESOLVE_MIN_BAND_ROWS;
+		if (nbands > (int)threads) nbands = threads;
+		if (nbands < 1) nbands = 1;
+
+		// the calling thread resolves the last band itself
+		auto resolveRows = [&](unsigned int i) {
+			band(&this->samples, p_display, out, x0, x1,
+					y0 + (int)((long long)rows * i / nbands),
+					y0 + (int)((long long)rows * (i+1) / nbands));
+		};
+		if (nbands == 1)
+			resolveRows(0);
+		else
+			this->workerPool().run(nbands, resolveRows);
+		addRegion(this->dirty, pixels);
+	}
+	this->unresolved.clear();
+	return 0;
+}
+
+int RendererProgram::createFont(unsigned int id, Font&& font)
+{
+	if (id == 0 || !font) return 1;
+	this->fonts[id] = std::move(font);
+	return 0;
+}
+
+int RendererProgram::deleteFont(unsigned int id)
+{
+	return (this->fonts.erase(id) > 0) ? 0 : 1;
+}
+
+const Font* RendererProgram::findFont(unsigned int id) const
+{
+	if (id == 0) return &Font::builtin();
+	auto it = this->fonts.find(id);
+	return (it != this->fonts.end()) ? &it->second : nullptr;
+}
+
+int RendererProgram::raw_drawText(unsigned int font, const std::pair<int,int>& p,
+								const char* text, unsigned int color)
+{
+	const Font* f = this->findFont(font);
+	if (f == nullptr) return 1;
+	this->drawGlyphs(*f, p.first, p.second, text, color);
+	return 0;
+}
+
+int RendererProgram::drawText(unsigned int font, const TextLabel* labels, unsigned int count,
+							const unsigned int* colors)
+{
+	DERPLOTTER_TRACE_SCOPE("drawText");
+	const Font* f = this->findFont(font);
+	if (f == nullptr) return 1;
+	const Mat4x4f mvp = this->proj * this->modelview;
+	const int scale = (this->target == 0) ? this->supersampling : 1;
+	for (unsigned int i = 0 ; i < count ; i++)
+	{
+		Vector4f p = labels[i].position;
+		math::multiply(p, mvp);
+		std::pair<int,int> rp;
+		if (this->projectPoint(p, rp) == 2 || p.w() == 0)
+		{
+			PROFILE_COUNT(primitives_culled, 1);
+			continue;
+		}
+		this->drawGlyphs(*f, rp.first + labels[i].dx * scale, rp.second + labels[i].dy * scale,
+						labels[i].text, colors ? colors[i] : this->front_color);
+	}
+	return 0;
+}
+
+void RendererProgram::drawGlyphs(const Font& font, int x, int y, const char* text,
+								unsigned int color)
+{
+	// each pixel of a glyph covers as many samples as a pixel of the display
+	const int scale = (this->target == 0) ? this->supersampling : 1;
+	const int cell_width = font.getCellWidth() * scale, cell_height = font.getCellHeight() * scale;
+	int width, height;
+	font.measure(text, width, height);
+	Region2i box(x, x + width * scale, y, y + height * scale);
+	box.intersect(this->clip);
+	if (box.isEmpty())
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return;
+	}
+	this->markDrawn(box);
+
+	// partial coverage is composed over the buffer, unless it holds palette indices
+	const bool indexed = p_buffer->getFormat() == PIXEL_INDEXED8;
+	const RasterKernels* blended = (this->blend_mode == BLEND_REPLACE)
+			? &rasterKernels(p_buffer->getFormat(), BLEND_ALPHA) : this->kernels;
+	const unsigned int alpha = color >> 24;
+	const RasterKernels* k = this->kernels;
+	unsigned int coverage = 255, span_color = color; // for the last coverage seen
+	bool visible = true;
+	auto cover = [&](unsigned int c) {
+		coverage = c;
+		if (indexed)
+		{
+			visible = c >= 128;
+			return;
+		}
+		const unsigned int a = (alpha * c + 127) / 255;
+		k = (a == 255) ? this->kernels : blended;
+		span_color = (color & 0x00FFFFFF) | a << 24;
+	};
+	cover(255);
+
+	const int min_x = box.getMinX(), max_x = box.getMaxX();
+	const int min_y = box.getMinY(), max_y = box.getMaxY();
+	const int pitch = p_buffer->getPitch();
+	unsigned char* pixels = p_buffer->pixels();
+	int pen_x = x, pen_y = y;
+	for (const char* c = text ; *c != '\0' ; c++)
+	{
+		if (*c == '\n')
+		{
+			pen_x = x;
+			pen_y += cell_height;
+			continue;
+		}
+		const int gx = pen_x, gy = pen_y;
+		pen_x += cell_width;
+		const GlyphSpan* begin;
+		const GlyphSpan* end;
+		if (gx >= max_x || gy >= max_y || gx + cell_width <= min_x || gy + cell_height <= min_y
+			|| !font.glyph((unsigned char)*c, begin, end))
+			continue;
+
+		// spans are only clipped for glyphs crossing the edges of the box
+		const bool inside = gx >= min_x && gy >= min_y
+				&& gx + cell_width <= max_x && gy + cell_height <= max_y;
+		for (const GlyphSpan* s = begin ; s != end ; s++)
+		{
+			if (s->coverage != coverage) cover(s->coverage);
+			if (!visible) continue;
+			int x0 = gx + s->x * scale, x1 = x0 + s->length * scale;
+			int y0 = gy + s->y * scale, y1 = y0 + scale;
+			if (!inside)
+			{
+				x0 = std::max(x0, min_x);
+				x1 = std::min(x1, max_x);
+				y0 = std::max(y0, min_y);
+				y1 = std::min(y1, max_y);
+				if (x0 >= x1 || y0 >= y1) continue;
+			}
+			unsigned char* row = pixels + (long long)pitch*y0;
+			for (int r = y0 ; r < y1 ; r++, row += pitch)
+				k->span(row, x0, x1 - x0, span_color);
+			PROFILE_COUNT(pixels_written, (x1 - x0) * (y1 - y0));
+		}
+	}
+}
+
+int RendererProgram::drawGrid(float x_min, float x_max, float y_min, float y_max,
+							float x_step, float y_step)
+{
+	DERPLOTTER_TRACE_SCOPE("drawGrid");
+	long long first_x = 0, first_y = 0;
+	unsigned int columns, rows;
+	if (!plotSteps(x_min, x_max, x_step, first_x, columns)
+		|| !plotSteps(y_min, y_max, y_step, first_y, rows))
+		return 1;
+
+	// the ends of every line are transformed first, into the current batch
+	const Mat4x4f mvp = this->proj * this->modelview;
+	this->batch_pos.clear();
+	std::pair<int,int> p1, p2;
+	for (unsigned int i = 0 ; i < columns ; i++)
+	{
+		const float x = (first_x + i) * x_step;
+		if (!plotPoint(x, y_min, mvp, p1) || !plotPoint(x, y_max, mvp, p2))
+		{
+			PROFILE_COUNT(primitives_culled, 1);
+			continue;
+		}
+		this->batch_pos.push_back(p1);
+		this->batch_pos.push_back(p2);
+	}
+	for (unsigned int i = 0 ; i < rows ; i++)
+	{
+		const float y = (first_y + i) * y_step;
+		if (!plotPoint(x_min, y, mvp, p1) || !plotPoint(x_max, y, mvp, p2))
+		{
+			PROFILE_COUNT(primitives_culled, 1);
+			continue;
+		}
+		this->batch_pos.push_back(p1);
+		this->batch_pos.push_back(p2);
+	}
+	this->drawPlotLines(this->front_color);
+	return 0;
+}
+
+int RendererProgram::drawAxis(int axis, float from, float to, float at, float step,
+							int tick_length)
+{
+	DERPLOTTER_TRACE_SCOPE("drawAxis");
+	long long first = 0;
+	unsigned int ticks;
+	if ((axis != 0 && axis != 1) || !plotSteps(from, to, step, first, ticks)) return 1;
+	if (tick_length == 0) ticks = 0;
+
+	const Mat4x4f mvp = this->proj * this->modelview;
+	auto point = [&](float v, std::pair<int,int>& rp) {
+		return (axis == 0) ? plotPoint(v, at, mvp, rp) : plotPoint(at, v, mvp, rp); };
+	std::pair<int,int> p1, p2;
+	if (!point(from, p1) || !point(to, p2))
+	{
+		PROFILE_COUNT(primitives_culled, 1 + ticks);
+		return 0;
+	}
+	this->batch_pos.clear();
+	this->batch_pos.push_back(p1);
+	this->batch_pos.push_back(p2);
+
+	// the ticks are perpendicular to the axis in the buffer, towards the bottom-left
+	double nx = p1.second - p2.second, ny = p2.first - p1.first;
+	if (nx == 0 && ny == 0)
+	{
+		nx = (axis == 0) ? 0 : -1;
+		ny = (axis == 0) ? 1 : 0;
+	}
+	if (ny - nx < 0 || (ny - nx == 0 && ny < 0))
+	{
+		nx = -nx;
+		ny = -ny;
+	}
+	const double scale = tick_length / sqrt(nx*nx + ny*ny);
+	const int tx = (int)lround(nx * scale), ty = (int)lround(ny * scale);
+	for (unsigned int i = 0 ; i < ticks ; i++)
+	{
+		std::pair<int,int> p;
+		if (!point((first + i) * step, p))
+		{
+			PROFILE_COUNT(primitives_culled, 1);
+			continue;
+		}
+		this->batch_pos.push_back(p);
+		this->batch_pos.push_back(std::make_pair(p.first + tx, p.second + ty));
+	}
+	this->drawPlotLines(this->front_color);
+	return 0;
+}
+
+bool RendererProgram::plotSteps(float from, float to, float step, long long& first,
+								unsigned int& count)
+{
+	count = 0;
+	if (step == 0) return true;
+	if (!(step > 0) || !isfinite(from) || !isfinite(to)) return false;
+	if (from > to) std::swap(from, to);
+	// with some tolerance, so that rounding errors do not drop the last multiple
+	const double a = ceil((double)from / step - 1e-6), b = floor((double)to / step + 1e-6);
+	if (b < a) return true;
+	if (b - a + 1 > MAX_PLOT_LINES) return false;
+	first = (long long)a;
+	count = (unsigned int)(b - a + 1);
+	return true;
+}
+
+bool RendererProgram::plotPoint(float x, float y, const Mat4x4f& mvp,
+								std::pair<int,int>& rp) const
+{
+	Vector4f p(x, y, 0, 1);
+	math::multiply(p, mvp);
+	return this->projectPoint(p, rp) != 2 && p.w() != 0;
+}
+
+void RendererProgram::drawPlotLines(unsigned int color)
+{
+	const std::vector<std::pair<int,int>>& pos = this->batch_pos;
+	if (pos.empty()) return;
+
+	// all lines are marked at once, with the same margin as other lines
+	int min_x = pos[0].first, max_x = min_x, min_y = pos[0].second, max_y = min_y;
+	for (const std::pair<int,int>& p : pos)
+	{
+		min_x = std::min(min_x, p.first);
+		max_x = std::max(max_x, p.first);
+		min_y = std::min(min_y, p.second);
+		max_y = std::max(max_y, p.second);
+	}
+	this->markDrawn(Region2i(min_x - 1, max_x + 2, min_y - 1, max_y + 2));
+
+	const int pitch = p_buffer->getPitch();
+	unsigned char* pixels = p_buffer->pixels();
+	std::vector<std::array<int,3>> columns; // first row, last row and column
+	for (size_t i = 0 ; i + 1 < pos.size() ; i += 2)
+	{
+		std::pair<int,int> p1 = pos[i], p2 = pos[i+1];
+		if (p1.second == p2.second) // a row
+		{
+			const int y = p1.second;
+			const int x0 = std::max(std::min(p1.first, p2.first), clip.getMinX());
+			const int x1 = std::min(std::max(p1.first, p2.first), clip.getMaxX()-1);
+			if (y < clip.getMinY() || y >= clip.getMaxY() || x0 > x1)
+			{
+				PROFILE_COUNT(primitives_culled, 1);
+				continue;
+			}
+			kernels->span(pixels + (long long)pitch*y, x0, x1-x0+1, color);
+			PROFILE_COUNT(pixels_written, x1-x0+1);
+		}
+		else if (p1.first == p2.first) // a column
+		{
+			const int x = p1.first;
+			const int y0 = std::max(std::min(p1.second, p2.second), clip.getMinY());
+			const int y1 = std::min(std::max(p1.second, p2.second), clip.getMaxY()-1);
+			if (x < clip.getMinX() || x >= clip.getMaxX() || y0 > y1)
+			{
+				PROFILE_COUNT(primitives_culled, 1);
+				continue;
+			}
+			columns.push_back({ y0, y1, x });
+		}
+		else
+			this->raw_drawShadedLine(p1, p2, color, color);
+	}
+
+	// columns over the same rows (as in a grid) are written together, row by row
+	std::sort(columns.begin(), columns.end());
+	std::vector<int> xs;
+	for (size_t i = 0 ; i < columns.size() ; )
+	{
+		xs.clear();
+		size_t end = i;
+		for ( ; end < columns.size() && columns[end][0] == columns[i][0]
+				&& columns[end][1] == columns[i][1] ; end++)
+			xs.push_back(columns[end][2]);
+		const int y0 = columns[i][0], y1 = columns[i][1];
+		if (xs.size() == 1)
+			kernels->column(pixels, pitch, xs[0], y0, y1-y0+1, color);
+		else
+			kernels->columns(pixels, pitch, xs.data(), xs.size(), y0, y1-y0+1, color);
+		PROFILE_COUNT(pixels_written, (unsigned long long)xs.size() * (y1-y0+1));
+		i = end;
+	}
+}
+
+int RendererProgram::setScissor(const Region2i& region)
+{
+	this->clip = region;
+	this->clip.intersect(Region2i(p_buffer->getWidth(), p_buffer->getHeight()));
+	return 0;
+}
+
+int RendererProgram::disableScissor(void)
+{
+	this->clip = Region2i(p_buffer->getWidth(), p_buffer->getHeight());
+	return 0;
+}
+
+int RendererProgram::createTarget(unsigned int id, int width, int height)
+{
+	if (id == 0 || id == this->target || width <= 0 || height <= 0) return 1;
+	DisplayBuffer buffer(width, height, nullptr, 0, p_display->getFormat());
+	if (!buffer) return 1;
+	RenderTarget& t = this->targets[id];
+	t.buffer = std::move(buffer);
+	t.state.drawn.clear();
+	t.state.viewport = t.state.clip = Region2i(width, height);
+	return 0;
+}
+
+int RendererProgram::setRenderTarget(unsigned int id)
+{
+	auto it = this->targets.find(id);
+	if (id != 0 && it == this->targets.end()) return 1;
+
+	// keep the state of the current target, and take the state of the new one
+	TargetState& current = (this->target == 0) ? this->display_state
+							: this->targets[this->target].state;
+	current.drawn.swap(this->drawn);
+	current.viewport = this->viewport;
+	current.clip = this->clip;
+	TargetState& next = (id == 0) ? this->display_state : it->second.state;
+	next.drawn.swap(this->drawn);
+	this->viewport = next.viewport;
+	this->clip = next.clip;
+	this->p_buffer = (id == 0) ? this->displayTarget() : &it->second.buffer;
+	this->kernels = &rasterKernels(p_buffer->getFormat(), this->blend_mode);
+	this->target = id;
+	return 0;
+}
+
+int RendererProgram::deleteTarget(unsigned int id)
+{
+	if (id == 0 || this->targets.find(id) == this->targets.end()) return 1;
+	if (id == this->target)
+		this->setRenderTarget(0);
+	this->targets.erase(id);
+	return 0;
+}
+
+int RendererProgram::blit(unsigned int source, const Region2i& src_region,
+						const Region2i& dst_region, BlitFilter filter)
+{
+	DERPLOTTER_TRACE_SCOPE("blit");
+	const DisplayBuffer* src = this->displayTarget();
+	if (source != 0)
+	{
+		auto it = this->targets.find(source);
+		if (it == this->targets.end()) return 1;
+		src = &it->second.buffer;
+	}
+	if (source == this->target || filter > BLIT_BILINEAR
+		|| src_region.isEmpty() || dst_region.isEmpty()
+		|| !src_region.fitsIn(src->getWidth(), src->getHeight()))
+		return 1;
+
+	Region2i dst = dst_region;
+	dst.intersect(this->clip);
+	if (dst.isEmpty())
+	{
+		PROFILE_COUNT(primitives_culled, 1);
+		return 0;
+	}
+	this->markDrawn(dst);
+	PROFILE_COUNT(pixels_written, dst.area());
+
+	const int sx0 = src_region.getMinX(), sw = src_region.getMaxX() - sx0;
+	const int sy0 = src_region.getMinY(), sh = src_region.getMaxY() - sy0;
+	const int dx0 = dst_region.getMinX(), dw = dst_region.getMaxX() - dx0;
+	const int dy0 = dst_region.getMinY(), dh = dst_region.getMaxY() - dy0;
+	const int x0 = dst.getMinX(), length = dst.getMaxX() - x0;
+	const int pitch = p_buffer->getPitch();
+	unsigned char* row = p_buffer->pixels() + (long long)pitch*dst.getMinY();
+
+	// regions of the same size are copied row by row when nothing is blended
+	const PixelFormat format = p_buffer->getFormat();
+	const bool indices = format == PIXEL_INDEXED8 && src->getFormat() == PIXEL_INDEXED8;
+	if (sw == dw && sh == dh && src->getFormat() == format
+		&& (this->blend_mode == BLEND_REPLACE || indices))
+	{
+		const int bpp = bytesPerPixel(format);
+		const unsigned char* from = (const unsigned char*)src->data()
+				+ (long long)src->getPitch()*(sy0 + dst.getMinY() - dy0) + (long long)(sx0 + x0 - dx0)*bpp;
+		for (int y = dst.getMinY() ; y < dst.getMaxY() ; y++, row += pitch, from += src->getPitch())
+			std::copy(from, from + (long long)length*bpp, row + (long long)x0*bpp);
+		return 0;
+	}
+
+	// palette indices are read as they are, as gray colors which pack to the same index
+	std::vector<unsigned int> scratch(src->getWidth());
+	auto readRow = [&](int y) -> const unsigned int* {
+		if (!indices)
+			return src->readRow(y, scratch.data());
+		const unsigned char* p = (const unsigned char*)src->data() + (long long)src->getPitch()*y;
+		for (int x = sx0 ; x < sx0 + sw ; x++)
+			scratch[x] = 0xFF000000 | p[x] * 0x010101u;
+		return scratch.data();
+	};
+	if (indices) filter = BLIT_NEAREST;
+
+	// the source columns and weights of each destination column are found once;
+	// bilinear samples are clamped to the source region
+	std::vector<int> cols0(length), cols1(length);
+	std::vector<unsigned int> weights(length);
+	for (int i = 0 ; i < length ; i++)
+	{
+		const long long u = sourcePosition(x0 + i, dx0, dw, sx0, sw);
+		if (filter == BLIT_NEAREST)
+		{
+			cols0[i] = (int)(u >> 16);
+			continue;
+		}
+		const long long c = u - 0x8000;
+		const int c0 = (int)(c >> 16);
+		cols0[i] = std::max(c0, sx0);
+		cols1[i] = std::min(c0 + 1, sx0 + sw - 1);
+		weights[i] = (unsigned int)((c >> 8) & 0xFF);
+	}
+
+	// the source rows are filtered horizontally once, for all lines between them
+	std::vector<unsigned int> line(length), upper(length), lower(length);
+	int upper_row = 0, lower_row = 0;
+	bool has_upper = false, has_lower = false;
+	auto filterRow = [&](int r, std::vector<unsigned int>& out) {
+		const unsigned int* s = readRow(r);
+		for (int i = 0 ; i < length ; i++)
+			out[i] = lerpColor(s[cols0[i]], s[cols1[i]], weights[i]);
+	};
+	for (int y = dst.getMinY() ; y < dst.getMaxY() ; y++, row += pitch)
+	{
+		const long long v = sourcePosition(y, dy0, dh, sy0, sh);
+		if (filter == BLIT_NEAREST)
+		{
+			const int r = (int)(v >> 16);
+			if (!has_upper || r != upper_row)
+			{
+				const unsigned int* s = readRow(r);
+				for (int i = 0 ; i < length ; i++)
+					line[i] = s[cols0[i]];
+				upper_row = r;
+				has_upper = true;
+			}
+		}
+		else
+		{
+			const long long c = v - 0x8000;
+			const int r0 = std::max((int)(c >> 16), sy0);
+			const int r1 = std::min((int)(c >> 16) + 1, sy0 + sh - 1);
+			const unsigned int f = (unsigned int)((c >> 8) & 0xFF);
+			if (!has_upper || r0 != upper_row)
+			{
+				if (has_lower && r0 == lower_row)
+				{
+					upper.swap(lower);
+					has_lower = false;
+				}
+				else
+					filterRow(r0, upper);
+				upper_row = r0;
+				has_upper = true;
+			}
+			if (!has_lower || r1 != lower_row)
+			{
+				filterRow(r1, lower);
+				lower_row = r1;
+				has_lower = true;
+			}
+			for (int i = 0 ; i < length ; i++)
+				line[i] = lerpColor(upper[i], lower[i], f);
+		}
+		kernels->colorSpan(row, x0, length, line.data());
+	}
+	return 0;
+}
+
+int RendererProgram::setPalette(const unsigned int* colors, int count)
+{
+	this->p_buffer->setPalette(colors, count);
+	return 0;
+}
+
+int RendererProgram::setBlendMode(BlendMode mode)
+{
+	if (mode >= BLEND_MODE_COUNT) return 1;
+	this->blend_mode = mode;
+	this->kernels = &rasterKernels(p_buffer->getFormat(), mode);
+	return 0;
+}
+
+int RendererProgram::saveImage(const char* path, ImageFormat format, PngFilter filter)
+{
+	DERPLOTTER_TRACE_SCOPE("saveImage");
+	if (this->target != 0)
+		return image::save(*this->p_buffer, path, format, filter, 0, &this->workerPool()) ? 0 : 1;
+	this->resolve();
+	return image::save(*this->p_display, path, format, filter, 0, &this->workerPool()) ? 0 : 1;
+}
+
+const std::vector<Region2i>& RendererProgram::dirtyRegions(void) const
+{
+	return this->dirty;
+}
+
+void RendererProgram::resetDirtyRegions(void)
+{
+	this->dirty.clear();
+}
+
+void RendererProgram::markDirty(const Region2i& region)
+{
+	Region2i r = region;
+	r.intersect(Region2i(p_buffer->getWidth(), p_buffer->getHeight()));
+	if (r.isEmpty() || this->target != 0) return;
+	addRegion(this->changed(), r);
+}
+
+void RendererProgram::markDrawn(const Region2i& region)
+{
+	Region2i r = region;
+	r.intersect(this->clip);
+	if (r.isEmpty()) return;
+	if (this->target == 0)
+		addRegion(this->changed(), r);
+	addRegion(this->drawn, r);
+}
+
+void RendererProgram::addRegion(std::vector<Region2i>& list, Region2i region)
+{
+	for (const Region2i& r : list)
+		if (region.fitsIn(r)) return; // already covered
+
+	// merge with every region it overlaps or is adjacent to
+	for (size_t i = 0 ; i < list.size() ; )
+	{
+		if (list[i].touches(region))
+		{
+			region.unite(list[i]);
+			list[i] = list.back();
+			list.pop_back();
+			i = 0;
+		}
+		else i++;
+	}
+
+	if (list.size() >= MAX_DIRTY_REGIONS)
+	{
+		for (const Region2i& r : list)
+			region.unite(r);
+		list.clear();
+	}
+	list.push_back(region);
+}
+
+bool RendererProgram::clipLine(int& t0, int& t1, long long v0, long long slope, int lo, int hi)
+{
+	const long long low = (long long)lo * 65536, limit = (long long)hi * 65536;
+	if (t0 > t1) return false;
+	if (slope != 0)
+	{
+		// estimate where the line enters and leaves the clip region
+		long long ta = (low - v0) / slope, tb = (limit - v0) / slope;
+		if (ta > tb) std::swap(ta, tb);
+		if (ta - 1 > t0) t0 = (ta - 1 > t1) ? t1 : (int)(ta - 1);
+		if (tb + 1 < t1) t1 = (tb + 1 < t0) ? t0 : (int)(tb + 1);
+	}
+	// refine it with the exact same arithmetic used by the kernels
+	while (t0 <= t1 && (v0 + t0*slope < low || v0 + t0*slope >= limit)) t0++;
+	while (t1 >= t0 && (v0 + t1*slope < low || v0 + t1*slope >= limit)) t1--;
+	return t0 <= t1;
+}
+
 int RendererProgram::transformPoint(Vector4f& p, std::pair<int,int>& rp)
 {
 	// modelview transformation
@@ -154,6 +1470,11 @@ int RendererProgram::transformPoint(Vector4f& p, std::pair<int,int>& rp)
 	// projection transformation
 	math::multiply(p, this->proj);
 
+	return this->projectPoint(p, rp);
+}
+
+int RendererProgram::projectPoint(Vector4f& p, std::pair<int,int>& rp) const
+{
 	// normalization transformation
 	if (p.w() == 0) return 1;
 	p.normalize();
@@ -8,8 +8,17 @@
 
 #include "DisplayBuffer.h"
 #include "Mat4x4f.h"
+#include "MatrixStack.h"
+#include "Bounds.h"
 #include "Vector4f.h"
 #include "Region2i.h"
+#include "ImageExport.h"
+#include "RasterKernels.h"
+#include "Font.h"
+#include "WorkerPool.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
 
 namespace derplot
 {
@@ -21,19 +30,102 @@ enum RendererDrawMode : unsigned char
 	BIG_POINTS = 0x02,
 	LINES      = 0x04,
 	LINE_STRIP = 0x05,
-	LINE_LOOP  = 0x06
+	LINE_LOOP  = 0x06,
+	TRIANGLES  = 0x08
+};
+
+enum BlitFilter : unsigned char
+{
+	BLIT_NEAREST  = 0x00, ///< each pixel takes the color of the nearest source pixel
+	BLIT_BILINEAR = 0x01  ///< each pixel interpolates the four nearest source pixels
+};
+
+/** \brief A draw of a range of a vertex buffer into one viewport of the viewport array */
+struct ViewportDraw
+{
+	unsigned int viewport; ///< the index of the viewport
+	unsigned int buffer;   ///< the handle of the vertex buffer
+	RendererDrawMode mode; ///< the kind of primitives
+	unsigned int first;    ///< the first vertex of the range
+	unsigned int count;    ///< the number of vertices of the range
+};
+
+/** \brief A text placed at a point, drawn by \c RendererProgram::drawText() */
+struct TextLabel
+{
+	math::Vector4f position; ///< the point the text is placed at
+	const char* text;        ///< the null-terminated text, with lines separated by '\\n'
+	short dx, dy;            ///< the offset of the top-left corner of the text from the point
 };
 
 class RendererProgram
 {
 	private:
-		DisplayBuffer* p_buffer;
+		DisplayBuffer* p_buffer; // the current render target
+		DisplayBuffer* p_display; // the buffer given on construction
+		const RasterKernels* kernels; // picked for the buffer format and blend mode
+		BlendMode blend_mode;
+		std::vector<math::Region2i> dirty; // changed since the last readback
+		std::vector<math::Region2i> drawn; // drawn since the last clear
+		math::MatrixStack modelview_stack, proj_stack;
+		// vertices of the current batch, transformed to pixel positions
+		std::vector<std::pair<int,int>> batch_pos;
+		std::vector<unsigned char> batch_clip; // as returned by projectPoint()
+		static constexpr unsigned char UNTRANSFORMED = 0xFF; // in batch_clip
+		math::Region2i clip; // the pixels that primitives may cover: the scissor region
+
+		/* Vertex buffer object, owned by the rendering thread */
+		struct VertexBuffer
+		{
+			std::vector<math::Vector4f> vertices;
+			std::vector<unsigned int> colors; // one per vertex, or none
+			math::Bounds bounds; // of all vertices
+		};
+		std::unordered_map<unsigned int, VertexBuffer> buffers;
+
+		/* Viewport of the viewport array, with its own matrices */
+		struct ViewportSlot
+		{
+			math::Region2i region;
+			math::Mat4x4f proj, modelview;
+		};
+		std::vector<ViewportSlot> viewport_slots;
+		// programs drawing viewports in other threads, on the same buffer
+		std::vector<std::unique_ptr<RendererProgram>> workers;
+		std::unique_ptr<WorkerPool> pool; // created on the first parallel operation
+
+		/* State of a render target kept while another one is current */
+		struct TargetState
+		{
+			std::vector<math::Region2i> drawn;
+			math::Region2i viewport, clip;
+		};
+		/* Offscreen render target, owned by the rendering thread */
+		struct RenderTarget
+		{
+			DisplayBuffer buffer;
+			TargetState state;
+		};
+		std::unordered_map<unsigned int, RenderTarget> targets;
+		unsigned int target; // the handle of the current render target, 0 for the display
+		TargetState display_state;
+
+		// supersampling: the display is drawn to the samples, and resolved into the display
+		int supersampling; // samples per pixel along each axis
+		DisplayBuffer samples;
+		std::vector<math::Region2i> unresolved; // changed samples
+
+		std::unordered_map<unsigned int, Font> fonts; // the built-in font is not kept here
 	public:
 		math::Mat4x4f modelview;
 		math::Mat4x4f proj;
 		math::Region2i viewport;
 		unsigned int front_color, clear_color;
 
+		// profiling counters (only updated when compiled with Derplotter_PROFILE)
+		unsigned long long pixels_written;
+		unsigned long long primitives_culled;
+
 	public:
 		/** Default constructor */
 		RendererProgram(void);
@@ -53,23 +145,363 @@ class RendererProgram
 
 		// other drawing operations
 		int raw_clear(void);
+		int raw_clearRegion(const math::Region2i& region);
+		int raw_clearDrawn(void);
 
 		// 2D operations (no transformations needed, draw to buffer directly)
-		int raw_drawPoint(const std::pair<int,int>& p);
-		int raw_drawBigPoint(const std::pair<int,int>& p);
-		int raw_drawLine(std::pair<int,int>& p1, std::pair<int,int>& p2);
+		int raw_drawPoint(const std::pair<int,int>& p)
+		{ return raw_drawPoint(p, this->front_color); }
+		int raw_drawPoint(const std::pair<int,int>& p, unsigned int color);
+		int raw_drawBigPoint(const std::pair<int,int>& p)
+		{ return raw_drawBigPoint(p, this->front_color); }
+		int raw_drawBigPoint(const std::pair<int,int>& p, unsigned int color);
+		int raw_drawLine(std::pair<int,int>& p1, std::pair<int,int>& p2)
+		{ return raw_drawShadedLine(p1, p2, this->front_color, this->front_color); }
+		/** Draws a line whose color is interpolated from \b c1 at \b p1 to \b c2 at \b p2 */
+		int raw_drawShadedLine(std::pair<int,int>& p1, std::pair<int,int>& p2,
+							unsigned int c1, unsigned int c2);
+		/** Fills a triangle with the front color. Pixel rows from the top vertex up to,
+		 * but not including, the bottom vertex are covered, and in each row the pixels
+		 * from the left edge up to, but not including, the right edge, so that
+		 * triangles sharing an edge never cover the same pixel twice. */
+		int raw_fillTriangle(std::pair<int,int> p1, std::pair<int,int> p2,
+							std::pair<int,int> p3)
+		{ return raw_fillShadedTriangle(p1, p2, p3, front_color, front_color, front_color); }
+		/** Fills a triangle as \c raw_fillTriangle() , with the color of each pixel
+		 * interpolated from the colors of the vertices (Gouraud shading) */
+		int raw_fillShadedTriangle(std::pair<int,int> p1, std::pair<int,int> p2,
+							std::pair<int,int> p3, unsigned int c1, unsigned int c2,
+							unsigned int c3);
 
 		// 3D operations (need transformations)
 		int drawPoint(const math::Vector4f& p);
 		int drawBigPoint(const math::Vector4f& p);
 		int drawLine(const math::Vector4f& p1, const math::Vector4f& p2);
 
+		/** Draws a batch of vertices as the primitives of the given mode. Each vertex
+		 * is transformed only once, with the product of the projection and modelview
+		 * matrices. When \b bounds are given, they are tested against the view frustum
+		 * first: batches fully outside are skipped without transforming any vertex,
+		 * and batches fully inside skip the near and far plane clipping.
+		 * \param mode the kind of primitives (\c NOTHING draws nothing)
+		 * \param vertices the vertices
+		 * \param count the number of vertices
+		 * \param bounds the bounding volume of all vertices, in object coordinates
+		 * \param colors the ARGB color of each vertex, interpolated along lines and
+		 * across triangles, or \c nullptr to draw with the front color
+		 * \return 0 on success, 1 if the mode is invalid
+		 */
+		int drawArrays(RendererDrawMode mode, const math::Vector4f* vertices,
+						unsigned int count, const math::Bounds& bounds,
+						const unsigned int* colors = nullptr);
+
+		/** Draws a batch of indexed vertices as the primitives of the given mode, as in
+		 * \c drawArrays() . Each vertex referenced by the indices is transformed only
+		 * once, however many primitives share it.
+		 * \param mode the kind of primitives (\c NOTHING draws nothing)
+		 * \param vertices the vertices
+		 * \param vertex_count the number of vertices
+		 * \param indices the index of the vertex of each primitive corner
+		 * \param count the number of indices
+		 * \param bounds the bounding volume of all vertices, in object coordinates
+		 * \param colors the ARGB color of each vertex, or \c nullptr
+		 * \return 0 on success, 1 if the mode is invalid or an index is out of range
+		 */
+		int drawElements(RendererDrawMode mode, const math::Vector4f* vertices,
+						unsigned int vertex_count, const unsigned int* indices,
+						unsigned int count, const math::Bounds& bounds,
+						const unsigned int* colors = nullptr);
+
+		// vertex buffer objects
+		/** Replaces the contents of a vertex buffer, creating it if needed. The
+		 * bounding box of the vertices is kept for culling later draws.
+		 * \param id the handle of the buffer (not 0)
+		 * \param vertices the new vertices, which are taken over by the buffer
+		 * (the vector is left with the previous contents of the buffer)
+		 * \param colors the color of each vertex, or none to draw with the front color,
+		 * also taken over by the buffer
+		 * \return 0 on success, 1 if the handle is invalid or the number of colors
+		 * does not match */
+		int uploadVertices(unsigned int id, std::vector<math::Vector4f>& vertices,
+						std::vector<unsigned int>& colors);
+		/** Draws a range of the vertices of a buffer, as in \c drawArrays()
+		 * \return 0 on success, 1 if the buffer does not exist, the range does not
+		 * fit in the buffer or the mode is invalid */
+		int drawBuffer(unsigned int id, RendererDrawMode mode,
+						unsigned int first, unsigned int count);
+		/** Draws indexed vertices of a buffer, as in \c drawElements()
+		 * \return 0 on success, 1 if the buffer does not exist, an index is out of
+		 * range or the mode is invalid */
+		int drawBufferElements(unsigned int id, RendererDrawMode mode,
+						const unsigned int* indices, unsigned int count);
+		/** Releases a vertex buffer
+		 * \return 0 on success, 1 if the buffer does not exist */
+		int deleteBuffer(unsigned int id);
+
+		// viewport arrays
+		/** Defines a viewport of the viewport array, creating the viewports up to it
+		 * if needed. Draws into it are mapped to the region with its own matrices
+		 * instead of the current ones, and are clipped to the region (and to the
+		 * scissor region).
+		 * \param index the index of the viewport
+		 * \param region the viewport region
+		 * \param proj the projection matrix of the viewport
+		 * \param modelview the modelview matrix of the viewport
+		 * \return 0 on success, 1 if the index is not below \c MAX_VIEWPORT_SLOTS */
+		int setViewportSlot(unsigned int index, const math::Region2i& region,
+						const math::Mat4x4f& proj, const math::Mat4x4f& modelview);
+		/** Draws ranges of vertex buffers into viewports of the viewport array, as in
+		 * \c drawBuffer() . The draws into each viewport are made in the given order,
+		 * but the viewports are drawn concurrently when their regions do not overlap
+		 * and there are enough vertices for each thread. Otherwise, all draws are made
+		 * one after the other.
+		 * \param draws the draws
+		 * \param count the number of draws
+		 * \param threads the maximum number of threads to use, or 0 for as many as
+		 * the hardware runs concurrently (which is also the limit)
+		 * \return 0 on success, 1 if a viewport or buffer does not exist, a range does
+		 * not fit in its buffer or a mode is invalid, in which case nothing is drawn */
+		int drawViewports(const ViewportDraw* draws, unsigned int count,
+						unsigned int threads = 0);
+
+		/** Applies the modelview, projection, normalization and viewport
+		 * transformations to a point.
+		 * \param p the point to transform, modified by the function
+		 * \param rp output reference to the pixel position
+		 * \return 0 if the point is visible, 1 if it falls outside the viewport,
+		 * 2 if it was clipped by the near or far planes
+		 */
+		int transformPoint(math::Vector4f& p, std::pair<int,int>& rp);
+
+		/** Applies the normalization and viewport transformations to a point
+		 * already in clip coordinates.
+		 * \return the same as \c transformPoint()
+		 */
+		int projectPoint(math::Vector4f& p, std::pair<int,int>& rp) const;
+
+		// matrix stacks
+		/** Saves a copy of the modelview (0) or projection (1) matrix on its stack
+		 * \return 0 on success, 1 if the stack is full */
+		int pushMatrix(int matrix);
+		/** Restores the modelview (0) or projection (1) matrix from its stack
+		 * \return 0 on success, 1 if the stack is empty */
+		int popMatrix(int matrix);
+
+		// offscreen render targets
+		/** Creates an offscreen render target in the pixel format of the display
+		 * buffer, replacing the one with the same handle if it exists. Its contents
+		 * are undefined until cleared or drawn.
+		 * \param id the handle of the target (not 0)
+		 * \param width the width of the target
+		 * \param height the height of the target
+		 * \return 0 on success, 1 if the handle is invalid or of the current target,
+		 * or the size is not valid */
+		int createTarget(unsigned int id, int width, int height);
+		/** Makes the following operations draw to (and clear) another render target.
+		 * Each target keeps its own viewport, scissor region and drawn regions,
+		 * which start as the whole target. Only the changes to the display buffer
+		 * are tracked as dirty regions.
+		 * \param id the handle of the target, or 0 for the display buffer
+		 * \return 0 on success, 1 if the target does not exist */
+		int setRenderTarget(unsigned int id);
+		/** Releases a render target. If it is the current target, the display buffer
+		 * becomes the current target.
+		 * \return 0 on success, 1 if the target does not exist */
+		int deleteTarget(unsigned int id);
+		/** Copies a region of a render target to a region of the current target,
+		 * scaling it to fit. The source pixels are composed with the current blend
+		 * mode, and clipped to the scissor region. Palette indices are always
+		 * copied from the nearest source pixel.
+		 * \param source the handle of the source target, or 0 for the display buffer
+		 * \param src_region the region to copy, within the source
+		 * \param dst_region the region to cover in the current target
+		 * \param filter how the source is sampled
+		 * \return 0 on success, 1 if the source does not exist or is the current
+		 * target, the source region does not fit in it, a region is empty or the
+		 * filter is invalid */
+		int blit(unsigned int source, const math::Region2i& src_region,
+				const math::Region2i& dst_region, BlitFilter filter);
+
+		// supersampling
+		/** Makes the display target a buffer with \b factor x \b factor samples per
+		 * pixel of the display buffer, which are averaged into the display buffer by
+		 * \c resolve() . The current contents of the display are kept. While
+		 * supersampling, the pixel coordinates of the display target (such as those
+		 * of the viewport, the scissor region and raw primitives) are in samples, and
+		 * the current viewport, scissor region and viewport array are scaled to them.
+		 * \param factor the number of samples along each axis: 1 (no supersampling),
+		 * 2 or 4
+		 * \return 0 on success, 1 if the factor is not valid, the display buffer
+		 * holds palette indices, or the display buffer is not the current target */
+		int setSupersampling(int factor);
+		/** \return the number of samples per pixel along each axis, 1 if not supersampling */
+		int getSupersampling(void) const;
+		/** Averages the samples changed since the last resolve into the display buffer,
+		 * whose changed pixels then become dirty regions. Each region is split into
+		 * bands of rows, resolved concurrently by threads kept between calls.
+		 * \param threads the maximum number of threads to use, or 0 for as many as
+		 * the hardware runs concurrently
+		 * \return 0 */
+		int resolve(unsigned int threads = 0);
+
+		// text
+		/** Defines a font, replacing the one with the same handle if it exists.
+		 * \param id the handle of the font (not 0, which is the built-in font)
+		 * \param font the font, moved into the program
+		 * \return 0 on success, 1 if the handle or the font is not valid */
+		int createFont(unsigned int id, Font&& font);
+		/** Releases a font
+		 * \return 0 on success, 1 if the font does not exist */
+		int deleteFont(unsigned int id);
+		/** Draws a text with its top-left corner at a pixel. Glyph pixels of partial
+		 * coverage are composed over the buffer, as with \c BLEND_ALPHA , unless
+		 * another blend mode than \c BLEND_REPLACE is in use. While supersampling,
+		 * each pixel of a glyph covers as many samples as a pixel of the display.
+		 * \param font the handle of the font, or 0 for the built-in font
+		 * \param p the position of the top-left corner of the text
+		 * \param text the null-terminated text, with lines separated by '\\n'
+		 * \param color the color of the text
+		 * \return 0 on success, 1 if the font does not exist */
+		int raw_drawText(unsigned int font, const std::pair<int,int>& p, const char* text,
+						unsigned int color);
+		int raw_drawText(unsigned int font, const std::pair<int,int>& p, const char* text)
+		{ return raw_drawText(font, p, text, front_color); }
+		/** Draws texts placed at points, which are transformed as the vertices of
+		 * other primitives. Texts whose point is clipped by the near or far planes
+		 * are not drawn.
+		 * \param font the handle of the font, or 0 for the built-in font
+		 * \param labels the texts to draw
+		 * \param count the number of texts
+		 * \param colors the color of each text, or \c nullptr for the front color
+		 * \return 0 on success, 1 if the font does not exist */
+		int drawText(unsigned int font, const TextLabel* labels, unsigned int count,
+					const unsigned int* colors = nullptr);
+
+		// plots
+		/** Draws the lines of a plot grid in the XY plane: a line across the grid
+		 * at each multiple of the spacing along each axis. The lines are transformed
+		 * as the vertices of other primitives, and drawn with the front color.
+		 * Those that are horizontal or vertical in the buffer (as with an orthographic
+		 * projection) are written as straight rows or columns of pixels.
+		 * \param x_min the left edge of the grid
+		 * \param x_max the right edge of the grid
+		 * \param y_min the bottom edge of the grid
+		 * \param y_max the top edge of the grid
+		 * \param x_step the spacing of the vertical lines, or 0 for none
+		 * \param y_step the spacing of the horizontal lines, or 0 for none
+		 * \return 0 on success, 1 if a spacing is negative or makes more than
+		 * \c MAX_PLOT_LINES lines */
+		int drawGrid(float x_min, float x_max, float y_min, float y_max,
+					float x_step, float y_step);
+		/** Draws a plot axis in the XY plane with the front color, with ticks at each
+		 * multiple of the spacing. The ticks have a fixed length in pixels, and extend
+		 * from the axis towards the bottom-left of the buffer (below a horizontal axis,
+		 * to the left of a vertical one). The axis and its ticks are not drawn if an
+		 * end of the axis is clipped by the near or far planes.
+		 * \param axis 0 for an axis along X, 1 for an axis along Y
+		 * \param from the first coordinate along the axis
+		 * \param to the last coordinate along the axis
+		 * \param at the coordinate of the axis along the other axis
+		 * \param step the spacing of the ticks, or 0 for none (see \c math::tickStep() )
+		 * \param tick_length the length of the ticks in pixels, negative for ticks
+		 * towards the top-right
+		 * \return 0 on success, 1 if the axis is invalid, or the spacing is negative
+		 * or makes more than \c MAX_PLOT_LINES ticks */
+		int drawAxis(int axis, float from, float to, float at, float step, int tick_length);
+
+		// scissor test
+		/** Restricts all later primitives to a region of the buffer. The primitives
+		 * are clipped to it as they are rasterized, with no test per pixel. Clears
+		 * are not affected.
+		 * \param region the scissor region, which may exceed the buffer
+		 * \return 0 */
+		int setScissor(const math::Region2i& region);
+		/** Lets all later primitives cover the whole buffer again
+		 * \return 0 */
+		int disableScissor(void);
+
+		// buffer properties and export
+		int setPalette(const unsigned int* colors, int count);
+		int setBlendMode(BlendMode mode);
+		/** Saves the current target to an image file. The display buffer is
+		 * resolved first when supersampling. */
+		int saveImage(const char* path, ImageFormat format, PngFilter filter);
+
+		// damage tracking
+		/** \return the regions of the buffer changed since the last reset */
+		const std::vector<math::Region2i>& dirtyRegions(void) const;
+		/** Forgets all changed regions, usually after reading them back */
+		void resetDirtyRegions(void);
+
 		static constexpr unsigned int DEFAULT_FRONT_COLOR = 0xFFFFFFFF;
 		static constexpr unsigned int DEFAULT_CLEAR_COLOR = 0xFF000000;
+		/** Maximum number of disjoint regions kept by the damage tracking
+		 * before collapsing them into their bounding box */
+		static constexpr unsigned int MAX_DIRTY_REGIONS = 16;
+		/** Minimum number of vertices drawn by each thread of \c drawViewports() */
+		static constexpr unsigned int VIEWPORTS_MIN_THREAD_VERTICES = 2048;
+		/** Minimum number of rows resolved by each thread */
+		static constexpr int RESOLVE_MIN_BAND_ROWS = 32;
+		/** Maximum number of lines along each axis of a grid, and of ticks of an axis */
+		static constexpr unsigned int MAX_PLOT_LINES = 4096;
+		/** Maximum number of viewports in the viewport array */
+		static constexpr unsigned int MAX_VIEWPORT_SLOTS = 256;
 	protected:
 	private:
 
-		int transformPoint(math::Vector4f& p, std::pair<int,int>& rp);
+		/* \return the list of changed regions of the display target, which are
+		 * samples when supersampling */
+		std::vector<math::Region2i>& changed(void)
+		{ return (this->supersampling > 1) ? this->unresolved : this->dirty; }
+		/* \return the buffer drawn to when the display is the current target */
+		DisplayBuffer* displayTarget(void)
+		{ return (this->supersampling > 1) ? &this->samples : this->p_display; }
+		void markDirty(const math::Region2i& region);
+		void markDrawn(const math::Region2i& region);
+		static void addRegion(std::vector<math::Region2i>& list, math::Region2i region);
+
+		/* Determines the number of primitives formed by \b count vertices
+		 * \return false if the mode is invalid */
+		static bool primitiveCount(RendererDrawMode mode, unsigned int count,
+									unsigned int& primitives);
+		/* Transforms a vertex into position \b i of the current batch */
+		void transformBatchVertex(const math::Vector4f& v, unsigned int i,
+									const math::Mat4x4f& mvp, bool inside);
+		/* Draws the primitives of the transformed vertices of the current batch,
+		 * taken in order or from \b indices when not null, with the vertex \b colors
+		 * when not null */
+		void drawBatch(RendererDrawMode mode, const unsigned int* indices,
+						unsigned int count, unsigned int primitives,
+						const unsigned int* colors);
+
+		/* \return the font with the given handle, or \c nullptr */
+		const Font* findFont(unsigned int id) const;
+		/* Draws the glyphs of a text, clipped to the scissor region */
+		void drawGlyphs(const Font& font, int x, int y, const char* text, unsigned int color);
+
+		/* Finds the multiples of \b step in [from,to], which are \b first
+		 * times \b step and the \b count following ones
+		 * \return false if the step is invalid or there are too many */
+		static bool plotSteps(float from, float to, float step, long long& first,
+							unsigned int& count);
+		/* Transforms a point of a plot to a pixel position
+		 * \return false if it is clipped by the near or far planes */
+		bool plotPoint(float x, float y, const math::Mat4x4f& mvp, std::pair<int,int>& rp) const;
+		/* Draws the lines between pairs of pixel positions of the current batch,
+		 * straight along a row or column where possible */
+		void drawPlotLines(unsigned int color);
+
+		/* \return the pool of threads for parallel operations, created on first use */
+		WorkerPool& workerPool(void);
+
+		/* Draws a range of a vertex buffer with the region and matrices of a viewport,
+		 * clipped to its region */
+		void drawInSlot(const ViewportSlot& slot, const VertexBuffer& buffer,
+						const ViewportDraw& draw);
+
+		/* Restricts the range [t0,t1] along a line's major axis to the positions
+		 * where the minor coordinate, (v0 + t*slope) >> 16, lies in [lo,hi) */
+		static bool clipLine(int& t0, int& t1, long long v0, long long slope, int lo, int hi);
 };
 
 };
@@ -0,0 +1,77 @@
+/** \file RendererStats.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+#include "RendererStats.h"
+
+#include <string.h>
+
+using namespace derplot;
+
+namespace
+{
+	const char* const OPERATION_NAMES[OPERATION_TYPE_COUNT] = {
+		"Terminate", "ViewPort", "Clear", "ClearRegion", "ClearDrawn",
+		"RawPoint", "RawLine", "Point", "Line", "MatrixSet", "Ortho", "Perspective",
+		"MatrixTranslate", "MatrixRotate", "MatrixScale", "ClearColor", "FrontColor",
+		"SetBlendMode", "SetPalette", "SaveImage", "PushMatrix", "PopMatrix",
+		"MatrixQuaternion", "MatrixEuler", "MatrixTRS", "DrawArrays",
+		"UploadVertices", "DrawBuffer", "DeleteBuffer",
+		"DrawElements", "DrawBufferElements", "MatrixMultiply",
+		"SetViewportSlot", "DrawViewports", "Scissor",
+		"CreateTarget", "SetRenderTarget", "DeleteTarget", "Blit",
+		"SetSupersampling", "Resolve", "CreateFont", "DeleteFont", "DrawText",
+		"DrawGrid", "DrawAxis" };
+}
+
+const char* derplot::operationName(OperationType type)
+{
+	return (type < OPERATION_TYPE_COUNT) ? OPERATION_NAMES[type] : "Unknown";
+}
+
+RendererStats::RendererStats(void)
+{
+	this->reset();
+}
+
+void RendererStats::reset(void)
+{
+	memset(this->op_count, 0, sizeof(this->op_count));
+	memset(this->op_time, 0, sizeof(this->op_time));
+	this->pixels_written = 0;
+	this->primitives_culled = 0;
+	this->queue_high_water = 0;
+	this->producer_wait = 0;
+	this->ops_dropped = 0;
+}
+
+void RendererStats::add(const RendererStats& other)
+{
+	for (int i = 0 ; i < OPERATION_TYPE_COUNT ; i++)
+	{
+		this->op_count[i] += other.op_count[i];
+		this->op_time[i] += other.op_time[i];
+	}
+	this->pixels_written += other.pixels_written;
+	this->primitives_culled += other.primitives_culled;
+	if (other.queue_high_water > this->queue_high_water)
+		this->queue_high_water = other.queue_high_water;
+	this->producer_wait += other.producer_wait;
+	this->ops_dropped += other.ops_dropped;
+}
+
+unsigned long long RendererStats::totalOps(void) const
+{
+	unsigned long long total = 0;
+	for (int i = 0 ; i < OPERATION_TYPE_COUNT ; i++)
+		total += this->op_count[i];
+	return total;
+}
+
+unsigned long long RendererStats::totalTime(void) const
+{
+	unsigned long long total = 0;
+	for (int i = 0 ; i < OPERATION_TYPE_COUNT ; i++)
+		total += this->op_time[i];
+	return total;
+}
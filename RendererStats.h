@@ -0,0 +1,116 @@
+/** \file RendererStats.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ *
+ * \brief Profiling counters of the renderer.
+ *
+ * The counters are only updated when the library is compiled with the
+ * \c Derplotter_PROFILE macro defined. Otherwise, no time is measured and all
+ * counters remain at zero, so that the instrumentation has no cost at all.
+ */
+#pragma once
+
+namespace derplot
+{
+
+/** Identifies the type of a renderer operation */
+enum OperationType : unsigned char
+{
+	OP_TERMINATE = 0,
+	OP_VIEWPORT,
+	OP_CLEAR,
+	OP_CLEAR_REGION,
+	OP_CLEAR_DRAWN,
+	OP_RAW_POINT,
+	OP_RAW_LINE,
+	OP_POINT,
+	OP_LINE,
+	OP_MATRIX_SET,
+	OP_ORTHO,
+	OP_PERSPECTIVE,
+	OP_MATRIX_TRANSLATE,
+	OP_MATRIX_ROTATE,
+	OP_MATRIX_SCALE,
+	OP_CLEAR_COLOR,
+	OP_FRONT_COLOR,
+	OP_BLEND_MODE,
+	OP_PALETTE,
+	OP_SAVE_IMAGE,
+	OP_PUSH_MATRIX,
+	OP_POP_MATRIX,
+	OP_MATRIX_QUATERNION,
+	OP_MATRIX_EULER,
+	OP_MATRIX_TRS,
+	OP_DRAW_ARRAYS,
+	OP_UPLOAD_VERTICES,
+	OP_DRAW_BUFFER,
+	OP_DELETE_BUFFER,
+	OP_DRAW_ELEMENTS,
+	OP_DRAW_BUFFER_ELEMENTS,
+	OP_MATRIX_MULTIPLY,
+	OP_VIEWPORT_SLOT,
+	OP_DRAW_VIEWPORTS,
+	OP_SCISSOR,
+	OP_CREATE_TARGET,
+	OP_RENDER_TARGET,
+	OP_DELETE_TARGET,
+	OP_BLIT,
+	OP_SUPERSAMPLING,
+	OP_RESOLVE,
+	OP_CREATE_FONT,
+	OP_DELETE_FONT,
+	OP_DRAW_TEXT,
+	OP_DRAW_GRID,
+	OP_DRAW_AXIS
+};
+
+/** Number of operation types */
+constexpr int OPERATION_TYPE_COUNT = OP_DRAW_AXIS + 1;
+
+/** \return a printable name of the operation type */
+const char* operationName(OperationType type);
+
+/**
+ * \brief Snapshot of the profiling counters of a renderer.
+ */
+struct RendererStats
+{
+	/** Number of dispatched operations of each type */
+	unsigned long long op_count[OPERATION_TYPE_COUNT];
+
+	/** Cumulative dispatch time of each type of operation, in nanoseconds */
+	unsigned long long op_time[OPERATION_TYPE_COUNT];
+
+	/** Number of pixels written to the buffer, including clears */
+	unsigned long long pixels_written;
+
+	/** Number of primitives rejected without writing any pixel */
+	unsigned long long primitives_culled;
+
+	/** Largest number of operations waiting in the queue */
+	unsigned long long queue_high_water;
+
+	/** Time spent by the invoking threads waiting for the queue, in nanoseconds */
+	unsigned long long producer_wait;
+
+	/** Number of operations dropped or rejected because the queue was full */
+	unsigned long long ops_dropped;
+
+	/** Creates a snapshot with all counters at zero */
+	RendererStats(void);
+
+	/** Sets all counters to zero */
+	void reset(void);
+
+	/** Adds the counters of another snapshot to these counters. The queue
+	 * high-water mark becomes the largest of both. */
+	void add(const RendererStats& other);
+
+	/** \return the number of dispatched operations of all types */
+	unsigned long long totalOps(void) const;
+
+	/** \return the cumulative dispatch time of all operations, in nanoseconds */
+	unsigned long long totalTime(void) const;
+};
+
+};
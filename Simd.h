@@ -0,0 +1,101 @@
+/** \file Simd.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \namespace derplot::math::simd
+ *
+ * \brief Thin layer over the 4-lane floating point SIMD instructions available
+ * to the compiler.
+ *
+ * SSE is used on x86 targets and NEON on ARM targets. Fused multiply-add instructions
+ * are used when the target supports them (such as with <tt>-mfma</tt> or on AArch64).
+ * Other targets fall back to plain scalar code with the same interface. Loads and
+ * stores require 16-byte aligned addresses.
+ */
+#pragma once
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DERPLOTTER_SIMD_SSE 1
+#include <xmmintrin.h>
+#if defined(__FMA__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DERPLOTTER_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace derplot
+{
+
+namespace math
+{
+
+namespace simd
+{
+#if defined(DERPLOTTER_SIMD_SSE)
+
+	typedef __m128 float4;
+
+	inline float4 load(const float* p) { return _mm_load_ps(p); }
+	inline void store(float* p, float4 a) { _mm_store_ps(p, a); }
+	inline float4 splat(float f) { return _mm_set1_ps(f); }
+	inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+	inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+	inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+
+	/** \return <tt>a*b + c</tt> */
+	inline float4 madd(float4 a, float4 b, float4 c)
+	{
+#if defined(__FMA__)
+		return _mm_fmadd_ps(a, b, c);
+#else
+		return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+	}
+
+#elif defined(DERPLOTTER_SIMD_NEON)
+
+	typedef float32x4_t float4;
+
+	inline float4 load(const float* p) { return vld1q_f32(p); }
+	inline void store(float* p, float4 a) { vst1q_f32(p, a); }
+	inline float4 splat(float f) { return vdupq_n_f32(f); }
+	inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+	inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+	inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+
+	/** \return <tt>a*b + c</tt> */
+	inline float4 madd(float4 a, float4 b, float4 c)
+	{
+#if defined(__aarch64__)
+		return vfmaq_f32(c, a, b);
+#else
+		return vmlaq_f32(c, a, b);
+#endif
+	}
+
+#else
+
+	struct float4 { float v[4]; };
+
+	inline float4 load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+	inline void store(float* p, float4 a)
+	{ p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+	inline float4 splat(float f) { return {{f, f, f, f}}; }
+	inline float4 add(float4 a, float4 b)
+	{ return {{a.v[0]+b.v[0], a.v[1]+b.v[1], a.v[2]+b.v[2], a.v[3]+b.v[3]}}; }
+	inline float4 sub(float4 a, float4 b)
+	{ return {{a.v[0]-b.v[0], a.v[1]-b.v[1], a.v[2]-b.v[2], a.v[3]-b.v[3]}}; }
+	inline float4 mul(float4 a, float4 b)
+	{ return {{a.v[0]*b.v[0], a.v[1]*b.v[1], a.v[2]*b.v[2], a.v[3]*b.v[3]}}; }
+
+	/** \return <tt>a*b + c</tt> */
+	inline float4 madd(float4 a, float4 b, float4 c)
+	{ return add(mul(a, b), c); }
+
+#endif
+};
+
+};
+
+};
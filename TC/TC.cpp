@@ -53,6 +53,7 @@ int main(int argc, char** argv)
 	setMyProjection(renderer);
 
 	renderer.clear_color(0xFF111111);
+	renderer.clear();
 
 	bool running = true;
 	unsigned int framenum = 0;
@@ -123,8 +124,8 @@ int main(int argc, char** argv)
 		moving_point.x() = 0.5f + cos(ang) * 0.25f;
 		moving_point.z() = 0.5f + sin(ang) * 0.25f;
 
-		// draw stuff
-		renderer.clear();
+		// draw stuff (only what was drawn in the previous frame needs clearing)
+		renderer.clearDrawn();
 		renderer.front_color(0xFF888888);
 		const Vector4f middle{0.5, 1, 0.5};
 		renderer.drawLine(middle, moving_point);
@@ -137,26 +138,28 @@ int main(int argc, char** argv)
 		renderer.drawLine(middle, tp);
 
 		renderer.front_color(0xFFFFFFFF);
+		renderer.pushMatrix();
 		renderer.scale({1,1,1.5});
 		drawAThing(renderer);
-		renderer.scale({1,1,1/1.5});
-
-		// X
-		renderer.front_color(0xFFFF0000);
-		renderer.drawLine({0.5,0.5,0.5}, {1,0.5,0.5});
-		// Y
-		renderer.front_color(0xFF00FF00);
-		renderer.drawLine({0.5,0.5,0.5}, {0.5,1,0.5});
-		// Z
-		renderer.front_color(0xFF0000FF);
-		renderer.drawLine({0.5,0.5,0.5}, {0.5,0.5,1});
+		renderer.popMatrix();
+
+		// X, Y and Z axes, fading in from the center
+		static const float axes[] = {
+			0.5,0.5,0.5, 1,0.5,0.5,  0.5,0.5,0.5, 0.5,1,0.5,  0.5,0.5,0.5, 0.5,0.5,1 };
+		static const unsigned int axis_colors[] = {
+			0xFF400000, 0xFFFF0000,  0xFF004000, 0xFF00FF00,  0xFF000040, 0xFF0000FF };
+		renderer.drawArrays(LINES, axes, axis_colors, 6);
+		static const TextLabel axis_labels[] = {
+			{{1,0.5,0.5}, "X", 2, -4}, {{0.5,1,0.5}, "Y", 2, -4}, {{0.5,0.5,1}, "Z", 2, -4} };
+		static const unsigned int label_colors[] = { 0xFFFF0000, 0xFF00FF00, 0xFF0000FF };
+		renderer.drawText(axis_labels, 3, label_colors);
 
 		// flush
 		renderer.flush();
 
-		// copy result to SDL surface
+		// copy the changed regions to the SDL surface
 		SDL_LockSurface( p_surface );
-		renderer.bufferCopy(p_surface->pixels);
+		renderer.copyDirtyRegions(p_surface->pixels);
 		SDL_UnlockSurface( p_surface );
 
 		//swap SDL buffers
@@ -182,28 +185,26 @@ void setMyProjection(Renderer& renderer)
 
 void drawAThing(Renderer& renderer)
 {
-	const float line_stream[] = {
-		0,0,0, 1,0,0, 1,0,0, 1,1,0, 1,1,0, 0,1,0, 0,1,0, 0,0,0,
-		0,0,1, 1,0,1, 1,0,1, 1,1,1, 1,1,1, 0,1,1, 0,1,1, 0,0,1,
-		0,0,0, 0,0,1, 1,0,0, 1,0,1, 1,1,0, 1,1,1, 0,1,0, 0,1,1,
-
-		0,0,1, .5,.5,2,  1,0,1, .5,.5,2,  0,1,1, .5,.5,2,  1,1,1, .5,.5,2,
-
-		0,0,1, -1,.5,1,  0,1,1, -1,.5,1,  0,0,0, -1,.5,0,  0,1,0, -1,.5,0,
-		-1,.5,0, -1,.5,1,
-
-		1,0,1, 2,.5,1,  1,1,1, 2,.5,1,  1,0,0, 2,.5,0,  1,1,0, 2,.5,0,
-		2,.5,0, 2,.5,1,
+	const float vertices[] = {
+		0,0,0, 1,0,0, 1,1,0, 0,1,0, // base
+		0,0,1, 1,0,1, 1,1,1, 0,1,1, // top
+		.5,.5,2, // tip
+		-1,.5,1, -1,.5,0, // left wing
+		2,.5,1, 2,.5,0, // right wing
 	};
-	Vector4f p1, p2;
-	for (unsigned int i = 0 ; i < sizeof(line_stream)/sizeof(float) ;  )
+	const unsigned int edges[] = {
+		0,1, 1,2, 2,3, 3,0,  4,5, 5,6, 6,7, 7,4,  0,4, 1,5, 2,6, 3,7,
+		4,8, 5,8, 7,8, 6,8,
+		4,9, 7,9, 0,10, 3,10, 10,9,
+		5,11, 6,11, 1,12, 2,12, 12,11,
+	};
+
+	// the vertices are sent to the renderer only once
+	static unsigned int buffer = 0;
+	if (buffer == 0)
 	{
-		p1.x() = line_stream[i++];
-		p1.y() = line_stream[i++];
-		p1.z() = line_stream[i++];
-		p2.x() = line_stream[i++];
-		p2.y() = line_stream[i++];
-		p2.z() = line_stream[i++];
-		renderer.drawLine(p1,p2);
+		buffer = renderer.createBuffer();
+		renderer.uploadVertices(buffer, vertices, sizeof(vertices)/sizeof(float)/3);
 	}
+	renderer.drawBufferElements(buffer, LINES, edges, sizeof(edges)/sizeof(unsigned int));
 }
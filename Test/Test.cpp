@@ -0,0 +1,1336 @@
+/**
+ * \file Test.cpp
+ * \brief Derplotter Test Suite
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \copyright Academic Free License version 3.0
+ *
+ * This headless executable checks behaviors of the renderer that are easy to break
+ * without noticing, such as the rewrites made by <tt>CommandBuffer::optimize()</tt> ,
+ * which must not change the drawn pixels.
+ *
+ * Each test prints its name and whether it passed. The program returns 0 only if
+ * all tests passed.
+ *
+ * Usage: <tt>Test [name filter]</tt>
+ */
+
+#include <Derplotter.h>
+#include <CommandBuffer.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+using namespace std;
+using namespace derplot;
+using namespace math;   // derplot::math
+
+typedef std::pair<int,int> ipair;
+
+static const char* filter = nullptr;
+static int failed_checks = 0, failed_tests = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+
+/** Records the result of a condition, printing it if it does not hold */
+void check(bool ok, const char* what, const char* file, int line)
+{
+	if (ok) return;
+	printf("  %s:%d: check failed: %s\n", file, line, what);
+	failed_checks++;
+}
+
+/** Runs a test function, and prints whether all of its checks passed */
+template <typename F>
+void test(const char* name, F func)
+{
+	if (filter != nullptr && strstr(name, filter) == nullptr) return;
+	const int before = failed_checks;
+	func();
+	const bool ok = failed_checks == before;
+	if (!ok) failed_tests++;
+	printf("%s %s\n", ok ? "ok  " : "FAIL", name);
+	fflush(stdout);
+}
+
+constexpr int WIDTH = 96;
+constexpr int HEIGHT = 64;
+
+/** Renders the operations of \b record , as recorded and as optimized, and checks
+ * that both give the same pixels.
+ * \return the number of operations removed by the optimization
+ */
+template <typename F>
+size_t checkOptimized(F record)
+{
+	CommandBuffer plain, optimized;
+	record(plain);
+	record(optimized);
+	const size_t removed = optimized.optimize();
+
+	Renderer a(WIDTH, HEIGHT), b(WIDTH, HEIGHT);
+	CHECK(a.submit(plain) == 0);
+	CHECK(b.submit(optimized) == 0);
+	a.flush();
+	b.flush();
+	vector<unsigned int> pixels_a(WIDTH * HEIGHT), pixels_b(WIDTH * HEIGHT);
+	a.bufferCopy(pixels_a.data());
+	b.bufferCopy(pixels_b.data());
+	a.terminate();
+	b.terminate();
+
+	int drawn = 0, differ = 0;
+	for (int i = 0 ; i < WIDTH * HEIGHT ; i++)
+	{
+		drawn += pixels_a[i] != 0xFF000000;
+		differ += pixels_a[i] != pixels_b[i];
+	}
+	CHECK(drawn > 0);
+	CHECK(differ == 0);
+	return removed;
+}
+
+/** Renders the operations of \b record
+ * \return the pixels of the display buffer
+ */
+template <typename F>
+vector<unsigned int> render(F record)
+{
+	CommandBuffer cb;
+	record(cb);
+	Renderer renderer(WIDTH, HEIGHT);
+	CHECK(renderer.submit(cb) == 0);
+	renderer.flush();
+	vector<unsigned int> pixels(WIDTH * HEIGHT);
+	renderer.bufferCopy(pixels.data());
+	renderer.terminate();
+	return pixels;
+}
+
+/** \return the number of pixels not of the clear color */
+int drawnPixels(const vector<unsigned int>& pixels)
+{
+	return (int)(pixels.size() - std::count(pixels.begin(), pixels.end(), 0xFF000000));
+}
+
+void testOptimizer(void)
+{
+	test("optimize: repeated and unused state", [] {
+		const size_t removed = checkOptimized([](CommandBuffer& cb) {
+			cb.clear();
+			cb.front_color(0xFF00FF00);
+			cb.front_color(0xFFFF0000); // replaced before use
+			cb.setViewPort(Region2i(0, 48, 0, 32));
+			cb.drawRawLine(ipair(0, 0), ipair(90, 60));
+			cb.front_color(0xFFFF0000); // the same value
+			cb.setViewPort(Region2i(0, 48, 0, 32));
+			cb.drawLine({-1, -1, 0}, {1, 1, 0});
+			cb.setScissor(Region2i(8, 80, 8, 56));
+			cb.setScissor(Region2i(8, 80, 8, 56));
+			cb.drawRawLine(ipair(0, 63), ipair(95, 0));
+			cb.setBlendMode(BLEND_ALPHA);
+			cb.front_color(0x800000FF);
+			cb.drawRawLine(ipair(0, 32), ipair(95, 32));
+		});
+		CHECK(removed >= 4);
+	});
+
+	test("optimize: folded matrices", [] {
+		const size_t removed = checkOptimized([](CommandBuffer& cb) {
+			cb.clear();
+			cb.orthoProjection(-2, 2, -2, 2, -1, 1);
+			cb.translate({0.5f, 0.25f, 0});
+			cb.scale({2, 2, 1});
+			cb.translate({-0.25f, 0, 0});
+			cb.drawLine({-0.5f, -0.5f, 0}, {0.5f, 0.5f, 0});
+			cb.translate({1, 0, 0});
+			cb.translate({-1, 0, 0}); // cancels out
+			cb.drawLine({-0.5f, 0.5f, 0}, {0.5f, -0.5f, 0});
+		});
+		CHECK(removed >= 3);
+	});
+
+	test("optimize: merged draws", [] {
+		const size_t removed = checkOptimized([](CommandBuffer& cb) {
+			cb.clear();
+			for (int i = 0 ; i < 16 ; i++)
+				cb.drawLine({-1, i / 8.f - 1, 0}, {1, 1 - i / 8.f, 0});
+			for (int i = 0 ; i < 16 ; i++)
+				cb.drawPoint({i / 8.f - 1, 0.5f, 0});
+		});
+		CHECK(removed == 30);
+	});
+
+	test("optimize: viewport across render targets", [] {
+		checkOptimized([](CommandBuffer& cb) {
+			const unsigned int target = cb.createTarget(WIDTH, HEIGHT);
+			cb.clear();
+			cb.setViewPort(Region2i(0, 48, 0, 32));
+			cb.drawLine({-1, -1, 0}, {1, 1, 0});
+			cb.setRenderTarget(target);
+			cb.clear();
+			cb.setViewPort(Region2i(0, 48, 0, 32)); // the target starts with its own
+			cb.drawLine({-1, 1, 0}, {1, -1, 0});
+			cb.setRenderTarget(0);
+			cb.blit(target, Region2i(0, WIDTH, 0, HEIGHT), Region2i(0, WIDTH, 0, HEIGHT));
+			cb.deleteTarget(target);
+		});
+	});
+
+	test("optimize: scissor across render targets", [] {
+		checkOptimized([](CommandBuffer& cb) {
+			const unsigned int target = cb.createTarget(WIDTH, HEIGHT);
+			cb.clear();
+			cb.setRenderTarget(target);
+			cb.setScissor(Region2i(16, 80, 16, 48));
+			cb.drawLine({-1, 1, 0}, {1, -1, 0});
+			cb.deleteTarget(target); // back to the display buffer, with its own scissor
+			cb.setScissor(Region2i(16, 80, 16, 48));
+			cb.drawLine({-1, -1, 0}, {1, 1, 0});
+		});
+	});
+
+	test("optimize: viewport across supersampling", [] {
+		checkOptimized([](CommandBuffer& cb) {
+			cb.clear();
+			cb.setViewPort(Region2i(0, 48, 0, 32));
+			cb.setScissor(Region2i(16, 80, 16, 48));
+			cb.drawLine({-1, -1, 0}, {1, 1, 0});
+			cb.setSupersampling(2); // rescales both regions to samples
+			cb.setViewPort(Region2i(0, 48, 0, 32));
+			cb.setScissor(Region2i(16, 80, 16, 48));
+			cb.drawLine({-1, 1, 0}, {1, -1, 0});
+		});
+	});
+}
+
+/** \return whether all elements of both matrices differ by less than 1e-5 */
+bool nearlyEqual(const Mat4x4f& a, const Mat4x4f& b)
+{
+	for (int i = 0 ; i < 16 ; i++)
+		if (fabsf(((const float*)a)[i] - ((const float*)b)[i]) >= 1e-5f) return false;
+	return true;
+}
+
+void testMath(void)
+{
+	test("matrix stack: pushes past the capacity and pops past the bottom are ignored", [] {
+		MatrixStack stack;
+		for (unsigned int i = 0 ; i < MatrixStack::CAPACITY ; i++)
+		{
+			Mat4x4f m = Mat4x4f::IDENTITY;
+			m.at(0, 3) = (float)i;
+			CHECK(stack.push(m));
+		}
+		CHECK(!stack.push(Mat4x4f::IDENTITY));
+		CHECK(stack.size() == MatrixStack::CAPACITY);
+		int wrong = 0;
+		for (int i = MatrixStack::CAPACITY - 1 ; i >= 0 ; i--)
+		{
+			Mat4x4f top;
+			wrong += !stack.pop(top) || top.at(0, 3) != (float)i;
+		}
+		CHECK(wrong == 0);
+		Mat4x4f untouched = Mat4x4f::IDENTITY;
+		CHECK(!stack.pop(untouched));
+		CHECK(memcmp((const float*)untouched, (const float*)Mat4x4f::IDENTITY, sizeof(float) * 16) == 0);
+		CHECK(stack.size() == 0);
+	});
+
+	test("matrix stack: ignored pushes and pops keep the matrices", [] {
+		const Vector4f a(-0.9f, -0.9f, 0), b(0.2f, 0.5f, 0), t(0.02f, 0.01f, 0);
+		const vector<unsigned int> expected = render([&](CommandBuffer& cb) {
+			cb.clear();
+			for (int i = 0 ; i < 30 ; i++) cb.translate(t);
+			cb.front_color(0xFFFF0000);
+			cb.drawLine(a, b);
+			cb.setModelViewMatrix(Mat4x4f::IDENTITY);
+			cb.front_color(0xFF00FF00);
+			cb.drawLine(a, b);
+		});
+		const vector<unsigned int> pixels = render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.popMatrix(); // underflow
+			for (unsigned int i = 0 ; i < MatrixStack::CAPACITY + 2 ; i++)
+			{
+				cb.pushMatrix(); // the last two overflow
+				cb.translate(t);
+			}
+			cb.popMatrix();
+			cb.popMatrix();
+			cb.front_color(0xFFFF0000);
+			cb.drawLine(a, b);
+			for (unsigned int i = 0 ; i < 31 ; i++)
+				cb.popMatrix(); // the last one underflows
+			cb.front_color(0xFF00FF00);
+			cb.drawLine(a, b);
+		});
+		CHECK(drawnPixels(expected) > 0);
+		CHECK(pixels == expected);
+	});
+
+	test("math: rotations around an axis match matrix products", [] {
+		Mat4x4f base;
+		setTransform(base, Vector4f(0.5f, -1, 2), Vector4f(0.1f, 0.7f, -0.3f, 0.6f), Vector4f(2, 1, 0.5f));
+		for (float ang : { 0.0f, 0.3f, -1.2f, 2.5f })
+		{
+			const float c = cosf(ang), s = sinf(ang);
+			Mat4x4f m = base;
+			CHECK(nearlyEqual(rotateAroundX(m, ang),
+					base * Mat4x4f(1, 0, 0, 0, 0, c, s, 0, 0, -s, c, 0, 0, 0, 0, 1)));
+			m = base;
+			CHECK(nearlyEqual(rotateAroundY(m, ang),
+					base * Mat4x4f(c, 0, -s, 0, 0, 1, 0, 0, s, 0, c, 0, 0, 0, 0, 1)));
+			m = base;
+			CHECK(nearlyEqual(rotateAroundZ(m, ang),
+					base * Mat4x4f(c, s, 0, 0, -s, c, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1)));
+		}
+	});
+
+	test("math: Euler angles, quaternions and TRS match composed rotations", [] {
+		static const float ANGLES[][3] = {
+			{ 0, 0, 0 }, { 0.5f, 0, 0 }, { 0, -0.8f, 0 }, { 0, 0, 1.9f },
+			{ 0.3f, -1.1f, 2.4f }, { -2.9f, 1.5f, 0.2f }, { 1.2f, 3.0f, -0.7f } };
+		const Vector4f t(0.5f, -1.5f, 2), s(2, 0.5f, -1);
+		for (const float* a : ANGLES)
+		{
+			Mat4x4f composed = Mat4x4f::IDENTITY;
+			rotateAroundZ(rotateAroundY(rotateAroundX(composed, a[0]), a[1]), a[2]);
+
+			Mat4x4f m;
+			CHECK(nearlyEqual(setRotation(m, a[0], a[1], a[2]), composed));
+			const Vector4f q = euler2quaternion(a[0], a[1], a[2]);
+			CHECK(fabsf(q.dot(q) - 1) < 1e-5f);
+			CHECK(nearlyEqual(setRotation(m, q), composed));
+			CHECK(nearlyEqual(setRotation(m, Vector4f(q.x() * 3, q.y() * 3, q.z() * 3, q.w() * 3)), composed));
+			m = Mat4x4f::IDENTITY;
+			CHECK(nearlyEqual(rotate(m, a[0], a[1], a[2]), composed));
+
+			Mat4x4f trs = Mat4x4f::IDENTITY;
+			translate(trs, t);
+			trs *= composed;
+			scale(trs, s.x(), s.y(), s.z());
+			CHECK(nearlyEqual(setTransform(m, t, q, s), trs));
+		}
+	});
+
+	test("math: renderer rotation ops match composed rotations", [] {
+		auto draw = [](CommandBuffer& cb) {
+			for (int i = 0 ; i < 8 ; i++)
+				cb.drawLine({-0.5f, i / 8.f - 0.5f, 0.25f}, {0.5f, 0.5f - i / 8.f, -0.25f});
+		};
+		auto composed = [&](bool trs) {
+			return render([&](CommandBuffer& cb) {
+				cb.clear();
+				if (trs) cb.translate({0.1f, -0.2f, 0});
+				cb.rotateX(0.4f);
+				cb.rotateY(-0.6f);
+				cb.rotateZ(1.1f);
+				if (trs) cb.scale({1.5f, 0.75f, 1});
+				draw(cb);
+			});
+		};
+		const vector<unsigned int> rotated = composed(false), transformed = composed(true);
+		CHECK(drawnPixels(rotated) > 0);
+		CHECK(render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.setRotation(0.4f, -0.6f, 1.1f);
+			draw(cb);
+		}) == rotated);
+		CHECK(render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.setRotation(euler2quaternion(0.4f, -0.6f, 1.1f));
+			draw(cb);
+		}) == rotated);
+		CHECK(render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.setTransform({0.1f, -0.2f, 0}, euler2quaternion(0.4f, -0.6f, 1.1f), {1.5f, 0.75f, 1});
+			draw(cb);
+		}) == transformed);
+	});
+}
+
+/** Vertices of a star around the origin, for batch drawing tests */
+struct StarVertices
+{
+	static constexpr unsigned int COUNT = 12;
+	float xyz[COUNT * 3];
+	unsigned int colors[COUNT];
+
+	StarVertices(void)
+	{
+		for (unsigned int i = 0 ; i < COUNT ; i++)
+		{
+			const float r = (i % 2) ? 0.35f : 0.9f, ang = i * 0.5236f + 0.1f;
+			xyz[i*3] = r * cosf(ang);
+			xyz[i*3 + 1] = r * sinf(ang);
+			xyz[i*3 + 2] = (i % 3) * 0.25f - 0.25f;
+			colors[i] = 0xFF000000 | (i * 0x150B07 + 0x402010);
+		}
+	}
+};
+
+static const RendererDrawMode DRAW_MODES[] = { POINTS, BIG_POINTS, LINES, LINE_STRIP,
+												LINE_LOOP, TRIANGLES };
+
+void testRenderer(void)
+{
+	test("renderer: flush resolves supersampling set by a command buffer", [] {
+		Renderer renderer(WIDTH, HEIGHT);
+		renderer.clear();
+		renderer.flush();
+		CommandBuffer cb;
+		cb.setSupersampling(2);
+		cb.drawLine({-1, -1, 0}, {1, 1, 0});
+		CHECK(renderer.submit(cb) == 0);
+		renderer.flush();
+		vector<unsigned int> pixels(WIDTH * HEIGHT);
+		renderer.bufferCopy(pixels.data());
+		renderer.terminate();
+		int drawn = 0;
+		for (unsigned int p : pixels) drawn += p != 0xFF000000;
+		CHECK(drawn > 0);
+	});
+
+	test("renderer: staged operations are rejected together", [] {
+		Renderer renderer(WIDTH, HEIGHT);
+		renderer.clear();
+		renderer.flush();
+		renderer.setBatchSize(1000);
+		renderer.setQueueCapacity(100, QUEUE_FAIL);
+		int rejected = 0;
+		for (int i = 0 ; i < 60 ; i++)
+			rejected += renderer.drawRawPoint(ipair(i, i / 2));
+		CHECK(rejected == 0);
+		renderer.setQueueCapacity(30, QUEUE_FAIL);
+		CHECK(renderer.submit() == 1);
+		renderer.flush();
+		vector<unsigned int> pixels(WIDTH * HEIGHT);
+		renderer.bufferCopy(pixels.data());
+		renderer.terminate();
+		int drawn = 0;
+		for (unsigned int p : pixels) drawn += p != 0xFF000000;
+		CHECK(drawn == 0);
+	});
+
+	test("renderer: failed image saves are reported", [] {
+		Renderer renderer(WIDTH, HEIGHT);
+		renderer.clear();
+		CHECK(renderer.saveImage(nullptr) == 1);
+		CHECK(renderer.saveImage("/nonexistent/derplotter.png") == 0);
+		CHECK(renderer.saveImage("/nonexistent/derplotter.qoi", IMAGE_QOI) == 0);
+		renderer.flush();
+		CHECK(renderer.failedSaves() == 2);
+		CHECK(renderer.failedSaves() == 0);
+		renderer.terminate();
+	});
+
+	test("renderer: dirty regions hold every changed pixel", [] {
+		Renderer renderer(WIDTH, HEIGHT);
+		renderer.clear();
+		renderer.flush();
+		vector<unsigned int> copy(WIDTH * HEIGHT, 0x00ABCDEF), pixels(WIDTH * HEIGHT);
+		vector<Region2i> regions;
+		CHECK(renderer.copyDirtyRegions(copy.data(), &regions) == 1);
+		renderer.bufferCopy(pixels.data());
+		CHECK(copy == pixels);
+		CHECK(renderer.copyDirtyRegions(copy.data(), &regions) == 1);
+		CHECK(regions.empty());
+
+		// pixels outside of the dirty regions keep the mark
+		std::fill(copy.begin(), copy.end(), 0x00ABCDEF);
+		renderer.front_color(0xFFFF0000);
+		renderer.drawRawLine(ipair(10, 5), ipair(30, 12));
+		renderer.drawRawPoint(ipair(80, 50));
+		renderer.flush();
+		CHECK(renderer.copyDirtyRegions(copy.data(), &regions) == 1);
+		renderer.bufferCopy(pixels.data());
+		CHECK(!regions.empty());
+		int area = 0, outside = 0, missed = 0;
+		for (const Region2i& r : regions)
+		{
+			area += r.area();
+			outside += !r.fitsIn(WIDTH, HEIGHT);
+		}
+		for (int i = 0 ; i < WIDTH * HEIGHT ; i++)
+			missed += pixels[i] != 0xFF000000 && copy[i] != pixels[i];
+		CHECK(outside == 0);
+		CHECK(missed == 0);
+		CHECK(area < WIDTH * HEIGHT / 4);
+		CHECK(std::count(copy.begin(), copy.end(), 0x00ABCDEF) == WIDTH * HEIGHT - area);
+
+		// clearing what was drawn dirties the same pixels again
+		renderer.clearDrawn();
+		renderer.flush();
+		CHECK(renderer.copyDirtyRegions(copy.data(), &regions) == 1);
+		renderer.bufferCopy(pixels.data());
+		renderer.terminate();
+		CHECK(std::count(pixels.begin(), pixels.end(), 0xFF000000) == WIDTH * HEIGHT);
+		missed = 0;
+		for (int i = 0 ; i < WIDTH * HEIGHT ; i++)
+			missed += copy[i] != 0x00ABCDEF && copy[i] != 0xFF000000;
+		CHECK(missed == 0);
+	});
+
+	test("renderer: vertex buffers draw as the same arrays", [] {
+		const StarVertices star;
+		for (RendererDrawMode mode : DRAW_MODES)
+			for (bool colored : { false, true })
+			{
+				const vector<unsigned int> expected = render([&](CommandBuffer& cb) {
+					cb.clear();
+					cb.front_color(0xFF40C0FF);
+					if (colored) cb.drawArrays(mode, star.xyz + 3 * 2, star.colors + 2, 9);
+					else cb.drawArrays(mode, star.xyz + 3 * 2, 9);
+				});
+				const vector<unsigned int> pixels = render([&](CommandBuffer& cb) {
+					cb.clear();
+					cb.front_color(0xFF40C0FF);
+					const unsigned int buffer = cb.createBuffer();
+					if (colored) cb.uploadVertices(buffer, star.xyz, star.colors, star.COUNT);
+					else cb.uploadVertices(buffer, star.xyz, star.COUNT);
+					cb.drawBuffer(buffer, mode, 2, 9);
+					cb.deleteBuffer(buffer);
+				});
+				CHECK(drawnPixels(expected) > 0);
+				CHECK(pixels == expected);
+			}
+
+		// ranges past the end and buffers never uploaded draw nothing
+		CHECK(drawnPixels(render([&](CommandBuffer& cb) {
+			cb.clear();
+			const unsigned int buffer = cb.createBuffer(), empty = cb.createBuffer();
+			cb.uploadVertices(buffer, star.xyz, star.COUNT);
+			cb.drawBuffer(buffer, LINE_STRIP, 4, star.COUNT - 3);
+			cb.drawBuffer(empty, LINE_STRIP, 0, 2);
+			cb.deleteBuffer(buffer);
+			cb.drawBuffer(buffer, LINE_STRIP, 0, 2);
+		})) == 0);
+	});
+
+	test("renderer: indexed vertices draw as the same arrays", [] {
+		const StarVertices star;
+		constexpr unsigned int COUNT = 18;
+		unsigned int indices[COUNT], colors[COUNT];
+		float xyz[COUNT * 3];
+		for (unsigned int k = 0 ; k < COUNT ; k++)
+		{
+			indices[k] = (k * 5 + k / 3) % star.COUNT; // shared by several primitives
+			memcpy(xyz + k * 3, star.xyz + indices[k] * 3, sizeof(float) * 3);
+			colors[k] = star.colors[indices[k]];
+		}
+		for (RendererDrawMode mode : DRAW_MODES)
+			for (bool colored : { false, true })
+			{
+				const vector<unsigned int> expected = render([&](CommandBuffer& cb) {
+					cb.clear();
+					cb.front_color(0xFF40C0FF);
+					if (colored) cb.drawArrays(mode, xyz, colors, COUNT);
+					else cb.drawArrays(mode, xyz, COUNT);
+				});
+				const vector<unsigned int> elements = render([&](CommandBuffer& cb) {
+					cb.clear();
+					cb.front_color(0xFF40C0FF);
+					if (colored) cb.drawElements(mode, star.xyz, star.colors, star.COUNT, indices, COUNT);
+					else cb.drawElements(mode, star.xyz, star.COUNT, indices, COUNT);
+				});
+				const vector<unsigned int> buffer_elements = render([&](CommandBuffer& cb) {
+					cb.clear();
+					cb.front_color(0xFF40C0FF);
+					const unsigned int buffer = cb.createBuffer();
+					if (colored) cb.uploadVertices(buffer, star.xyz, star.colors, star.COUNT);
+					else cb.uploadVertices(buffer, star.xyz, star.COUNT);
+					cb.drawBufferElements(buffer, mode, indices, COUNT);
+					cb.deleteBuffer(buffer);
+				});
+				CHECK(drawnPixels(expected) > 0);
+				CHECK(elements == expected);
+				CHECK(buffer_elements == expected);
+			}
+
+		// an index out of range draws nothing
+		indices[COUNT - 1] = star.COUNT;
+		CHECK(drawnPixels(render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.drawElements(LINES, star.xyz, star.COUNT, indices, COUNT);
+			const unsigned int buffer = cb.createBuffer();
+			cb.uploadVertices(buffer, star.xyz, star.COUNT);
+			cb.drawBufferElements(buffer, LINES, indices, COUNT);
+			cb.deleteBuffer(buffer);
+		})) == 0);
+	});
+
+	test("renderer: vertices on the edges of a culled batch are clipped as without culling", [] {
+		// on the right and bottom edges, which map to just past the viewport
+		const float xyz[] = { 1, 0.5f, 0, 1, -1, 0, -0.5f, -1, 0, 0, 0, 0 };
+		const Region2i viewport(0, 48, 0, 32);
+		for (RendererDrawMode mode : { POINTS, BIG_POINTS, LINE_LOOP, TRIANGLES })
+		{
+			auto draw = [&](bool bounded) {
+				return render([&](CommandBuffer& cb) {
+					cb.clear();
+					cb.setViewPort(viewport);
+					if (bounded) cb.drawArrays(mode, xyz, 4, Bounds::box(xyz, 4));
+					else cb.drawArrays(mode, xyz, 4);
+				});
+			};
+			const vector<unsigned int> culled = draw(true);
+			CHECK(drawnPixels(culled) > 0);
+			CHECK(culled == draw(false));
+			if (mode != POINTS && mode != BIG_POINTS) continue;
+
+			// so points there are not drawn outside of the viewport
+			const int margin = (mode == BIG_POINTS) ? 1 : 0;
+			int outside = 0;
+			for (int y = 0 ; y < HEIGHT ; y++)
+				for (int x = 0 ; x < WIDTH ; x++)
+					outside += (x >= viewport.getMaxX() + margin
+								|| y >= viewport.getMaxY() + margin)
+								&& culled[y * WIDTH + x] != 0xFF000000;
+			CHECK(outside == 0);
+		}
+	});
+	test("renderer: shaded lines end with the colors of their vertices", [] {
+		static const float ENDS[][4] = {
+			{ -0.8f, -0.1f, 0.7f, 0.2f }, { 0.7f, 0.2f, -0.8f, -0.1f },   // X-major
+			{ -0.1f, -0.8f, 0.2f, 0.7f }, { 0.2f, 0.7f, -0.1f, -0.8f },   // Y-major
+			{ -0.5f, 0.5f, 0.5f, -0.5f }, { 0.3f, -0.6f, 0.3f, 0.6f } };  // and vertical
+		const unsigned int colors[2] = { 0xFFFF2000, 0x800010FF };
+		const Region2i viewport(0, WIDTH, 0, HEIGHT);
+		for (const float* e : ENDS)
+		{
+			const float xyz[6] = { e[0], e[1], 0, e[2], e[3], 0 };
+			const vector<unsigned int> pixels = render([&](CommandBuffer& cb) {
+				cb.clear();
+				cb.drawArrays(LINES, xyz, colors, 2);
+			});
+			int x0, y0, x1, y1;
+			viewport.posOf(e[0], e[1], x0, y0);
+			viewport.posOf(e[2], e[3], x1, y1);
+			CHECK(pixels[y0 * WIDTH + x0] == colors[0]);
+			CHECK(pixels[y1 * WIDTH + x1] == colors[1]);
+			vector<unsigned int> shades(pixels);
+			std::sort(shades.begin(), shades.end());
+			CHECK(std::unique(shades.begin(), shades.end()) - shades.begin() > 8);
+		}
+	});
+
+	test("renderer: nothing is drawn outside of the scissor region", [] {
+		const StarVertices star;
+		const Region2i scissor(20, 61, 10, 41);
+		auto drawAll = [&](CommandBuffer& cb) {
+			cb.drawRawLine(ipair(0, 0), ipair(WIDTH - 1, HEIGHT - 1));
+			cb.drawRawLine(ipair(0, 25), ipair(WIDTH - 1, 25));
+			cb.drawRawBigPoint(ipair(20, 10));
+			cb.drawRawBigPoint(ipair(60, 40));
+			cb.drawLine({-1.5f, 0.3f, 0}, {1.5f, -0.2f, 0});
+			cb.drawBigPoint({-0.58f, 0.37f, 0});
+			cb.drawArrays(TRIANGLES, star.xyz, star.colors, star.COUNT);
+			cb.drawArrays(LINE_LOOP, star.xyz, star.COUNT);
+			cb.drawGrid(-1, 1, -1, 1, 0.25f, 0.25f);
+			cb.drawText({-0.6f, 0.45f, 0}, "scissor\ntest");
+		};
+		const vector<unsigned int> pixels = render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.setScissor(scissor);
+			drawAll(cb);
+		});
+		int inside = 0, outside = 0;
+		for (int y = 0 ; y < HEIGHT ; y++)
+			for (int x = 0 ; x < WIDTH ; x++)
+			{
+				const bool in = x >= scissor.getMinX() && x < scissor.getMaxX()
+								&& y >= scissor.getMinY() && y < scissor.getMaxY();
+				(in ? inside : outside) += pixels[y * WIDTH + x] != 0xFF000000;
+			}
+		CHECK(inside > 0);
+		CHECK(outside == 0);
+
+		// neither the clears nor the primitives after disabling it are restricted
+		const vector<unsigned int> unrestricted = render([&](CommandBuffer& cb) {
+			cb.setScissor(scissor);
+			cb.clear_color(0xFF102030);
+			cb.clear();
+			cb.disableScissor();
+			drawAll(cb);
+		});
+		const vector<unsigned int> plain = render([&](CommandBuffer& cb) {
+			cb.clear_color(0xFF102030);
+			cb.clear();
+			drawAll(cb);
+		});
+		CHECK(unrestricted == plain);
+		CHECK(drawnPixels(plain) == WIDTH * HEIGHT);
+		CHECK(plain[0] != 0xFF102030 && plain[WIDTH * HEIGHT - 1] != 0xFF102030);
+	});
+
+	test("renderer: text is drawn within its measured box", [] {
+		const char* text = "Hi,\nplot #42!";
+		const Vector4f position(-0.5f, 0.25f, 0);
+		int x0, y0, w, h;
+		Region2i(0, WIDTH, 0, HEIGHT).posOf(position.x(), position.y(), x0, y0);
+		Font::builtin().measure(text, w, h);
+		CHECK(w == 9 * 6 && h == 2 * 8);
+		const vector<unsigned int> pixels = render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.front_color(0xFFFFFF00);
+			cb.drawText(position, text);
+		});
+		int inside = 0, outside = 0;
+		for (int y = 0 ; y < HEIGHT ; y++)
+			for (int x = 0 ; x < WIDTH ; x++)
+			{
+				const bool in = x >= x0 && x < x0 + w && y >= y0 && y < y0 + h;
+				(in ? inside : outside) += pixels[y * WIDTH + x] != 0xFF000000;
+			}
+		CHECK(inside > 0);
+		CHECK(outside == 0);
+
+		// labels are placed at their offsets, in their own colors
+		const TextLabel label = { position, text, 0, 0 };
+		const unsigned int color = 0xFFFFFF00;
+		CHECK(render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.drawText(&label, 1, &color);
+		}) == pixels);
+		const TextLabel moved = { Vector4f(-0.5f - 12.f / WIDTH, 0.25f, 0), text, 6, 0 };
+		CHECK(render([&](CommandBuffer& cb) {
+			cb.clear();
+			cb.front_color(0xFFFFFF00);
+			cb.drawText(&moved, 1);
+		}) == pixels);
+	});
+
+	test("renderer: text of an opaque font fills its cells", [] {
+		// two glyphs, 'A' and 'B', which cover their whole cells
+		const vector<unsigned char> atlas(8 * 6, 255);
+		const Vector4f position(0, 0, 0);
+		int x0, y0;
+		Region2i(0, WIDTH, 0, HEIGHT).posOf(position.x(), position.y(), x0, y0);
+		const vector<unsigned int> pixels = render([&](CommandBuffer& cb) {
+			cb.clear();
+			const unsigned int font = cb.createFont(atlas.data(), 8, 6, 4, 6, 'A');
+			CHECK(font != 0);
+			cb.front_color(0xFF00FF80);
+			cb.drawText(position, "AB\nB", font);
+			cb.deleteFont(font);
+		});
+		int wrong = 0;
+		for (int y = 0 ; y < HEIGHT ; y++)
+			for (int x = 0 ; x < WIDTH ; x++)
+			{
+				const bool covered = (y >= y0 && y < y0 + 6 && x >= x0 && x < x0 + 8)
+									|| (y >= y0 + 6 && y < y0 + 12 && x >= x0 && x < x0 + 4);
+				wrong += pixels[y * WIDTH + x] != (covered ? 0xFF00FF80 : 0xFF000000);
+			}
+		CHECK(wrong == 0);
+	});
+}
+
+void testDisplayBuffer(void)
+{
+	test("display buffer: invalid pitches are rejected", [] {
+		vector<unsigned int> pixels(64 * 64);
+		CHECK(!DisplayBuffer(64, 64, pixels.data(), 64 * 4 + 2, PIXEL_ARGB8888));
+		CHECK(!DisplayBuffer(64, 64, pixels.data(), 63 * 4, PIXEL_ARGB8888));
+		CHECK(!DisplayBuffer(32, 64, pixels.data(), 65, PIXEL_RGB565));
+		CHECK(!!DisplayBuffer(32, 64, pixels.data(), 66, PIXEL_RGB565));
+		CHECK(!!DisplayBuffer(63, 64, pixels.data(), 64 * 4, PIXEL_ARGB8888));
+
+		Renderer renderer(64, 64, pixels.data(), 64 * 4 + 2);
+		CHECK(!renderer);
+		CHECK(renderer.clear() == 1);
+		renderer.flush();
+		renderer.terminate();
+	});
+}
+
+/** \return whether the writes of \b kernel and \b reference over copies of the
+ * same background give the same bytes */
+template <typename A, typename B>
+bool sameWrites(const vector<unsigned char>& background, A kernel, B reference)
+{
+	vector<unsigned char> a = background, b = background;
+	kernel(a.data());
+	reference(b.data());
+	return a == b;
+}
+
+/** Blends an ARGB color over another, one channel at a time */
+unsigned int blendReference(BlendMode blend, unsigned int src, unsigned int dst)
+{
+	const unsigned int a = src >> 24;
+	unsigned int out = 0;
+	for (int shift = 0 ; shift < 32 ; shift += 8)
+	{
+		const unsigned int s = (shift == 24) ? 255 : (src >> shift) & 0xFF;
+		const unsigned int d = (dst >> shift) & 0xFF;
+		unsigned int c;
+		switch (blend)
+		{
+			case BLEND_ALPHA: c = (s * a + d * (255 - a) + 127) / 255; break;
+			case BLEND_ADD: c = std::min(255u, d + (s * a + 127) / 255); break;
+			default: c = (src >> shift) & 0xFF;
+		}
+		out |= c << shift;
+	}
+	return out;
+}
+
+void testPlot(void)
+{
+	test("plot: native grid matches separate lines", [] {
+		for (BlendMode blend : { BLEND_REPLACE, BLEND_ALPHA })
+		{
+			DisplayBuffer grid_buffer(WIDTH * 3, HEIGHT * 3), lines_buffer(WIDTH * 3, HEIGHT * 3);
+			RendererProgram grid(grid_buffer), lines(lines_buffer);
+			for (RendererProgram* program : { &grid, &lines })
+			{
+				program->raw_clear();
+				program->front_color = 0x80FF8040;
+				program->setBlendMode(blend);
+			}
+			CHECK(grid.drawGrid(-1, 1, -1, 1, 0.125f, 0.125f) == 0);
+			for (int k = -8 ; k <= 8 ; k++)
+			{
+				lines.drawLine(Vector4f(k * 0.125f, -1, 0, 1), Vector4f(k * 0.125f, 1, 0, 1));
+				lines.drawLine(Vector4f(-1, k * 0.125f, 0, 1), Vector4f(1, k * 0.125f, 0, 1));
+			}
+			const unsigned int* pixels = (const unsigned int*)grid_buffer.pixels();
+			const size_t count = (size_t)grid_buffer.getWidth() * grid_buffer.getHeight();
+			CHECK(count - std::count(pixels, pixels + count, 0xFF000000) > 0);
+			CHECK(memcmp(grid_buffer.pixels(), lines_buffer.pixels(), count * 4) == 0);
+		}
+	});
+
+	test("plot: kernels match pixel by pixel plots", [] {
+		static const unsigned int COLORS[4] = { 0xFFFF8040, 0x80FF8040, 0x00123456, 0xC0204080 };
+		constexpr int W = 40, H = 24;
+		for (int f = 0 ; f < PIXEL_FORMAT_COUNT ; f++)
+			for (int b = 0 ; b < BLEND_MODE_COUNT ; b++)
+			{
+				const RasterKernels& k = rasterKernels((PixelFormat)f, (BlendMode)b);
+				const int pitch = W * bytesPerPixel((PixelFormat)f) + 4; // padded rows
+				vector<unsigned char> background(pitch * H);
+				unsigned int seed = 1;
+				for (unsigned char& c : background)
+				{
+					seed = seed * 1103515245u + 12345u;
+					c = seed >> 16;
+				}
+				const int xs[4] = { 1, 7, 8, 30 };
+				unsigned int colors[W];
+				for (int i = 0 ; i < W ; i++) colors[i] = COLORS[i % 4] + i * 0x010203;
+
+				for (unsigned int color : COLORS)
+				{
+					const ShadeColor from = ShadeColor::of(color), to = ShadeColor::of(0xFF00FFFF);
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.span(p + 3 * pitch, 2, 30, color);
+					}, [&](unsigned char* p) {
+						for (int x = 2 ; x < 32 ; x++) k.plot(p + 3 * pitch, x, color);
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.column(p, pitch, 5, 1, 20, color);
+					}, [&](unsigned char* p) {
+						for (int y = 1 ; y < 21 ; y++) k.plot(p + y * pitch, 5, color);
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.columns(p, pitch, xs, 4, 2, 15, color);
+					}, [&](unsigned char* p) {
+						for (int y = 2 ; y < 17 ; y++)
+							for (int x : xs) k.plot(p + y * pitch, x, color);
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.lineX(p, pitch, 1, 38, (2 << 16) + 0x8000, (18 << 16) / 37, color);
+					}, [&](unsigned char* p) {
+						long long y = (2 << 16) + 0x8000;
+						for (int x = 1 ; x <= 38 ; x++, y += (18 << 16) / 37)
+							k.plot(p + (y >> 16) * pitch, x, color);
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.lineY(p, pitch, 1, 22, 3 << 16, (30 << 16) / 21, color);
+					}, [&](unsigned char* p) {
+						long long x = 3 << 16;
+						for (int y = 1 ; y <= 22 ; y++, x += (30 << 16) / 21)
+							k.plot(p + y * pitch, (int)(x >> 16), color);
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.shadedSpan(p + 4 * pitch, 1, 35, from, ShadeColor::step(from, to, 34));
+					}, [&](unsigned char* p) {
+						ShadeColor c = from;
+						for (int x = 1 ; x < 36 ; x++, c.advance(ShadeColor::step(from, to, 34)))
+							k.plot(p + 4 * pitch, x, c.argb());
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.shadedLineX(p, pitch, 0, 39, 20 << 16, -(16 << 16) / 39,
+									from, ShadeColor::step(from, to, 39));
+					}, [&](unsigned char* p) {
+						long long y = 20 << 16;
+						ShadeColor c = from;
+						for (int x = 0 ; x <= 39 ; x++, y -= (16 << 16) / 39)
+						{
+							k.plot(p + (y >> 16) * pitch, x, c.argb());
+							c.advance(ShadeColor::step(from, to, 39));
+						}
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.shadedLineY(p, pitch, 0, 23, 36 << 16, -(30 << 16) / 23,
+									from, ShadeColor::step(from, to, 23));
+					}, [&](unsigned char* p) {
+						long long x = 36 << 16;
+						ShadeColor c = from;
+						for (int y = 0 ; y <= 23 ; y++, x -= (30 << 16) / 23)
+						{
+							k.plot(p + y * pitch, (int)(x >> 16), c.argb());
+							c.advance(ShadeColor::step(from, to, 23));
+						}
+					}));
+					CHECK(sameWrites(background, [&](unsigned char* p) {
+						k.colorSpan(p + 5 * pitch, 0, W, colors);
+					}, [&](unsigned char* p) {
+						for (int x = 0 ; x < W ; x++) k.plot(p + 5 * pitch, x, colors[x]);
+					}));
+				}
+
+				// and the plots themselves blend as each channel would
+				if (f != PIXEL_ARGB8888) continue;
+				int wrong = 0;
+				for (unsigned int color : COLORS)
+					for (int x = 0 ; x < W ; x++)
+					{
+						unsigned int pixel;
+						memcpy(&pixel, &background[x * 4], 4);
+						const unsigned int expected = blendReference((BlendMode)b, color, pixel);
+						k.plot((unsigned char*)&pixel, 0, color);
+						wrong += pixel != expected;
+					}
+				CHECK(wrong == 0);
+			}
+	});
+}
+
+/** Reads the bits of a DEFLATE stream, least significant bit first */
+struct BitReader
+{
+	const unsigned char* data;
+	size_t size, pos;
+	unsigned int acc;
+	int nbits;
+	bool overrun;
+
+	BitReader(const unsigned char* data, size_t size)
+		:	data(data), size(size), pos(0), acc(0), nbits(0), overrun(false) {}
+
+	int bits(int n)
+	{
+		while (nbits < n)
+		{
+			if (pos == size)
+			{
+				overrun = true;
+				return 0;
+			}
+			acc |= (unsigned int)data[pos++] << nbits;
+			nbits += 8;
+		}
+		const int v = acc & ((1u << n) - 1);
+		acc >>= n;
+		nbits -= n;
+		return v;
+	}
+};
+
+/** A canonical Huffman code, decoded one bit at a time */
+struct Huffman
+{
+	short count[16], symbol[288];
+
+	void build(const unsigned char* lengths, int n)
+	{
+		short offs[16];
+		memset(count, 0, sizeof(count));
+		for (int i = 0 ; i < n ; i++) count[lengths[i]]++;
+		count[0] = 0;
+		offs[1] = 0;
+		for (int len = 1 ; len < 15 ; len++) offs[len+1] = offs[len] + count[len];
+		for (int i = 0 ; i < n ; i++)
+			if (lengths[i] != 0) symbol[offs[lengths[i]]++] = i;
+	}
+
+	int decode(BitReader& in) const
+	{
+		int code = 0, first = 0, index = 0;
+		for (int len = 1 ; len < 16 ; len++)
+		{
+			code |= in.bits(1);
+			if (code - count[len] < first) return symbol[index + (code - first)];
+			index += count[len];
+			first = (first + count[len]) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+};
+
+/** Decompresses a raw DEFLATE stream (stored, fixed and dynamic Huffman blocks).
+ * \return the number of bytes of \b data read, or 0 on error
+ */
+size_t inflate(const unsigned char* data, size_t size, vector<unsigned char>& out)
+{
+	static const short LEN_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23,
+		27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const short LEN_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const short DIST_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97,
+		129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+		16385, 24577 };
+	static const short DIST_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static const unsigned char ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4,
+		12, 3, 13, 2, 14, 1, 15 };
+
+	BitReader in(data, size);
+	int last;
+	do
+	{
+		last = in.bits(1);
+		const int type = in.bits(2);
+		if (type == 0)
+		{
+			in.acc = 0; // to the byte boundary
+			in.nbits = 0;
+			if (in.pos + 4 > size) return 0;
+			const unsigned int len = data[in.pos] | data[in.pos+1] << 8;
+			const unsigned int nlen = data[in.pos+2] | data[in.pos+3] << 8;
+			in.pos += 4;
+			if ((len ^ 0xFFFF) != nlen || in.pos + len > size) return 0;
+			out.insert(out.end(), data + in.pos, data + in.pos + len);
+			in.pos += len;
+			continue;
+		}
+
+		Huffman lit, dist;
+		unsigned char lengths[320];
+		if (type == 1)
+		{
+			for (int i = 0 ; i < 288 ; i++)
+				lengths[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8;
+			lit.build(lengths, 288);
+			for (int i = 0 ; i < 30 ; i++) lengths[i] = 5;
+			dist.build(lengths, 30);
+		}
+		else if (type == 2)
+		{
+			const int nlit = in.bits(5) + 257, ndist = in.bits(5) + 1, ncode = in.bits(4) + 4;
+			memset(lengths, 0, 19);
+			for (int i = 0 ; i < ncode ; i++) lengths[ORDER[i]] = in.bits(3);
+			Huffman lencode;
+			lencode.build(lengths, 19);
+			for (int i = 0 ; i < nlit + ndist ; )
+			{
+				int sym = lencode.decode(in), rep = 1, len = 0;
+				if (sym < 0) return 0;
+				if (sym < 16) len = sym;
+				else if (sym == 16)
+				{
+					if (i == 0) return 0;
+					len = lengths[i-1];
+					rep = 3 + in.bits(2);
+				}
+				else rep = (sym == 17) ? 3 + in.bits(3) : 11 + in.bits(7);
+				if (i + rep > nlit + ndist) return 0;
+				while (rep-- > 0) lengths[i++] = len;
+			}
+			lit.build(lengths, nlit);
+			dist.build(lengths + nlit, ndist);
+		}
+		else return 0;
+
+		for (;;)
+		{
+			int sym = lit.decode(in);
+			if (sym < 0 || in.overrun) return 0;
+			if (sym < 256)
+			{
+				out.push_back(sym);
+				continue;
+			}
+			if (sym == 256) break;
+			sym -= 257;
+			if (sym >= 29) return 0;
+			const int len = LEN_BASE[sym] + in.bits(LEN_EXTRA[sym]);
+			const int dsym = dist.decode(in);
+			if (dsym < 0 || dsym >= 30) return 0;
+			const size_t d = DIST_BASE[dsym] + in.bits(DIST_EXTRA[dsym]);
+			if (d > out.size()) return 0;
+			for (int k = 0 ; k < len ; k++) out.push_back(out[out.size() - d]);
+		}
+	} while (!last && !in.overrun);
+	return in.overrun ? 0 : in.pos;
+}
+
+unsigned int readU32BE(const unsigned char* p)
+{
+	return (unsigned int)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+/** Decodes an 8-bit RGBA PNG file made of a single zlib stream, checking all checksums.
+ * \param idats set to the number of IDAT chunks
+ * \return whether the file is valid
+ */
+bool decodePNG(const vector<unsigned char>& file, int& width, int& height,
+				vector<unsigned char>& rgba, int& idats)
+{
+	static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	if (file.size() < 8 || memcmp(file.data(), SIGNATURE, 8) != 0) return false;
+
+	vector<unsigned char> zlib;
+	bool ended = false;
+	idats = 0;
+	for (size_t pos = 8 ; !ended ; )
+	{
+		if (pos + 12 > file.size()) return false;
+		const unsigned int len = readU32BE(&file[pos]);
+		if (pos + 12 + len > file.size()) return false;
+		const unsigned char* type = &file[pos + 4];
+		const unsigned char* data = type + 4;
+
+		unsigned int crc = 0xFFFFFFFFu;
+		for (unsigned int i = 0 ; i < len + 4 ; i++)
+		{
+			crc ^= type[i];
+			for (int k = 0 ; k < 8 ; k++)
+				crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+		}
+		if (~crc != readU32BE(data + len)) return false;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (len != 13 || data[8] != 8 || data[9] != 6 || data[10] != 0
+					|| data[11] != 0 || data[12] != 0) return false;
+			width = readU32BE(data);
+			height = readU32BE(data + 4);
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			zlib.insert(zlib.end(), data, data + len);
+			idats++;
+		}
+		else if (memcmp(type, "IEND", 4) == 0) ended = true;
+		pos += 12 + len;
+	}
+
+	if (zlib.size() < 6 || (zlib[0] & 0x0F) != 8 || (zlib[1] & 0x20) != 0
+			|| (zlib[0] << 8 | zlib[1]) % 31 != 0) return false;
+	vector<unsigned char> raw;
+	const size_t used = inflate(zlib.data() + 2, zlib.size() - 2, raw);
+	if (used == 0 || used + 2 + 4 != zlib.size()) return false;
+
+	unsigned int a = 1, b = 0;
+	for (unsigned char c : raw)
+	{
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	if ((b << 16 | a) != readU32BE(&zlib[used + 2])) return false;
+
+	const size_t rowbytes = (size_t)width * 4;
+	if (raw.size() != (rowbytes + 1) * height) return false;
+	rgba.assign(rowbytes * height, 0);
+	for (int y = 0 ; y < height ; y++)
+	{
+		const unsigned char* in = &raw[y * (rowbytes + 1)];
+		unsigned char* cur = &rgba[y * rowbytes];
+		const unsigned char* prior = (y > 0) ? cur - rowbytes : nullptr;
+		for (size_t i = 0 ; i < rowbytes ; i++)
+		{
+			const int l = (i >= 4) ? cur[i-4] : 0;
+			const int u = prior ? prior[i] : 0;
+			const int ul = (prior && i >= 4) ? prior[i-4] : 0;
+			int pred;
+			switch (in[0])
+			{
+				case 0: pred = 0; break;
+				case 1: pred = l; break;
+				case 2: pred = u; break;
+				case 3: pred = (l + u) / 2; break;
+				case 4:
+				{
+					const int p = l + u - ul;
+					const int pa = abs(p - l), pb = abs(p - u), pc = abs(p - ul);
+					pred = (pa <= pb && pa <= pc) ? l : (pb <= pc) ? u : ul;
+					break;
+				}
+				default: return false;
+			}
+			cur[i] = in[1 + i] + pred;
+		}
+	}
+	return true;
+}
+
+/** Decodes a QOI file into RGBA bytes.
+ * \return whether the file is valid
+ */
+bool decodeQOI(const vector<unsigned char>& file, int& width, int& height,
+				vector<unsigned char>& rgba)
+{
+	if (file.size() < 14 + 8 || memcmp(file.data(), "qoif", 4) != 0) return false;
+	width = readU32BE(&file[4]);
+	height = readU32BE(&file[8]);
+	if (file[12] != 4) return false;
+
+	const size_t npixels = (size_t)width * height;
+	const size_t end = file.size() - 8;
+	rgba.clear();
+	unsigned char index[64][4] = {{0}};
+	unsigned char px[4] = {0, 0, 0, 255};
+	size_t pos = 14;
+	while (rgba.size() < npixels * 4)
+	{
+		if (pos >= end) return false;
+		const unsigned char op = file[pos++];
+		int run = 1;
+		if (op == 0xFE || op == 0xFF)
+		{
+			const int n = (op == 0xFE) ? 3 : 4;
+			if (pos + n > end) return false;
+			memcpy(px, &file[pos], n);
+			pos += n;
+		}
+		else if ((op >> 6) == 0) memcpy(px, index[op], 4);
+		else if ((op >> 6) == 1)
+		{
+			px[0] += ((op >> 4) & 3) - 2;
+			px[1] += ((op >> 2) & 3) - 2;
+			px[2] += (op & 3) - 2;
+		}
+		else if ((op >> 6) == 2)
+		{
+			if (pos >= end) return false;
+			const int vg = (op & 63) - 32;
+			const int rest = file[pos++];
+			px[0] += vg + (rest >> 4) - 8;
+			px[1] += vg;
+			px[2] += vg + (rest & 15) - 8;
+		}
+		else run = (op & 63) + 1;
+		memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) & 63], px, 4);
+		while (run-- > 0) rgba.insert(rgba.end(), px, px + 4);
+	}
+	static const unsigned char END_MARKER[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+	return rgba.size() == npixels * 4 && pos == end && memcmp(&file[end], END_MARKER, 8) == 0;
+}
+
+/** Fills an image with rows of runs, gradients, noise (with varying alpha) and
+ * repeated colors, so that every encoding path is used. */
+vector<unsigned int> testImage(int width, int height)
+{
+	static const unsigned int PALETTE[5] = { 0xFF102030, 0x80FFFFFF, 0xFF00FF00, 0x00000000, 0xFF123456 };
+	vector<unsigned int> pixels((size_t)width * height);
+	unsigned int seed = 12345;
+	for (int y = 0 ; y < height ; y++)
+		for (int x = 0 ; x < width ; x++)
+		{
+			unsigned int& p = pixels[(size_t)y * width + x];
+			seed = seed * 1103515245u + 12345u;
+			switch ((y / 3) % 4)
+			{
+				case 0: p = 0xFF204080; break;
+				case 1: p = 0xFF000000 | (x * 3 & 0xFF) << 16 | (y * 5 & 0xFF) << 8 | ((x + y) & 0xFF); break;
+				case 2: p = (seed >> 8) | ((seed & 0x10000) ? 0xFF000000 : 0); break;
+				default: p = PALETTE[x % 5];
+			}
+		}
+	return pixels;
+}
+
+/** \return whether the RGBA bytes hold the same colors as the ARGB pixels */
+bool sameColors(const vector<unsigned int>& argb, const vector<unsigned char>& rgba)
+{
+	if (rgba.size() != argb.size() * 4) return false;
+	for (size_t i = 0 ; i < argb.size() ; i++)
+	{
+		const unsigned int c = argb[i];
+		const unsigned char* p = &rgba[i * 4];
+		if (p[0] != (unsigned char)(c >> 16) || p[1] != (unsigned char)(c >> 8)
+				|| p[2] != (unsigned char)c || p[3] != (unsigned char)(c >> 24)) return false;
+	}
+	return true;
+}
+
+void testImageExport(void)
+{
+	static const ipair SIZES[] = { ipair(1, 1), ipair(37, 23), ipair(5, 70), ipair(300, 200) };
+
+	test("image export: PNG files decode to the source pixels", [] {
+		for (ipair size : SIZES)
+		{
+			vector<unsigned int> pixels = testImage(size.first, size.second);
+			DisplayBuffer buffer(size.first, size.second, pixels.data(), size.first * 4, PIXEL_ARGB8888);
+			for (int f = PNG_FILTER_NONE ; f <= PNG_FILTER_ADAPTIVE ; f++)
+			{
+				vector<unsigned char> file, rgba;
+				CHECK(image::encodePNG(buffer, file, (PngFilter)f, 4));
+				int w = 0, h = 0, idats = 0;
+				CHECK(decodePNG(file, w, h, rgba, idats));
+				CHECK(w == size.first && h == size.second);
+				CHECK(sameColors(pixels, rgba));
+				// rows are split into bands of at least 32 rows, one IDAT chunk each
+				CHECK(idats == std::min(std::max(size.second / 32, 1), 4));
+			}
+		}
+	});
+
+	test("image export: QOI files decode to the source pixels", [] {
+		for (ipair size : SIZES)
+		{
+			vector<unsigned int> pixels = testImage(size.first, size.second);
+			DisplayBuffer buffer(size.first, size.second, pixels.data(), size.first * 4, PIXEL_ARGB8888);
+			vector<unsigned char> file, rgba;
+			CHECK(image::encodeQOI(buffer, file));
+			int w = 0, h = 0;
+			CHECK(decodeQOI(file, w, h, rgba));
+			CHECK(w == size.first && h == size.second);
+			CHECK(sameColors(pixels, rgba));
+		}
+	});
+}
+
+void testWorkerPool(void)
+{
+	test("worker pool: every part runs once", [] {
+		WorkerPool pool;
+		for (unsigned int count : { 1u, 4u, 2u, 8u, 3u })
+			for (int run = 0 ; run < 100 ; run++)
+			{
+				vector<int> calls(count, 0);
+				pool.run(count, [&](unsigned int part) { calls[part]++; });
+				int wrong = 0;
+				for (int c : calls) wrong += c != 1;
+				CHECK(wrong == 0);
+			}
+		CHECK(pool.size() == 7);
+	});
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1) filter = argv[1];
+
+	testOptimizer();
+	testMath();
+	testRenderer();
+	testDisplayBuffer();
+	testPlot();
+	testImageExport();
+	testWorkerPool();
+
+	printf("%d test(s) failed\n", failed_tests);
+	return (failed_tests == 0) ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/** \file Trace.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+#include "Trace.h"
+
+#ifdef Derplotter_TRACE
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+using namespace derplot;
+
+namespace
+{
+	typedef std::chrono::steady_clock trace_clock;
+
+	const trace_clock::time_point epoch = trace_clock::now();
+
+	struct Event
+	{
+		const char* name;
+		const char* arg_name;
+		unsigned long long begin, duration;
+		long long arg;
+	};
+
+	// single producer ring buffer: only the owner thread writes events
+	struct ThreadRing
+	{
+		int tid;
+		std::atomic<const char*> name;
+		std::atomic<unsigned long long> head; // number of events ever recorded
+		std::atomic<unsigned long long> tail; // events before this one were cleared
+		Event events[trace::RING_CAPACITY];
+
+		ThreadRing(int tid)
+			:	tid(tid), name(nullptr), head(0), tail(0) {}
+	};
+
+	// rings are never deallocated, so that events outlive their threads;
+	// the ring of a finished thread is handed over to the next new thread,
+	// dropping the events of the finished thread
+	std::mutex registry_mutex;
+	std::vector<ThreadRing*> registry;
+	std::vector<ThreadRing*> free_rings;
+
+	struct LocalRing
+	{
+		ThreadRing* ring;
+
+		LocalRing(void) : ring(nullptr) {}
+		~LocalRing()
+		{
+			if (ring == nullptr) return;
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			free_rings.push_back(ring);
+		}
+	};
+
+	thread_local LocalRing local_ring;
+
+	ThreadRing& localRing(void)
+	{
+		if (local_ring.ring == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(registry_mutex);
+			if (free_rings.empty())
+			{
+				local_ring.ring = new ThreadRing(registry.size() + 1);
+				registry.push_back(local_ring.ring);
+			}
+			else
+			{
+				local_ring.ring = free_rings.back();
+				free_rings.pop_back();
+				// the events and name of the finished thread are not attributed to this one
+				ThreadRing& ring = *local_ring.ring;
+				ring.tail.store(ring.head.load(std::memory_order_relaxed),
+								std::memory_order_relaxed);
+				ring.name.store(nullptr, std::memory_order_release);
+			}
+		}
+		return *local_ring.ring;
+	}
+}
+
+unsigned long long trace::now(void)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				trace_clock::now() - epoch).count();
+}
+
+void trace::record(const char* name, unsigned long long begin, unsigned long long end,
+					const char* arg_name, long long arg)
+{
+	ThreadRing& ring = localRing();
+	const unsigned long long h = ring.head.load(std::memory_order_relaxed);
+	Event& e = ring.events[h % RING_CAPACITY];
+	e.name = name;
+	e.arg_name = arg_name;
+	e.begin = begin;
+	e.duration = (end > begin) ? end - begin : 0;
+	e.arg = arg;
+	ring.head.store(h + 1, std::memory_order_release);
+}
+
+void trace::setThreadName(const char* name)
+{
+	localRing().name.store(name, std::memory_order_release);
+}
+
+bool trace::dump(const char* path)
+{
+	FILE* f = fopen(path, "w");
+	if (f == nullptr) return false;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", f);
+	bool first = true;
+	for (const ThreadRing* ring : registry)
+	{
+		const char* name = ring->name.load(std::memory_order_acquire);
+		if (name != nullptr)
+		{
+			fprintf(f, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+					"\"args\":{\"name\":\"%s\"}}", first ? "" : ",", ring->tid, name);
+			first = false;
+		}
+
+		const unsigned long long head = ring->head.load(std::memory_order_acquire);
+		unsigned long long i = ring->tail.load(std::memory_order_relaxed);
+		if (head > RING_CAPACITY && i < head - RING_CAPACITY)
+			i = head - RING_CAPACITY; // older events were overwritten
+		for ( ; i < head ; i++)
+		{
+			const Event& e = ring->events[i % RING_CAPACITY];
+			fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+					"\"ts\":%.3f,\"dur\":%.3f", first ? "" : ",", e.name, ring->tid,
+					e.begin / 1000.0, e.duration / 1000.0);
+			if (e.arg_name != nullptr)
+				fprintf(f, ",\"args\":{\"%s\":%lld}", e.arg_name, e.arg);
+			fputc('}', f);
+			first = false;
+		}
+	}
+	fputs("\n]}\n", f);
+	return fclose(f) == 0;
+}
+
+void trace::clear(void)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (ThreadRing* ring : registry)
+		ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+trace::Span::Span(const char* name)
+:	name(name)
+,	begin(now())
+,	arg_name(nullptr)
+,	arg(0)
+{}
+
+trace::Span::~Span()
+{
+	record(this->name, this->begin, now(), this->arg_name, this->arg);
+}
+
+void trace::Span::setArg(const char* arg_name, long long arg)
+{
+	this->arg_name = arg_name;
+	this->arg = arg;
+}
+
+#else
+
+using namespace derplot;
+
+unsigned long long trace::now(void)
+{ return 0; }
+
+void trace::record(const char*, unsigned long long, unsigned long long, const char*, long long)
+{}
+
+void trace::setThreadName(const char*)
+{}
+
+bool trace::dump(const char*)
+{ return false; }
+
+void trace::clear(void)
+{}
+
+trace::Span::Span(const char* name)
+:	name(name), begin(0), arg_name(nullptr), arg(0)
+{}
+
+trace::Span::~Span()
+{}
+
+void trace::Span::setArg(const char* arg_name, long long arg)
+{
+	this->arg_name = arg_name;
+	this->arg = arg;
+}
+
+#endif
@@ -0,0 +1,105 @@
+/** \file Trace.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \namespace derplot::trace
+ *
+ * \brief Contains the event tracer of the library.
+ *
+ * The tracer records timestamped spans of activity (such as the batches of operations
+ * executed by the renderer thread, flushes, clears and waits) which can be saved in the
+ * Chrome trace event format, for viewing how the threads overlap in a trace viewer
+ * (such as <tt>chrome://tracing</tt> or Perfetto).
+ *
+ * Each thread records its events into its own ring buffer, without taking any locks.
+ * When a ring buffer is full, the oldest events of that thread are overwritten. The
+ * events of a finished thread are kept until a new thread takes over its ring buffer.
+ *
+ * Events are only recorded when the library is compiled with the \c Derplotter_TRACE
+ * macro defined. Otherwise, all functions do nothing and \c dump() fails.
+ */
+#pragma once
+
+namespace derplot
+{
+
+namespace trace
+{
+	/** Maximum number of events kept for each thread */
+	constexpr unsigned int RING_CAPACITY = 1 << 15;
+
+	/** \return the current time of the tracer's clock, in nanoseconds */
+	unsigned long long now(void);
+
+	/**
+	 * Records a span of activity of the caller thread.
+	 * \param name the name of the span, which must be a string with static storage
+	 * (such as a string literal)
+	 * \param begin the start time of the span, as given by \c now()
+	 * \param end the end time of the span, as given by \c now()
+	 * \param arg_name the name of an argument of the span (a string with static
+	 * storage), or \c nullptr if the span has no arguments
+	 * \param arg the value of the argument
+	 */
+	void record(const char* name, unsigned long long begin, unsigned long long end,
+				const char* arg_name = nullptr, long long arg = 0);
+
+	/**
+	 * Defines the name of the caller thread, as shown in the trace viewer.
+	 * \param name the name of the thread (a string with static storage)
+	 */
+	void setThreadName(const char* name);
+
+	/**
+	 * Saves all recorded events to a file in the Chrome trace event format. The
+	 * traced threads should be idle (for instance, after flushing the renderers),
+	 * otherwise events being recorded during the call may be corrupted.
+	 * \param path the path of the output file
+	 * \return whether the operation was successful
+	 */
+	bool dump(const char* path);
+
+	/** Discards all recorded events */
+	void clear(void);
+
+	/**
+	 * \brief Records a span from its construction to its destruction.
+	 */
+	class Span
+	{
+		const char* name;
+		unsigned long long begin;
+		const char* arg_name;
+		long long arg;
+
+		public:
+		/** Starts the span
+		 * \param name the name of the span (a string with static storage)
+		 */
+		explicit Span(const char* name);
+
+		/** Ends and records the span */
+		~Span();
+
+		Span(const Span& other) = delete;
+		Span& operator=(const Span& other) = delete;
+
+		/** Defines the argument recorded with the span */
+		void setArg(const char* arg_name, long long arg);
+	};
+};
+
+};
+
+#define DERPLOTTER_TRACE_CONCAT2(a, b) a##b
+#define DERPLOTTER_TRACE_CONCAT(a, b) DERPLOTTER_TRACE_CONCAT2(a, b)
+
+/** \def DERPLOTTER_TRACE_SCOPE(name)
+ * Records a span named \b name until the end of the enclosing scope, when compiled
+ * with \c Derplotter_TRACE . Otherwise, it expands to nothing.
+ */
+#ifdef Derplotter_TRACE
+#define DERPLOTTER_TRACE_SCOPE(name) \
+	derplot::trace::Span DERPLOTTER_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define DERPLOTTER_TRACE_SCOPE(name)
+#endif
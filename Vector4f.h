@@ -5,12 +5,17 @@
  * \class derplot::math::Vector4f
  * \brief This class defines a 4-dimensional vector of single precision
  * floating point values, used throughout the library.
+ *
+ * The components are 16-byte aligned, so that the arithmetic operations
+ * can be performed with SIMD instructions. The class is a literal type,
+ * so vectors can be built in constant expressions.
  */
 
 #pragma once
 
 #include <initializer_list>
 #include <array>
+#include "Simd.h"
 
 namespace derplot
 {
@@ -21,7 +26,7 @@ namespace math
 class Vector4f
 {
 private:
-	float v[4];
+	alignas(16) float v[4];
 public:
 	/**
 	 * Default Constructor
@@ -41,6 +46,11 @@ public:
 	constexpr Vector4f(Vector4f&& other):
 		v{other.v[0],other.v[1],other.v[2],other.v[3]}{}
 
+	/**
+	 * Copy assignment operator
+	 */
+	Vector4f& operator=(const Vector4f& other) = default;
+
 	/**
 	 * Initializer List constructor
 	 *
@@ -55,7 +65,8 @@ public:
 	 *
 	 * \b Warning: unsafe. Other constructors should be preferred
 	 */
-	Vector4f(const float* p_v);
+	Vector4f(const float* p_v)
+	: v{p_v[0], p_v[1], p_v[2], p_v[3]} {}
 
 	/**
 	 * Builds the vector using the given values of each dimension
@@ -68,14 +79,24 @@ public:
 	/**
 	 * Destructor
 	 */
-	~Vector4f(void);
+	~Vector4f(void) = default;
 
 	/**
 	 * const float * cast operator
 	 *
 	 * \return a const float pointer to the vector
 	 */
-	operator const float* (void) const;
+	constexpr operator const float* (void) const { return this->v; }
+
+	/**
+	 * \return a pointer to the 16-byte aligned components of the vector
+	 */
+	float* data(void) { return this->v; }
+
+	/**
+	 * \return a const pointer to the 16-byte aligned components of the vector
+	 */
+	constexpr const float* data(void) const { return this->v; }
 
 	/**
 	 * normalizes the vector
@@ -101,9 +122,10 @@ public:
 	 * performs a component-wise sum of the vectors,
 	 * including the W component!
 	 * \param other
-	 * \return a temporary vector object containing the result
+	 * \return the resulting vector
 	 */
-	const Vector4f& operator+(const Vector4f& other) const;
+	Vector4f operator+(const Vector4f& other) const
+	{ Vector4f vec(*this); vec += other; return vec; }
 	/**
 	 * performs a component-wise subtraction of the vectors,
 	 * including the W component!
@@ -115,15 +137,23 @@ public:
 	 * performs a component-wise subtraction of the vectors,
 	 * including the W component!
 	 * \param other
-	 * \return a temporary vector object containing the result
+	 * \return the resulting vector
 	 */
-	const Vector4f& operator-(const Vector4f& other) const;
+	Vector4f operator-(const Vector4f& other) const
+	{ Vector4f vec(*this); vec -= other; return vec; }
 	/**
 	 * Multiplies the vector with a scalar
 	 * \param fscalar
 	 * \return the vector itself
 	 */
 	Vector4f& operator*=(float fscalar);
+	/**
+	 * Multiplies the vector with a scalar
+	 * \param fscalar
+	 * \return the resulting vector
+	 */
+	Vector4f operator*(float fscalar) const
+	{ Vector4f vec(*this); vec *= fscalar; return vec; }
 
 	/**
 	 * Performs a component-wise multiplication with another vector
@@ -143,48 +173,107 @@ public:
 	 * Getter for the X component
 	 * \return the X component of the vector
 	 */
-	float& x(void);
+	float& x(void) { return this->v[0]; }
 	/**
 	 * Const getter for the X component
 	 * \return the X component of the vector
 	 */
-	float x(void) const;
+	constexpr float x(void) const { return this->v[0]; }
 
 	/**
 	 * Getter for the Y component
 	 * \return the Y component of the vector
 	 */
-	float& y(void);
+	float& y(void) { return this->v[1]; }
 	/**
 	 * Const getter for the Y component
 	 * \return the Y component of the vector
 	 */
-	float y(void) const;
+	constexpr float y(void) const { return this->v[1]; }
 
 	/**
 	 * Getter for the Z component
 	 * \return the Z component of the vector
 	 */
-	float& z(void);
+	float& z(void) { return this->v[2]; }
 	/**
 	 * Const getter for the Z component
 	 * \return the Z component of the vector
 	 */
-	float z(void) const;
+	constexpr float z(void) const { return this->v[2]; }
 
 	/**
 	 * Getter for the W component
 	 * \return the W component of the vector
 	 */
-	float& w(void);
+	float& w(void) { return this->v[3]; }
 	/**
 	 * Const getter for the W component
 	 * \return the W component of the vector
 	 */
-	float w(void) const;
+	constexpr float w(void) const { return this->v[3]; }
 
 };
 
+inline Vector4f::Vector4f(const std::initializer_list<float> & list)
+: Vector4f() // unset components keep the values of (0,0,0,1)
+{
+	int i = 0;
+	for (auto it = list.begin() ; it != list.end() && i < 4 ; it++, i++ )
+		v[i] = *it;
+}
+
+inline Vector4f& Vector4f::operator*=(const Vector4f& other)
+{
+	simd::store(this->v, simd::mul(simd::load(this->v), simd::load(other.v)));
+	return *this;
+}
+
+inline float Vector4f::dot(const Vector4f& other) const
+{
+	return
+		this->x() * other.x() + this->y() * other.y() +
+		this->z() * other.z() + this->w() * other.w();
+}
+
+inline Vector4f& Vector4f::operator+=(const Vector4f& other)
+{
+	simd::store(this->v, simd::add(simd::load(this->v), simd::load(other.v)));
+	return *this;
+}
+
+inline Vector4f& Vector4f::operator-=(const Vector4f& other)
+{
+	simd::store(this->v, simd::sub(simd::load(this->v), simd::load(other.v)));
+	return *this;
+}
+
+inline Vector4f& Vector4f::operator*=(float fscalar)
+{
+	simd::store(this->v, simd::mul(simd::load(this->v), simd::splat(fscalar)));
+	return *this;
+}
+
+inline Vector4f& Vector4f::normalize(void)
+{
+	float w = this->w();
+	this->v[0] /= w;
+	this->v[1] /= w;
+	this->v[2] /= w;
+	this->v[3] = 1.f;
+	return *this;
+}
+
+inline Vector4f& Vector4f::clamp(void)
+{
+	for (int i = 0 ; i < 4 ; i++)
+	{
+		if (v[i] < 0) v[i] = 0;
+		if (v[i] > 1) v[i] = 1;
+	}
+	return *this;
+}
+
 };
 
 };
@@ -0,0 +1,77 @@
+/** \file WorkerPool.cpp
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ */
+#include "WorkerPool.h"
+
+using namespace derplot;
+
+WorkerPool::WorkerPool(void)
+:	job(nullptr)
+,	generation(0)
+,	parts(0)
+,	pending(0)
+,	stopping(false)
+{}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+	this->wake.notify_all();
+	for (std::thread& t : this->threads)
+		t.join();
+}
+
+unsigned int WorkerPool::size(void) const
+{
+	return this->threads.size();
+}
+
+void WorkerPool::run(unsigned int count, const std::function<void(unsigned int)>& job)
+{
+	if (count == 0) return;
+	if (count > 1)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		// new threads skip the runs made before they were created
+		while (this->threads.size() < count - 1)
+			this->threads.emplace_back(&WorkerPool::loop, this,
+										(unsigned int)this->threads.size(), this->generation);
+		this->job = &job;
+		this->parts = this->pending = count - 1;
+		this->generation++;
+		lock.unlock();
+		this->wake.notify_all();
+	}
+
+	job(count - 1);
+
+	if (count > 1)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->done.wait(lock, [this] { return this->pending == 0; });
+		this->job = nullptr;
+	}
+}
+
+void WorkerPool::loop(unsigned int index, unsigned int generation)
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	for (;;)
+	{
+		this->wake.wait(lock, [&] { return this->stopping || this->generation != generation; });
+		if (this->stopping) return;
+		generation = this->generation;
+		if (index >= this->parts) continue;
+
+		const std::function<void(unsigned int)>& job = *this->job;
+		lock.unlock();
+		job(index);
+		lock.lock();
+		if (--this->pending == 0)
+			this->done.notify_one();
+	}
+}
@@ -0,0 +1,61 @@
+/** \file WorkerPool.h
+ * \author Eduardo Pinho ( enet4mikeenet AT gmail.com )
+ * \date 2013
+ * \class derplot::WorkerPool
+ * \brief Keeps threads waiting for parts of a job, so that parallel operations do not
+ * create a thread each time.
+ *
+ * A job is a function called once for each part, with the index of the part. The
+ * calling thread runs the last part itself, and waits for the other ones. Threads are
+ * only created when a job has more parts than ever before. A pool must only be used by
+ * one thread at a time.
+ */
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace derplot
+{
+
+class WorkerPool
+{
+	private:
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable wake, done;
+		const std::function<void(unsigned int)>* job; // of the current run
+		unsigned int generation; // incremented on each run
+		unsigned int parts; // run by the threads in the current run
+		unsigned int pending; // parts not finished yet
+		bool stopping;
+
+		void loop(unsigned int index, unsigned int generation);
+
+	public:
+		/** Default constructor, of a pool without threads */
+		WorkerPool(void);
+
+		/** Destructor, which stops and joins all threads */
+		~WorkerPool();
+
+		/** No Copy Constructor */
+		WorkerPool(const WorkerPool& other) = delete;
+		/** No Copy Assignment operator */
+		WorkerPool& operator=(const WorkerPool& other) = delete;
+
+		/** \return the number of threads waiting for jobs, besides the caller */
+		unsigned int size(void) const;
+
+		/** Runs a job in parts, each one in its own thread, and waits for all of them.
+		 * \param count the number of parts, where part <tt>count - 1</tt> is run by the
+		 * calling thread
+		 * \param job the function to call with the index of each part
+		 */
+		void run(unsigned int count, const std::function<void(unsigned int)>& job);
+};
+
+};